@@ -0,0 +1,407 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+/*
+ * Micro-benchmarks of the database tables, each table on its own without the
+ * facade locks, the timer engine or the pipeline. Every workload reports the
+ * mean cost of its measured operations as ns/op and ops/s:
+ *
+ *   timeslot	add, refresh and purge of nodes
+ *   rt			RREQ and RREP captures for N destinations, per-packet route
+ *				refreshes through the locked and the lock-free lookup
+ *   nt			neighbor churn: HELLOs from N/10 neighbors that come and go
+ *   pdr		HELLO captures and ETX lookups for N/10 neighbors
+ *   ds			duplicate detection of data packets from N sources
+ *   pb			push of 10 packets to each of N destinations, pop of all
+ *   st			add and pop of N schedules
+ *
+ * N is 10000 or the first argument. Workloads are deterministic, only the
+ * clock differs between runs.
+ */
+
+#include <time.h>
+#include "../src/config.h"
+#include "../src/database/timeslot.h"
+#include "../src/database/routing_table/aodv_rt.h"
+#include "../src/database/neighbor_table/nt.h"
+#include "../src/database/pdr_tracker/pdr.h"
+#include "../src/database/data_seq/ds.h"
+#include "../src/database/packet_buffer/packet_buffer.h"
+#include "../src/database/schedule_table/aodv_st.h"
+
+#define DB_BENCH_DESTINATIONS	10000
+#define DB_BENCH_LOOKUPS		1000000
+#define DB_BENCH_PACKETS		10 /* per destination */
+
+/* globals owned by aodv.c in the daemon */
+uint16_t hello_interval = HELLO_INTERVAL;
+uint16_t tracking_factor = PDR_TRACKING_FACTOR;
+aodv_metric_t metric_type = AODV_METRIC_RFC;
+int8_t signal_strength_threshold = AODV_SIGNAL_STRENGTH_THRESHOLD;
+uint32_t pb_dest_max_packets = PB_DEST_MAX_PACKETS;
+uint32_t pb_dest_max_bytes = UINT32_MAX;
+uint32_t pb_max_bytes = UINT32_MAX;
+aodv_pb_policy_t pb_policy = PB_POLICY;
+
+/* the tables call back into the facade, which is not linked in */
+int aodv_db_addschedule(struct timeval* execute_ts, mac_addr ether_addr, uint8_t type, void* param) {
+    return aodv_db_sc_addschedule(execute_ts, ether_addr, type, param);
+}
+
+int aodv_db_dropschedule(mac_addr ether_addr, uint8_t type) {
+    return aodv_db_sc_dropschedule(ether_addr, type);
+}
+
+int aodv_db_reset_rssi(mac_addr ether_neighbor_addr, dessert_meshif_t* iface, struct timeval* timestamp) {
+    return db_nt_reset_rssi(ether_neighbor_addr, iface, timestamp);
+}
+
+static dessert_meshif_t bench_iface = { NULL, NULL, {0x02, 0xff, 0, 0, 0, 1}, "bench0" };
+static uint64_t bench_start_ns;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bench_begin() {
+    bench_start_ns = now_ns();
+}
+
+static void bench_end(const char* name, uint64_t ops) {
+    uint64_t ns = now_ns() - bench_start_ns;
+
+    if(ns == 0) {
+        ns = 1;
+    }
+
+    printf("%-34s %10" PRIu64 " %12.1f %14.0f\n", name, ops, (double) ns / ops, (double) ops * 1000000000 / ns);
+}
+
+static void bench_addr(uint8_t prefix, uint32_t i, mac_addr addr_out) {
+    addr_out[0] = 0x02;
+    addr_out[1] = prefix;
+    addr_out[2] = i >> 24;
+    addr_out[3] = i >> 16;
+    addr_out[4] = i >> 8;
+    addr_out[5] = i;
+}
+
+/* xorshift, so that lookups do not walk the tables in insertion order */
+static uint32_t bench_rand(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void bench_purger(struct timeval* purge_time, void* src_object, void* object) {
+}
+
+static int bench_timeslot(uint32_t n, struct timeval* now) {
+    timeslot_t* ts;
+    struct timeval timeout = { 10, 0 };
+    timeslot_node_t* nodes = calloc(n, sizeof(timeslot_node_t));
+    uint32_t i;
+
+    if(!nodes || !timeslot_create(&ts, &timeout, NULL, bench_purger)) {
+        return false;
+    }
+    timeslot_set_purge_on_add(ts, false);
+
+    for(i = 0; i < n; ++i) {
+        timeslot_node_init(&nodes[i], &nodes[i]);
+    }
+
+    bench_begin();
+    for(i = 0; i < n; ++i) {
+        timeslot_addnode(ts, now, &nodes[i]);
+    }
+    bench_end("timeslot add", n);
+
+    struct timeval later = hf_tv_add_ms(*now, 1000);
+    bench_begin();
+    for(i = 0; i < n; ++i) {
+        timeslot_addnode(ts, &later, &nodes[i]);
+    }
+    bench_end("timeslot refresh", n);
+
+    struct timeval expired = hf_tv_add_ms(later, 20000);
+    bench_begin();
+    timeslot_purgeobjects(ts, &expired);
+    bench_end("timeslot purge", n);
+
+    timeslot_destroy(ts);
+    free(nodes);
+    return true;
+}
+
+static int bench_rt(uint32_t n, struct timeval* now) {
+    mac_addr dest, prev_hop, next_hop;
+    dessert_meshif_t* iface;
+    aodv_capt_rreq_result_t result;
+    uint32_t i, seed = 1;
+
+    if(!aodv_db_rt_init()) {
+        return false;
+    }
+
+    mac_addr self;
+    bench_addr(0xfe, 0, self);
+
+    // RREQs from n originators set up n reverse routes over 16 neighbors
+    bench_begin();
+    for(i = 0; i < n; ++i) {
+        bench_addr(0x01, i, dest);
+        bench_addr(0x02, i % 16, prev_hop);
+        aodv_db_rt_capt_rreq(self, dest, prev_hop, &bench_iface, 1, 3, 3, now, &result);
+    }
+    bench_end("rt capt rreq (new originator)", n);
+
+    bench_begin();
+    for(i = 0; i < n; ++i) {
+        bench_addr(0x01, i, dest);
+        bench_addr(0x02, i % 16, prev_hop);
+        aodv_db_rt_capt_rreq(self, dest, prev_hop, &bench_iface, 1, 3, 3, now, &result);
+    }
+    bench_end("rt capt rreq (duplicate)", n);
+
+    uint32_t over_next_hop = 0;
+    bench_begin();
+    for(i = 0; i < n; ++i) {
+        bench_addr(0x01, i, dest);
+        bench_addr(0x02, (i + 1) % 16, next_hop);
+        aodv_db_rt_capt_rrep(dest, next_hop, &bench_iface, 2, 2, 2, now);
+        over_next_hop += ((i + 1) % 16 == 3);
+    }
+    bench_end("rt capt rrep (next hop moves)", n);
+
+    bench_begin();
+    for(i = 0; i < DB_BENCH_LOOKUPS; ++i) {
+        bench_addr(0x01, bench_rand(&seed) % n, dest);
+        aodv_db_rt_getroute2dest(dest, next_hop, &iface, now, AODV_FLAGS_ROUTE_LOCAL_USED);
+    }
+    bench_end("rt getroute2dest (locked)", DB_BENCH_LOOKUPS);
+
+    bench_begin();
+    for(i = 0; i < DB_BENCH_LOOKUPS; ++i) {
+        bench_addr(0x01, bench_rand(&seed) % n, dest);
+        aodv_db_rt_fib_getroute2dest(dest, next_hop, &iface, now, AODV_FLAGS_ROUTE_LOCAL_USED);
+    }
+    bench_end("rt getroute2dest (fib)", DB_BENCH_LOOKUPS);
+
+    bench_addr(0x02, 3, next_hop);
+    bench_begin();
+    aodv_db_rt_inv_over_nexthop(next_hop);
+    bench_end("rt invalidate over next hop (per route)", over_next_hop ? over_next_hop : 1);
+
+    uint32_t removed;
+    bench_begin();
+    aodv_db_rt_routing_reset(&removed);
+    bench_end("rt reset", removed ? removed : 1);
+    return true;
+}
+
+static int bench_nt(uint32_t n, struct timeval* now) {
+    uint32_t neighbors = max(n / 10, 1);
+    uint32_t rounds = 20;
+    uint32_t i, r;
+    mac_addr neighbor;
+    struct timeval t = *now;
+
+    if(!db_nt_init()) {
+        return false;
+    }
+
+    // every round half of the neighbors is replaced, the old ones time out
+    bench_begin();
+    for(r = 0; r < rounds; ++r) {
+        for(i = 0; i < neighbors; ++i) {
+            bench_addr(0x03, i + (i % 2 ? r * neighbors : 0), neighbor);
+            db_nt_cap2Dneigh(neighbor, r, &bench_iface, &t);
+        }
+
+        t = hf_tv_add_ms(t, hello_interval * (ALLOWED_HELLO_LOST + 1));
+        db_nt_cleanup(&t);
+    }
+    bench_end("nt hello capture with churn", (uint64_t) rounds * neighbors);
+
+    bench_begin();
+    for(i = 0; i < DB_BENCH_LOOKUPS / 10; ++i) {
+        bench_addr(0x03, i % neighbors, neighbor);
+        db_nt_check2Dneigh(neighbor, &bench_iface, &t);
+    }
+    bench_end("nt check neighbor", DB_BENCH_LOOKUPS / 10);
+    return true;
+}
+
+static int bench_pdr(uint32_t n, struct timeval* now) {
+    uint32_t neighbors = max(n / 10, 1);
+    uint32_t rounds = 20;
+    uint32_t i, r;
+    mac_addr neighbor;
+    struct timeval t = *now;
+    uint16_t etx;
+
+    if(!aodv_db_pdr_nt_init()) {
+        return false;
+    }
+
+    bench_begin();
+    for(r = 0; r < rounds; ++r) {
+        for(i = 0; i < neighbors; ++i) {
+            bench_addr(0x04, i, neighbor);
+            aodv_db_pdr_nt_cap_hello(neighbor, r, hello_interval, &t);
+        }
+        t = hf_tv_add_ms(t, hello_interval);
+    }
+    bench_end("pdr hello capture", (uint64_t) rounds * neighbors);
+
+    bench_begin();
+    for(i = 0; i < DB_BENCH_LOOKUPS / 10; ++i) {
+        bench_addr(0x04, i % neighbors, neighbor);
+        aodv_db_pdr_nt_get_etx_mul(neighbor, &etx, &t);
+    }
+    bench_end("pdr etx lookup", DB_BENCH_LOOKUPS / 10);
+    return true;
+}
+
+static int bench_ds(uint32_t n, struct timeval* now) {
+    mac_addr source;
+    uint32_t i, seed = 7;
+
+    if(!db_ds_init()) {
+        return false;
+    }
+
+    bench_begin();
+    for(i = 0; i < DB_BENCH_LOOKUPS; ++i) {
+        uint32_t src = bench_rand(&seed) % n;
+        bench_addr(0x05, src, source);
+        aodv_db_ds_capt_data_seq(source, i / n, 3, now);
+    }
+    bench_end("ds capture data seq", DB_BENCH_LOOKUPS);
+
+    struct timeval expired = hf_tv_add_ms(*now, 60000);
+    bench_begin();
+    db_ds_cleanup(&expired);
+    bench_end("ds cleanup", n);
+    return true;
+}
+
+static int bench_pb(uint32_t n, struct timeval* now) {
+    dessert_msg_t* msg;
+    aodv_pb_batch_t batch;
+    mac_addr dest;
+    uint32_t i, j, popped = 0;
+
+    if(!pb_init() || dessert_stub_msg_new(&msg, 64, 1000) != DESSERT_OK) {
+        return false;
+    }
+
+    bench_begin();
+    for(j = 0; j < DB_BENCH_PACKETS; ++j) {
+        for(i = 0; i < n; ++i) {
+            bench_addr(0x06, i, dest);
+            pb_push_packet(dest, msg, now);
+        }
+    }
+    bench_end("pb push", (uint64_t) n * DB_BENCH_PACKETS);
+
+    bench_begin();
+    for(i = 0; i < n; ++i) {
+        bench_addr(0x06, i, dest);
+
+        if(pb_pop_packets(dest, &batch)) {
+            for(j = 0; j < batch.count; ++j) {
+                dessert_msg_destroy(batch.msgs[(batch.head + j) % batch.capacity]);
+            }
+            popped += batch.count;
+            free(batch.msgs);
+        }
+    }
+    bench_end("pb pop (per packet)", popped ? popped : 1);
+
+    dessert_msg_destroy(msg);
+    return popped == n * DB_BENCH_PACKETS;
+}
+
+static int bench_st(uint32_t n, struct timeval* now) {
+    mac_addr addr, addr_out;
+    struct timeval execute_ts, planned;
+    uint32_t i, seed = 3, popped = 0;
+    uint8_t type;
+    void* param;
+
+    // the neighbor table planned RERRs for the neighbors that timed out
+    struct timeval all = hf_tv_add_ms(*now, 3600000);
+    while(aodv_db_sc_popschedule(&all, addr_out, &type, &param, &planned));
+
+    bench_begin();
+    for(i = 0; i < n; ++i) {
+        bench_addr(0x07, i, addr);
+        execute_ts = hf_tv_add_ms(*now, bench_rand(&seed) % 10000);
+        aodv_db_sc_addschedule(&execute_ts, addr, AODV_SC_SEND_OUT_RERR, NULL);
+    }
+    bench_end("st add schedule", n);
+
+    struct timeval due = hf_tv_add_ms(*now, 10000);
+    bench_begin();
+    while(aodv_db_sc_popschedule(&due, addr_out, &type, &param, &planned)) {
+        popped++;
+    }
+    bench_end("st pop schedule", popped ? popped : 1);
+    return popped == n;
+}
+
+int main(int argc, char** argv) {
+    uint32_t n = DB_BENCH_DESTINATIONS;
+    struct timeval now;
+    int ok = true;
+
+    if(argc > 1 && (sscanf(argv[1], "%" SCNu32, &n) != 1 || n == 0)) {
+        fprintf(stderr, "usage: %s [destinations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    gettimeofday(&now, NULL);
+    printf("database micro-benchmarks, %" PRIu32 " destinations\n", n);
+    printf("%-34s %10s %12s %14s\n", "workload", "ops", "ns/op", "ops/s");
+
+    ok &= bench_timeslot(n, &now);
+    ok &= bench_rt(n, &now);
+    ok &= bench_nt(n, &now);
+    ok &= bench_pdr(n, &now);
+    ok &= bench_ds(n, &now);
+    ok &= bench_pb(n, &now);
+    ok &= bench_st(n, &now);
+
+    if(!ok) {
+        fprintf(stderr, "a workload failed\n");
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,185 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+/*
+ * Minimal stand-in for libdessert, just enough to build database modules into
+ * benchmarks without a mesh interface, a cli or the dessert main loop.
+ * Only the parts of the API used by the benchmarked modules and the pipeline
+ * are provided. Sending is left to the program: dessert_meshsend and
+ * dessert_syssend_msg are declared here but defined by whoever links the
+ * pipeline, e.g. the mesh simulator.
+ */
+
+#ifndef DESSERT_STUB
+#define DESSERT_STUB
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+
+typedef uint8_t mac_addr[ETH_ALEN];
+
+#define DESSERT_OK					0
+#define DESSERT_ERR					1
+#define DESSERT_MAXFRAMELEN			ETHER_MAX_LEN
+#define DESSERT_MAXEXTDATALEN		253
+#define DESSERT_EXTLEN				2
+#define DESSERT_EXT_ETH				0x01
+#define DESSERT_EXT_USER			0x40
+#define DESSERT_LBUF_LEN			1024
+
+#define DESSERT_MSG_KEEP			0
+#define DESSERT_MSG_DROP			1
+#define DESSERT_MSG_NEEDMSGPROC		3
+
+#define DESSERT_PER_KEEP			0
+#define DESSERT_PER_UNREGISTER		1
+
+#define DESSERT_RX_FLAG_L2_DST			0x01
+#define DESSERT_RX_FLAG_L2_SRC			0x02
+#define DESSERT_RX_FLAG_L2_BROADCAST	0x04
+#define DESSERT_RX_FLAG_L25_DST			0x08
+#define DESSERT_RX_FLAG_L25_SRC			0x10
+#define DESSERT_RX_FLAG_L25_BROADCAST	0x20
+#define DESSERT_RX_FLAG_L25_MULTICAST	0x40
+
+#define MAC "%02x:%02x:%02x:%02x:%02x:%02x"
+#define EXPLODE_ARRAY6(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+
+#define mac_copy(dst, src) memcpy((dst), (src), ETH_ALEN)
+#define mac_equal(a, b) (memcmp((a), (b), ETH_ALEN) == 0)
+
+typedef struct __attribute__((__packed__)) dessert_msg {
+    struct ether_header	l2h;
+    char				proto[4];
+    uint8_t				ver;
+    uint8_t				flags;
+    union {
+        uint32_t		u32;
+        struct __attribute__((__packed__)) {
+            uint8_t		ttl;
+            uint8_t		u8;
+            uint16_t	u16;
+        };
+    };
+    uint16_t			hlen;
+    uint16_t			plen;
+} dessert_msg_t;
+
+/** extensions follow the header, len counts the type and len bytes too */
+typedef struct __attribute__((__packed__)) dessert_ext {
+    uint8_t				type;
+    uint8_t				len;
+    uint8_t				data[DESSERT_MAXEXTDATALEN];
+} dessert_ext_t;
+
+typedef struct dessert_msg_proc {
+    uint16_t			lflags;
+    uint16_t			lreserved;
+    char				lbuf[DESSERT_LBUF_LEN];
+} dessert_msg_proc_t;
+
+typedef struct dessert_meshif {
+    struct dessert_meshif*	prev;
+    struct dessert_meshif*	next;
+    uint8_t					hwaddr[ETH_ALEN];
+    char					if_name[IFNAMSIZ];
+} dessert_meshif_t;
+
+typedef struct dessert_sysif {
+    uint8_t				hwaddr[ETH_ALEN];
+    char				if_name[IFNAMSIZ];
+} dessert_sysif_t;
+
+typedef uint64_t dessert_frameid_t;
+
+typedef int dessert_meshrxcb_t(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_meshif_t* iface, dessert_frameid_t id);
+typedef int dessert_sysrxcb_t(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_sysif_t* sysif, dessert_frameid_t id);
+
+/** address of this node on layer 2.5 */
+extern mac_addr dessert_l25_defsrc;
+extern mac_addr ether_broadcast;
+
+#define MESHIFLIST_ITERATOR_START(__interface) { \
+    dessert_meshif_t* __list = dessert_meshiflist_get(); \
+    for(__interface = __list; __interface; __interface = __interface->next) {
+#define MESHIFLIST_ITERATOR_STOP } }
+
+/** signal strength of a neighbor; the stub never measured one */
+typedef struct avg_node_result {
+    int8_t avg_rssi;
+} avg_node_result_t;
+
+typedef int dessert_per_result_t;
+typedef dessert_per_result_t dessert_periodiccallback_t(void* data, struct timeval* scheduled, struct timeval* interval);
+typedef struct dessert_periodic dessert_periodic_t;
+
+/* logging is compiled out, benchmarks measure the code and not the log */
+#define dessert_trace(...)		do {} while(0)
+#define dessert_debug(...)		do {} while(0)
+#define dessert_info(...)		do {} while(0)
+#define dessert_notice(...)		do {} while(0)
+#define dessert_warn(...)		do {} while(0)
+#define dessert_crit(...)		do {} while(0)
+
+/** create a message with a header of hlen bytes and a payload of plen bytes */
+int dessert_stub_msg_new(dessert_msg_t** msg_out, uint16_t hlen, uint16_t plen);
+int dessert_msg_new(dessert_msg_t** msgout);
+int dessert_msg_clone(dessert_msg_t** msgnew, const dessert_msg_t* msgold, bool sparse);
+void dessert_msg_destroy(dessert_msg_t* msg);
+int dessert_msg_addext(dessert_msg_t* msg, dessert_ext_t** ext, uint8_t type, size_t len);
+/** number of extensions of type, ext receives the one at index; 0 if there is none at index */
+int dessert_msg_getext(const dessert_msg_t* msg, dessert_ext_t** ext, uint8_t type, int index);
+struct ether_header* dessert_msg_getl25ether(const dessert_msg_t* msg);
+int dessert_msg_dummy_payload(dessert_msg_t* msg, size_t len);
+
+/** add a mesh interface to the list returned by dessert_meshiflist_get */
+dessert_meshif_t* dessert_stub_meshif_add(const mac_addr hwaddr, const char* if_name);
+dessert_meshif_t* dessert_meshiflist_get(void);
+
+/* not part of the stub, see above */
+int dessert_meshsend(const dessert_msg_t* msgin, dessert_meshif_t* iface);
+int dessert_syssend_msg(dessert_msg_t* msg);
+
+dessert_meshrxcb_t dessert_msg_check_cb;
+dessert_meshrxcb_t dessert_msg_ifaceflags_cb;
+dessert_meshrxcb_t dessert_mesh_ipttl;
+dessert_sysrxcb_t dessert_sys_drop_ipv6;
+
+avg_node_result_t dessert_rssi_avg(const mac_addr hwaddr, dessert_meshif_t* iface);
+
+int dessert_timevalcmp(const struct timeval* tvA, const struct timeval* tvB);
+int dessert_timevaladd(struct timeval* tv, time_t sec, suseconds_t usec);
+int dessert_timevaladd2(struct timeval* result, struct timeval* tv1, struct timeval* tv2);
+int dessert_ms2timeval(uint32_t ms, struct timeval* tv);
+
+#endif
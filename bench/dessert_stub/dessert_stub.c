@@ -0,0 +1,293 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include "dessert.h"
+
+mac_addr dessert_l25_defsrc = { 0 };
+mac_addr ether_broadcast = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+static dessert_meshif_t* meshif_list = NULL;
+
+int dessert_stub_msg_new(dessert_msg_t** msg_out, uint16_t hlen, uint16_t plen) {
+    if(hlen < sizeof(dessert_msg_t)) {
+        hlen = sizeof(dessert_msg_t);
+    }
+
+    dessert_msg_t* msg = calloc(1, DESSERT_MAXFRAMELEN);
+
+    if(msg == NULL) {
+        return DESSERT_ERR;
+    }
+
+    msg->hlen = hlen;
+    msg->plen = plen;
+    *msg_out = msg;
+    return DESSERT_OK;
+}
+
+int dessert_msg_new(dessert_msg_t** msgout) {
+    dessert_msg_t* msg;
+
+    if(dessert_stub_msg_new(&msg, sizeof(dessert_msg_t), 0) != DESSERT_OK) {
+        return DESSERT_ERR;
+    }
+
+    mac_copy(msg->l2h.ether_dhost, ether_broadcast);
+    memcpy(msg->proto, "STUB", sizeof(msg->proto));
+    msg->ttl = 0xff;
+    *msgout = msg;
+    return DESSERT_OK;
+}
+
+int dessert_msg_clone(dessert_msg_t** msgnew, const dessert_msg_t* msgold, bool sparse) {
+    size_t len = msgold->hlen + msgold->plen;
+    dessert_msg_t* msg = malloc(sparse ? len : DESSERT_MAXFRAMELEN);
+
+    if(msg == NULL) {
+        return DESSERT_ERR;
+    }
+
+    memcpy(msg, msgold, len);
+    *msgnew = msg;
+    return DESSERT_OK;
+}
+
+void dessert_msg_destroy(dessert_msg_t* msg) {
+    free(msg);
+}
+
+int dessert_msg_addext(dessert_msg_t* msg, dessert_ext_t** ext, uint8_t type, size_t len) {
+    if(len > DESSERT_MAXEXTDATALEN
+       || msg->hlen + msg->plen + len + DESSERT_EXTLEN > DESSERT_MAXFRAMELEN) {
+        return DESSERT_ERR;
+    }
+
+    uint8_t* at = (uint8_t*) msg + msg->hlen;
+    memmove(at + len + DESSERT_EXTLEN, at, msg->plen); // the payload follows the extensions
+
+    dessert_ext_t* added = (dessert_ext_t*) at;
+    added->type = type;
+    added->len = len + DESSERT_EXTLEN;
+    memset(added->data, 0, len);
+    msg->hlen += added->len;
+
+    if(ext != NULL) {
+        *ext = added;
+    }
+
+    return DESSERT_OK;
+}
+
+int dessert_msg_getext(const dessert_msg_t* msg, dessert_ext_t** ext, uint8_t type, int index) {
+    const uint8_t* end = (const uint8_t*) msg + msg->hlen;
+    const uint8_t* at = (const uint8_t*) msg + sizeof(dessert_msg_t);
+    int count = 0;
+
+    if(ext != NULL) {
+        *ext = NULL;
+    }
+
+    while(at + DESSERT_EXTLEN <= end) {
+        dessert_ext_t* current = (dessert_ext_t*) at;
+
+        if(current->len < DESSERT_EXTLEN) {
+            break; // corrupt, dessert_msg_check_cb drops it
+        }
+
+        if(current->type == type) {
+            if(ext != NULL && count == index) {
+                *ext = current;
+            }
+            count++;
+        }
+
+        at += current->len;
+    }
+
+    if(ext != NULL && *ext == NULL) {
+        return 0;
+    }
+
+    return count;
+}
+
+struct ether_header* dessert_msg_getl25ether(const dessert_msg_t* msg) {
+    dessert_ext_t* ext;
+
+    if(dessert_msg_getext(msg, &ext, DESSERT_EXT_ETH, 0) == 0) {
+        return NULL;
+    }
+
+    return (struct ether_header*) ext->data;
+}
+
+int dessert_msg_dummy_payload(dessert_msg_t* msg, size_t len) {
+    if(msg->plen != 0 || msg->hlen + len > DESSERT_MAXFRAMELEN) {
+        return DESSERT_ERR;
+    }
+
+    memset((uint8_t*) msg + msg->hlen, 0xA5, len);
+    msg->plen = len;
+    return DESSERT_OK;
+}
+
+dessert_meshif_t* dessert_stub_meshif_add(const mac_addr hwaddr, const char* if_name) {
+    dessert_meshif_t* iface = calloc(1, sizeof(*iface));
+
+    if(iface == NULL) {
+        return NULL;
+    }
+
+    mac_copy(iface->hwaddr, hwaddr);
+    snprintf(iface->if_name, sizeof(iface->if_name), "%s", if_name);
+
+    // appended, the first interface stays the head of the list
+    dessert_meshif_t** tail = &meshif_list;
+
+    while(*tail) {
+        iface->prev = *tail;
+        tail = &(*tail)->next;
+    }
+
+    *tail = iface;
+    return iface;
+}
+
+dessert_meshif_t* dessert_meshiflist_get(void) {
+    return meshif_list;
+}
+
+static int dessert_stub_is_meshif(const uint8_t* hwaddr) {
+    dessert_meshif_t* iface;
+
+    for(iface = meshif_list; iface; iface = iface->next) {
+        if(mac_equal(iface->hwaddr, hwaddr)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int dessert_msg_check_cb(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_meshif_t* iface, dessert_frameid_t id) {
+    if(msg->hlen < sizeof(dessert_msg_t) || msg->hlen + msg->plen > len) {
+        return DESSERT_MSG_DROP;
+    }
+
+    return DESSERT_MSG_KEEP;
+}
+
+int dessert_msg_ifaceflags_cb(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_meshif_t* iface, dessert_frameid_t id) {
+    if(proc == NULL) {
+        return DESSERT_MSG_NEEDMSGPROC;
+    }
+
+    if(mac_equal(msg->l2h.ether_dhost, iface->hwaddr)) {
+        proc->lflags |= DESSERT_RX_FLAG_L2_DST;
+    }
+    else if(mac_equal(msg->l2h.ether_dhost, ether_broadcast)) {
+        proc->lflags |= DESSERT_RX_FLAG_L2_BROADCAST;
+    }
+
+    if(dessert_stub_is_meshif(msg->l2h.ether_shost)) {
+        proc->lflags |= DESSERT_RX_FLAG_L2_SRC;
+    }
+
+    struct ether_header* l25h = dessert_msg_getl25ether(msg);
+
+    if(l25h == NULL) {
+        return DESSERT_MSG_KEEP;
+    }
+
+    if(mac_equal(l25h->ether_dhost, dessert_l25_defsrc)) {
+        proc->lflags |= DESSERT_RX_FLAG_L25_DST;
+    }
+    else if(mac_equal(l25h->ether_dhost, ether_broadcast)) {
+        proc->lflags |= DESSERT_RX_FLAG_L25_BROADCAST;
+    }
+    else if(l25h->ether_dhost[0] & 0x01) {
+        proc->lflags |= DESSERT_RX_FLAG_L25_MULTICAST;
+    }
+
+    if(mac_equal(l25h->ether_shost, dessert_l25_defsrc)) {
+        proc->lflags |= DESSERT_RX_FLAG_L25_SRC;
+    }
+
+    return DESSERT_MSG_KEEP;
+}
+
+/* the stub never carries IP, so there is no IP TTL to decrement */
+int dessert_mesh_ipttl(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_meshif_t* iface, dessert_frameid_t id) {
+    return DESSERT_MSG_KEEP;
+}
+
+int dessert_sys_drop_ipv6(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_sysif_t* sysif, dessert_frameid_t id) {
+    struct ether_header* l25h = dessert_msg_getl25ether(msg);
+
+    if(l25h != NULL && l25h->ether_type == htons(ETHERTYPE_IPV6)) {
+        return DESSERT_MSG_DROP;
+    }
+
+    return DESSERT_MSG_KEEP;
+}
+
+avg_node_result_t dessert_rssi_avg(const mac_addr hwaddr, dessert_meshif_t* iface) {
+    avg_node_result_t result = { 0 };
+    return result;
+}
+
+int dessert_timevalcmp(const struct timeval* tvA, const struct timeval* tvB) {
+    if(tvA->tv_sec != tvB->tv_sec) {
+        return (tvA->tv_sec < tvB->tv_sec) ? -1 : 1;
+    }
+
+    if(tvA->tv_usec != tvB->tv_usec) {
+        return (tvA->tv_usec < tvB->tv_usec) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+int dessert_timevaladd(struct timeval* tv, time_t sec, suseconds_t usec) {
+    tv->tv_sec += sec;
+    tv->tv_usec += usec;
+
+    while(tv->tv_usec >= 1000000) {
+        tv->tv_sec++;
+        tv->tv_usec -= 1000000;
+    }
+
+    return DESSERT_OK;
+}
+
+int dessert_timevaladd2(struct timeval* result, struct timeval* tv1, struct timeval* tv2) {
+    *result = *tv1;
+    return dessert_timevaladd(result, tv2->tv_sec, tv2->tv_usec);
+}
+
+int dessert_ms2timeval(uint32_t ms, struct timeval* tv) {
+    tv->tv_sec = ms / 1000;
+    tv->tv_usec = (ms % 1000) * 1000;
+    return DESSERT_OK;
+}
@@ -0,0 +1,1175 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+/*
+ * In-process mesh simulator: N instances of the AODV pipeline and database in
+ * one process, on a virtual clock and a lossy topology model. It tells how
+ * discovery overhead and convergence scale with the size of the mesh, without
+ * a testbed. Each run is one scenario and reports
+ *
+ *   control overhead  bytes and frames per node and second by message type
+ *   discovery         finished discoveries, retries and latency percentiles
+ *   delivery          delivery ratio and end-to-end delay of the data flows
+ *   route stretch     hops of delivered packets over the shortest path
+ *
+ * The daemon keeps its state in globals, so all nodes share one copy of its
+ * code (bench/mesh_node.o). bench/mesh_sim.ld collects the writable data of
+ * that copy in one block and every node has its own instance of the block in a
+ * memory file, which is mapped over it before the node handles an event. Thread
+ * locals are compiled as plain globals, the timer and discovery engines run
+ * without their threads and gettimeofday and clock_gettime are wrapped to read
+ * the virtual clock. Events take no virtual time.
+ *
+ * Topologies are a grid or a line with unit spacing, a random geometric graph
+ * or the positions of a mobility trace; nodes within range are neighbors. A
+ * frame reaches every neighbor after its airtime and is lost independently
+ * with the given probability, unicast frames are retried like on 802.11.
+ * The frames of one node are sent one after the other, but there is no
+ * contention between nodes and so no collisions.
+ *
+ * Trace files hold lines of "<time s> <node> <x> <y>"; every node needs a
+ * position at time 0 and keeps it until the next line for it.
+ */
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <math.h>
+#include <time.h>
+#include "../src/config.h"
+#include "../src/helper.h"
+#include "../src/database/aodv_database.h"
+#include "../src/pipeline/aodv_pipeline.h"
+#include "../src/pipeline/aodv_timer.h"
+#include "../src/pipeline/aodv_discovery.h"
+#include "../src/pipeline/aodv_histogram.h"
+#include "../src/pipeline/aodv_stats.h"
+
+#define SIM_EPOCH				1000000000 /* s, virtual time 0 in gettimeofday */
+#define SIM_BITRATE				6000000 /* bit/s */
+#define SIM_PHY_OVERHEAD		100 /* us per frame, preamble and inter frame space */
+#define SIM_BACKOFF				300 /* us, random delay before every frame */
+#define SIM_UNICAST_RETRIES		3
+#define SIM_DRAIN				5 /* s at the end without new data packets */
+#define SIM_TIMER_MIN			1000 /* us between two runs of the timer engine of one node */
+#define SIM_ETHERTYPE			0x88b5 /* local experimental */
+#define SIM_PAYLOAD_MAGIC		0x4d455348
+
+/* globals owned by aodv.c in the daemon */
+uint16_t hello_size = HELLO_SIZE;
+uint16_t hello_interval = HELLO_INTERVAL;
+uint16_t rreq_size = RREQ_SIZE;
+double gossip_p = GOSSIP_P;
+bool dest_only = DEST_ONLY;
+bool ring_search = RING_SEARCH;
+aodv_gossip_t gossip_type = GOSSIP_NONE;
+aodv_metric_t metric_type = AODV_METRIC_RFC;
+uint16_t metric_startvalue = AODV_METRIC_STARTVAL;
+uint16_t rreq_interval = RREQ_INTERVAL;
+int8_t signal_strength_threshold = AODV_SIGNAL_STRENGTH_THRESHOLD;
+uint16_t tracking_factor = PDR_TRACKING_FACTOR;
+uint32_t pb_dest_max_packets = PB_DEST_MAX_PACKETS;
+uint32_t pb_dest_max_bytes = PB_DEST_MAX_BYTES;
+uint32_t pb_max_bytes = PB_MAX_BYTES;
+aodv_pb_policy_t pb_policy = PB_POLICY;
+
+/* the pipeline as registered by aodv.c */
+AODV_STATS_MESH_CB(dessert_msg_check_cb, AODV_CB_MSG_CHECK)
+AODV_STATS_MESH_CB(dessert_msg_ifaceflags_cb, AODV_CB_IFACEFLAGS)
+AODV_STATS_MESH_CB(aodv_drop_errors, AODV_CB_DROP_ERRORS)
+AODV_STATS_MESH_CB(aodv_handle_hello, AODV_CB_HANDLE_HELLO)
+AODV_STATS_MESH_CB(aodv_handle_rreq, AODV_CB_HANDLE_RREQ)
+AODV_STATS_MESH_CB(aodv_handle_rerr, AODV_CB_HANDLE_RERR)
+AODV_STATS_MESH_CB(aodv_handle_rrep, AODV_CB_HANDLE_RREP)
+AODV_STATS_MESH_CB(dessert_mesh_ipttl, AODV_CB_MESH_IPTTL)
+AODV_STATS_MESH_CB(aodv_forward_broadcast, AODV_CB_FORWARD_BROADCAST)
+AODV_STATS_MESH_CB(aodv_forward_multicast, AODV_CB_FORWARD_MULTICAST)
+AODV_STATS_MESH_CB(aodv_forward, AODV_CB_FORWARD)
+AODV_STATS_MESH_CB(aodv_local_unicast, AODV_CB_LOCAL_UNICAST)
+
+AODV_STATS_SYS_CB(dessert_sys_drop_ipv6, AODV_CB_SYS_DROP_IPV6)
+AODV_STATS_SYS_CB(aodv_sys_drop_multicast, AODV_CB_SYS_DROP_MULTICAST)
+AODV_STATS_SYS_CB(aodv_sys2rp, AODV_CB_SYS2RP)
+
+static dessert_meshrxcb_t* sim_mesh_cbs[] = {
+    dessert_msg_check_cb_counted,
+    dessert_msg_ifaceflags_cb_counted,
+    aodv_drop_errors_counted,
+    aodv_handle_hello_counted,
+    aodv_handle_rreq_counted,
+    aodv_handle_rerr_counted,
+    aodv_handle_rrep_counted,
+    dessert_mesh_ipttl_counted,
+    aodv_forward_broadcast_counted,
+    aodv_forward_multicast_counted,
+    aodv_forward_counted,
+    aodv_local_unicast_counted
+};
+
+static dessert_sysrxcb_t* sim_sys_cbs[] = {
+    dessert_sys_drop_ipv6_counted,
+    aodv_sys_drop_multicast_counted,
+    aodv_sys2rp_counted
+};
+
+static dessert_sysif_t sim_sysif = { {0x02, 0xfe, 0, 0, 0, 0}, "sim_tap" };
+
+// ---------------------------- scenario -------------------------------------
+
+typedef enum sim_topology {
+    SIM_TOPOLOGY_GRID = 0,
+    SIM_TOPOLOGY_LINE,
+    SIM_TOPOLOGY_GEO,
+    SIM_TOPOLOGY_TRACE
+} sim_topology_t;
+
+static const char* sim_topology_names[] = { "grid", "line", "geo", "trace" };
+
+typedef struct sim_scenario {
+    sim_topology_t topology;
+    const char* trace;
+    uint32_t nodes;
+    double range; // grid and line spacing is 1
+    double degree; // mean number of neighbors of the random geometric graph
+    double loss; // per frame and receiver
+    uint32_t duration; // s
+    uint32_t warmup; // s before the first data packet
+    uint32_t flows;
+    uint32_t interval; // ms between the data packets of one flow
+    uint32_t payload; // bytes
+    uint64_t seed;
+} sim_scenario_t;
+
+static sim_scenario_t scenario = {
+    .topology = SIM_TOPOLOGY_GRID,
+    .trace = NULL,
+    .nodes = 100,
+    .range = 1.0,
+    .degree = 8.0,
+    .loss = 0.05,
+    .duration = 60,
+    .warmup = 10,
+    .flows = 10,
+    .interval = 1000,
+    .payload = 64,
+    .seed = 1
+};
+
+// ---------------------------- nodes and flows ------------------------------
+
+/** frames by what they carry, data is everything without an AODV extension */
+typedef enum sim_class {
+    SIM_CLASS_HELLO = 0,
+    SIM_CLASS_RREQ,
+    SIM_CLASS_RREP,
+    SIM_CLASS_RERR,
+    SIM_CLASS_DATA,
+    SIM_CLASS_COUNT
+} sim_class_t;
+
+static const char* sim_class_names[] = { "hello", "rreq", "rrep", "rerr", "data" };
+
+typedef struct sim_node {
+    mac_addr l25; // dessert_l25_defsrc of the node
+    mac_addr hwaddr; // of its only mesh interface
+    dessert_meshif_t* iface;
+    double x;
+    double y;
+    uint32_t* neighbors;
+    uint32_t neighbor_count;
+    int timer_armed;
+    uint64_t timer_at; // us
+    uint64_t tx_free_at; // us, end of the last frame sent
+    uint64_t tx_bytes[SIM_CLASS_COUNT];
+    uint64_t tx_frames[SIM_CLASS_COUNT];
+} sim_node_t;
+
+typedef struct sim_flow {
+    uint32_t src;
+    uint32_t dst;
+    uint32_t sent;
+    uint32_t delivered;
+} sim_flow_t;
+
+typedef struct __attribute__((__packed__)) sim_payload {
+    uint32_t magic;
+    uint32_t flow;
+    uint64_t sent_us;
+} sim_payload_t;
+
+typedef struct sim_move {
+    uint64_t at; // us
+    uint32_t node;
+    double x;
+    double y;
+} sim_move_t;
+
+static sim_node_t* nodes;
+static sim_flow_t* flows;
+static sim_move_t* moves;
+static uint32_t move_count = 0;
+static uint32_t move_next = 0;
+
+static uint32_t topology_version = 0;
+static uint16_t* hops_from; // shortest paths from hops_src, valid for hops_version
+static uint32_t hops_src = UINT32_MAX;
+static uint32_t hops_version = UINT32_MAX;
+
+static aodv_hist_t delay_us;
+static double stretch_sum = 0;
+static double stretch_max = 0;
+static uint64_t stretch_count = 0;
+static uint64_t frames_lost = 0;
+
+// ---------------------------- virtual clock and rng ------------------------
+
+static uint64_t sim_now = 0; // us since the start of the scenario
+static uint64_t sim_measure_from; // us, counters start with the first data packet
+static uint64_t rng_state;
+
+int __real_clock_gettime(clockid_t clock, struct timespec* ts);
+
+int __wrap_gettimeofday(struct timeval* tv, void* tz) {
+    tv->tv_sec = SIM_EPOCH + sim_now / 1000000;
+    tv->tv_usec = sim_now % 1000000;
+    return 0;
+}
+
+int __wrap_clock_gettime(clockid_t clock, struct timespec* ts) {
+    switch(clock) {
+        case CLOCK_MONOTONIC:
+        case CLOCK_MONOTONIC_COARSE:
+        case CLOCK_MONOTONIC_RAW:
+            ts->tv_sec = sim_now / 1000000;
+            break;
+        case CLOCK_REALTIME:
+        case CLOCK_REALTIME_COARSE:
+            ts->tv_sec = SIM_EPOCH + sim_now / 1000000;
+            break;
+        default:
+            return __real_clock_gettime(clock, ts);
+    }
+
+    ts->tv_nsec = (sim_now % 1000000) * 1000;
+    return 0;
+}
+
+static uint64_t sim_tv_to_us(const struct timeval* tv) {
+    if(tv->tv_sec < SIM_EPOCH) {
+        return 0;
+    }
+
+    return (uint64_t)(tv->tv_sec - SIM_EPOCH) * 1000000 + tv->tv_usec;
+}
+
+static uint64_t wall_ns() {
+    struct timespec ts;
+    __real_clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// xorshift64*, separate from random() which the daemon uses for gossip
+static uint64_t sim_rand() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * UINT64_C(2685821657736338717);
+}
+
+static double sim_uniform() {
+    return (sim_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// ---------------------------- node state -----------------------------------
+
+extern uint8_t mesh_node_state_start[];
+extern uint8_t mesh_node_state_end[];
+
+static int64_t loaded = -1; // node whose state is in the daemon's globals
+static int state_fd = -1; // memory file with the writable data of all nodes
+
+static size_t sim_state_size() {
+    return mesh_node_state_end - mesh_node_state_start;
+}
+
+/** make the daemon's globals those of node i by mapping its slice of the memory file over them */
+static void sim_load(uint32_t i) {
+    if(loaded == i) {
+        return;
+    }
+
+    if(mmap(mesh_node_state_start, sim_state_size(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+            state_fd, (off_t) i * sim_state_size()) == MAP_FAILED) {
+        perror("mapping node state");
+        exit(EXIT_FAILURE);
+    }
+
+    loaded = i;
+}
+
+static void sim_addr(uint8_t prefix, uint32_t i, mac_addr addr_out) {
+    addr_out[0] = 0x02;
+    addr_out[1] = prefix;
+    addr_out[2] = i >> 24;
+    addr_out[3] = i >> 16;
+    addr_out[4] = i >> 8;
+    addr_out[5] = i;
+}
+
+/** node of a mesh interface address, UINT32_MAX if there is none */
+static uint32_t sim_hwaddr_node(const uint8_t* hwaddr) {
+    uint32_t i = (uint32_t) hwaddr[2] << 24 | (uint32_t) hwaddr[3] << 16 | (uint32_t) hwaddr[4] << 8 | hwaddr[5];
+
+    if(hwaddr[0] != 0x02 || hwaddr[1] != 0x00 || i >= scenario.nodes) {
+        return UINT32_MAX;
+    }
+
+    return i;
+}
+
+// ---------------------------- events ---------------------------------------
+
+typedef enum sim_event_type {
+    SIM_EVENT_RX = 0,
+    SIM_EVENT_TIMER,
+    SIM_EVENT_HELLO,
+    SIM_EVENT_DATA,
+    SIM_EVENT_MOVE
+} sim_event_type_t;
+
+typedef struct sim_event {
+    uint64_t at; // us
+    uint64_t seq; // events at the same time run in the order they were added
+    uint32_t node; // flow for SIM_EVENT_DATA
+    uint8_t type;
+    dessert_msg_t* msg; // SIM_EVENT_RX only
+} sim_event_t;
+
+static sim_event_t* events = NULL; // binary min-heap by (at, seq)
+static uint32_t event_count = 0;
+static uint32_t event_capacity = 0;
+static uint64_t event_seq = 0;
+static uint64_t events_run = 0;
+
+static int sim_event_before(const sim_event_t* a, const sim_event_t* b) {
+    return a->at < b->at || (a->at == b->at && a->seq < b->seq);
+}
+
+static void sim_event_add(uint64_t at, uint8_t type, uint32_t node, dessert_msg_t* msg) {
+    if(event_count == event_capacity) {
+        event_capacity = event_capacity ? 2 * event_capacity : 1024;
+        events = realloc(events, event_capacity * sizeof(*events));
+
+        if(events == NULL) {
+            fprintf(stderr, "out of memory for events\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    sim_event_t event = { at, event_seq++, node, type, msg };
+    uint32_t i = event_count++;
+
+    while(i > 0 && sim_event_before(&event, &events[(i - 1) / 2])) {
+        events[i] = events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+
+    events[i] = event;
+}
+
+static sim_event_t sim_event_pop() {
+    sim_event_t first = events[0];
+    sim_event_t last = events[--event_count];
+    uint32_t i = 0;
+
+    while(true) {
+        uint32_t child = 2 * i + 1;
+
+        if(child >= event_count) {
+            break;
+        }
+
+        if(child + 1 < event_count && sim_event_before(&events[child + 1], &events[child])) {
+            child++;
+        }
+
+        if(!sim_event_before(&events[child], &last)) {
+            break;
+        }
+
+        events[i] = events[child];
+        i = child;
+    }
+
+    events[i] = last;
+    return first;
+}
+
+// ---------------------------- topology -------------------------------------
+
+static int sim_is_neighbor(uint32_t i, uint32_t j) {
+    uint32_t k;
+
+    for(k = 0; k < nodes[i].neighbor_count; ++k) {
+        if(nodes[i].neighbors[k] == j) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** connect all nodes within range of each other */
+static void sim_topology_update() {
+    double range2 = scenario.range * scenario.range * (1 + 1e-9);
+    uint32_t i, j;
+
+    for(i = 0; i < scenario.nodes; ++i) {
+        nodes[i].neighbor_count = 0;
+    }
+
+    for(i = 0; i < scenario.nodes; ++i) {
+        for(j = i + 1; j < scenario.nodes; ++j) {
+            double dx = nodes[i].x - nodes[j].x;
+            double dy = nodes[i].y - nodes[j].y;
+
+            if(dx * dx + dy * dy > range2) {
+                continue;
+            }
+
+            uint32_t ends[2] = { i, j };
+            uint32_t e;
+
+            for(e = 0; e < 2; ++e) {
+                sim_node_t* node = &nodes[ends[e]];
+                uint32_t count = node->neighbor_count;
+
+                // grow at powers of two
+                if((count & (count - 1)) == 0) {
+                    node->neighbors = realloc(node->neighbors, (count ? 2 * count : 1) * sizeof(uint32_t));
+
+                    if(node->neighbors == NULL) {
+                        fprintf(stderr, "out of memory for neighbors\n");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+
+                node->neighbors[node->neighbor_count++] = ends[1 - e];
+            }
+        }
+    }
+
+    topology_version++;
+}
+
+/** shortest paths in hops from src into hops_out, UINT16_MAX if unreachable */
+static void sim_bfs(uint32_t src, uint16_t* hops_out, uint32_t* queue) {
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    uint32_t i;
+
+    for(i = 0; i < scenario.nodes; ++i) {
+        hops_out[i] = UINT16_MAX;
+    }
+
+    hops_out[src] = 0;
+    queue[tail++] = src;
+
+    while(head < tail) {
+        uint32_t at = queue[head++];
+
+        for(i = 0; i < nodes[at].neighbor_count; ++i) {
+            uint32_t next = nodes[at].neighbors[i];
+
+            if(hops_out[next] == UINT16_MAX) {
+                hops_out[next] = hops_out[at] + 1;
+                queue[tail++] = next;
+            }
+        }
+    }
+}
+
+/** hops on the shortest path from src to dst in the current topology */
+static uint16_t sim_shortest(uint32_t src, uint32_t dst) {
+    if(hops_src != src || hops_version != topology_version) {
+        uint32_t* queue = malloc(scenario.nodes * sizeof(uint32_t));
+        sim_bfs(src, hops_from, queue);
+        free(queue);
+        hops_src = src;
+        hops_version = topology_version;
+    }
+
+    return hops_from[dst];
+}
+
+static int sim_move_cmp(const void* a, const void* b) {
+    const sim_move_t* ma = a;
+    const sim_move_t* mb = b;
+    return (ma->at > mb->at) - (ma->at < mb->at);
+}
+
+static int sim_trace_load(const char* path) {
+    FILE* file = fopen(path, "r");
+
+    if(file == NULL) {
+        fprintf(stderr, "could not open trace %s\n", path);
+        return false;
+    }
+
+    uint32_t capacity = 0;
+    char line[256];
+    uint32_t line_no = 0;
+
+    while(fgets(line, sizeof(line), file)) {
+        double t, x, y;
+        uint32_t node;
+        line_no++;
+
+        if(line[strspn(line, " \t")] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        }
+
+        if(sscanf(line, "%lf %" SCNu32 " %lf %lf", &t, &node, &x, &y) != 4 || t < 0 || node >= scenario.nodes) {
+            fprintf(stderr, "%s:%" PRIu32 ": expected <time s> <node below %" PRIu32 "> <x> <y>\n", path, line_no, scenario.nodes);
+            fclose(file);
+            return false;
+        }
+
+        if(move_count == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            moves = realloc(moves, capacity * sizeof(*moves));
+        }
+
+        sim_move_t move = { (uint64_t)(t * 1000000), node, x, y };
+        moves[move_count++] = move;
+    }
+
+    fclose(file);
+    qsort(moves, move_count, sizeof(*moves), sim_move_cmp);
+
+    // positions at time 0
+    uint8_t* placed = calloc(scenario.nodes, 1);
+    uint32_t missing = scenario.nodes;
+
+    for(move_next = 0; move_next < move_count && moves[move_next].at == 0; ++move_next) {
+        sim_move_t* move = &moves[move_next];
+        nodes[move->node].x = move->x;
+        nodes[move->node].y = move->y;
+        missing -= !placed[move->node];
+        placed[move->node] = 1;
+    }
+
+    free(placed);
+
+    if(missing) {
+        fprintf(stderr, "%s: %" PRIu32 " nodes have no position at time 0\n", path, missing);
+        return false;
+    }
+
+    return true;
+}
+
+static int sim_topology_init() {
+    uint32_t i;
+    uint32_t side = (uint32_t) ceil(sqrt(scenario.nodes));
+    // area in which the mean number of nodes within range is degree
+    double geo_side = sqrt(scenario.nodes * M_PI * scenario.range * scenario.range / scenario.degree);
+
+    for(i = 0; i < scenario.nodes; ++i) {
+        switch(scenario.topology) {
+            case SIM_TOPOLOGY_GRID:
+                nodes[i].x = i % side;
+                nodes[i].y = i / side;
+                break;
+            case SIM_TOPOLOGY_LINE:
+                nodes[i].x = i;
+                nodes[i].y = 0;
+                break;
+            case SIM_TOPOLOGY_GEO:
+                nodes[i].x = sim_uniform() * geo_side;
+                nodes[i].y = sim_uniform() * geo_side;
+                break;
+            case SIM_TOPOLOGY_TRACE:
+                break;
+        }
+    }
+
+    if(scenario.topology == SIM_TOPOLOGY_TRACE && !sim_trace_load(scenario.trace)) {
+        return false;
+    }
+
+    sim_topology_update();
+
+    if(move_next < move_count) {
+        sim_event_add(moves[move_next].at, SIM_EVENT_MOVE, 0, NULL);
+    }
+
+    return true;
+}
+
+static void sim_handle_move() {
+    uint64_t at = moves[move_next].at;
+
+    for(; move_next < move_count && moves[move_next].at == at; ++move_next) {
+        nodes[moves[move_next].node].x = moves[move_next].x;
+        nodes[moves[move_next].node].y = moves[move_next].y;
+    }
+
+    sim_topology_update();
+
+    if(move_next < move_count) {
+        sim_event_add(moves[move_next].at, SIM_EVENT_MOVE, 0, NULL);
+    }
+}
+
+// ---------------------------- radio ----------------------------------------
+
+static sim_class_t sim_classify(const dessert_msg_t* msg) {
+    if(dessert_msg_getext(msg, NULL, HELLO_EXT_TYPE, 0)) {
+        return SIM_CLASS_HELLO;
+    }
+    if(dessert_msg_getext(msg, NULL, RREQ_EXT_TYPE, 0)) {
+        return SIM_CLASS_RREQ;
+    }
+    if(dessert_msg_getext(msg, NULL, RREP_EXT_TYPE, 0)) {
+        return SIM_CLASS_RREP;
+    }
+    if(dessert_msg_getext(msg, NULL, RERR_EXT_TYPE, 0)) {
+        return SIM_CLASS_RERR;
+    }
+    return SIM_CLASS_DATA;
+}
+
+static void sim_deliver(uint32_t receiver, uint64_t at, const dessert_msg_t* frame) {
+    dessert_msg_t* copy;
+
+    if(dessert_msg_clone(&copy, frame, false) != DESSERT_OK) {
+        fprintf(stderr, "out of memory for frames\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sim_event_add(at, SIM_EVENT_RX, receiver, copy);
+}
+
+/* sends on the only interface of the loaded node, whatever iface is */
+int dessert_meshsend(const dessert_msg_t* msgin, dessert_meshif_t* iface) {
+    sim_node_t* sender = &nodes[loaded];
+    dessert_msg_t* frame;
+
+    if(dessert_msg_clone(&frame, msgin, true) != DESSERT_OK) {
+        return DESSERT_ERR;
+    }
+
+    // like libdessert, the source of every frame is the interface it leaves on
+    mac_copy(frame->l2h.ether_shost, sender->hwaddr);
+
+    uint32_t bytes = frame->hlen + frame->plen;
+    uint64_t airtime = SIM_PHY_OVERHEAD + (uint64_t) bytes * 8 * 1000000 / SIM_BITRATE;
+    uint64_t start = (sender->tx_free_at > sim_now ? sender->tx_free_at : sim_now) + sim_rand() % SIM_BACKOFF;
+    uint64_t end = start + airtime;
+
+    if(mac_equal(frame->l2h.ether_dhost, ether_broadcast)) {
+        uint32_t k;
+
+        for(k = 0; k < sender->neighbor_count; ++k) {
+            if(sim_uniform() < scenario.loss) {
+                frames_lost++;
+                continue;
+            }
+
+            sim_deliver(sender->neighbors[k], end, frame);
+        }
+    }
+    else {
+        uint32_t receiver = sim_hwaddr_node(frame->l2h.ether_dhost);
+        int reachable = receiver != UINT32_MAX && sim_is_neighbor(loaded, receiver);
+        uint32_t tries = 1;
+
+        while(reachable && sim_uniform() < scenario.loss && tries <= SIM_UNICAST_RETRIES) {
+            end += SIM_BACKOFF + airtime;
+            tries++;
+        }
+
+        if(reachable && tries <= SIM_UNICAST_RETRIES) {
+            sim_deliver(receiver, end, frame);
+        }
+        else {
+            frames_lost++;
+        }
+    }
+
+    sender->tx_free_at = end;
+
+    if(sim_now >= sim_measure_from) {
+        sim_class_t class = sim_classify(frame);
+        sender->tx_bytes[class] += bytes;
+        sender->tx_frames[class]++;
+    }
+
+    dessert_msg_destroy(frame);
+    return DESSERT_OK;
+}
+
+/* the sys interface of the loaded node, counts data packets of the flows */
+int dessert_syssend_msg(dessert_msg_t* msg) {
+    struct ether_header* l25h = dessert_msg_getl25ether(msg);
+
+    if(l25h == NULL || !mac_equal(l25h->ether_dhost, nodes[loaded].l25) || msg->plen < sizeof(sim_payload_t)) {
+        return DESSERT_OK;
+    }
+
+    sim_payload_t* payload = (sim_payload_t*)((uint8_t*) msg + msg->hlen);
+
+    if(payload->magic != SIM_PAYLOAD_MAGIC || payload->flow >= scenario.flows) {
+        return DESSERT_OK;
+    }
+
+    sim_flow_t* flow = &flows[payload->flow];
+    flow->delivered++;
+    aodv_hist_add(&delay_us, sim_now - payload->sent_us);
+
+    uint16_t shortest = sim_shortest(flow->src, flow->dst);
+
+    if(shortest != UINT16_MAX && shortest > 0) {
+        double stretch = (double) msg->u8 / shortest;
+        stretch_sum += stretch;
+        stretch_count++;
+
+        if(stretch > stretch_max) {
+            stretch_max = stretch;
+        }
+    }
+
+    return DESSERT_OK;
+}
+
+// ---------------------------- node events ----------------------------------
+
+static void sim_timer_wakeup(struct timeval* deadline) {
+    sim_node_t* node = &nodes[loaded];
+    uint64_t at = sim_tv_to_us(deadline);
+
+    if(at < sim_now) {
+        at = sim_now;
+    }
+
+    if(!node->timer_armed || at < node->timer_at) {
+        node->timer_armed = true;
+        node->timer_at = at;
+        sim_event_add(at, SIM_EVENT_TIMER, loaded, NULL);
+    }
+}
+
+static void sim_handle_rx(uint32_t i, dessert_msg_t* msg) {
+    dessert_msg_proc_t proc;
+    uint32_t len = msg->hlen + msg->plen;
+    uint32_t k;
+
+    memset(&proc, 0, sizeof(proc));
+    sim_load(i);
+
+    for(k = 0; k < sizeof(sim_mesh_cbs) / sizeof(sim_mesh_cbs[0]); ++k) {
+        if(sim_mesh_cbs[k](msg, len, &proc, nodes[i].iface, events_run) == DESSERT_MSG_DROP) {
+            break;
+        }
+    }
+
+    dessert_msg_destroy(msg);
+}
+
+static void sim_handle_timer(uint32_t i, uint64_t at) {
+    sim_node_t* node = &nodes[i];
+
+    if(!node->timer_armed || node->timer_at != at) {
+        return; // superseded by an earlier deadline
+    }
+
+    node->timer_armed = false;
+    sim_load(i);
+
+    struct timeval now, next;
+    gettimeofday(&now, NULL);
+
+    if(aodv_timer_run_once(&now, &next)) {
+        // the real engine cannot run back to back either
+        if(sim_tv_to_us(&next) < sim_now + SIM_TIMER_MIN) {
+            hf_uint64_to_tv(hf_tv_to_ms(&now) + SIM_TIMER_MIN / 1000, &next);
+        }
+
+        aodv_timer_wakeup(&next);
+    }
+}
+
+static void sim_handle_hello(uint32_t i) {
+    sim_load(i);
+    aodv_periodic_send_hello(NULL, NULL, NULL);
+    sim_event_add(sim_now + hello_interval * 1000, SIM_EVENT_HELLO, i, NULL);
+}
+
+static void sim_handle_data(uint32_t f) {
+    sim_flow_t* flow = &flows[f];
+    dessert_msg_t* msg;
+    dessert_ext_t* ext;
+    dessert_msg_proc_t proc;
+    uint32_t k;
+
+    sim_load(flow->src);
+    dessert_msg_new(&msg);
+    dessert_msg_addext(msg, &ext, DESSERT_EXT_ETH, ETHER_HDR_LEN);
+    struct ether_header* l25h = (struct ether_header*) ext->data;
+    mac_copy(l25h->ether_shost, nodes[flow->src].l25);
+    mac_copy(l25h->ether_dhost, nodes[flow->dst].l25);
+    l25h->ether_type = htons(SIM_ETHERTYPE);
+
+    dessert_msg_dummy_payload(msg, scenario.payload);
+    sim_payload_t payload = { SIM_PAYLOAD_MAGIC, f, sim_now };
+    memcpy((uint8_t*) msg + msg->hlen, &payload, sizeof(payload));
+
+    memset(&proc, 0, sizeof(proc));
+    flow->sent++;
+
+    for(k = 0; k < sizeof(sim_sys_cbs) / sizeof(sim_sys_cbs[0]); ++k) {
+        if(sim_sys_cbs[k](msg, msg->hlen + msg->plen, &proc, &sim_sysif, events_run) == DESSERT_MSG_DROP) {
+            break;
+        }
+    }
+
+    dessert_msg_destroy(msg);
+
+    uint64_t next = sim_now + (uint64_t) scenario.interval * 1000;
+
+    if(next < (uint64_t)(scenario.duration - SIM_DRAIN) * 1000000) {
+        sim_event_add(next, SIM_EVENT_DATA, f, NULL);
+    }
+}
+
+// ---------------------------- setup ----------------------------------------
+
+static int sim_nodes_init() {
+    uint32_t i;
+
+    state_fd = memfd_create("mesh_node_state", 0);
+
+    if(state_fd < 0 || ftruncate(state_fd, (off_t) scenario.nodes * sim_state_size()) != 0) {
+        perror("creating node state");
+        return false;
+    }
+
+    // the daemon has not run yet, so this is the state of a fresh node
+    for(i = 0; i < scenario.nodes; ++i) {
+        if(pwrite(state_fd, mesh_node_state_start, sim_state_size(), (off_t) i * sim_state_size()) != (ssize_t) sim_state_size()) {
+            perror("initializing node state");
+            return false;
+        }
+    }
+
+    for(i = 0; i < scenario.nodes; ++i) {
+        sim_node_t* node = &nodes[i];
+        sim_addr(0x01, i, node->l25);
+        sim_addr(0x00, i, node->hwaddr);
+
+        sim_load(i);
+        mac_copy(dessert_l25_defsrc, node->l25);
+        node->iface = dessert_stub_meshif_add(node->hwaddr, "sim0");
+
+        if(node->iface == NULL || !aodv_db_init()) {
+            fprintf(stderr, "could not set up node %" PRIu32 "\n", i);
+            return false;
+        }
+
+        aodv_discovery_init_external();
+        aodv_timer_init_external(sim_timer_wakeup);
+
+        // HELLOs of all nodes spread over one interval
+        sim_event_add(sim_rand() % (hello_interval * 1000), SIM_EVENT_HELLO, i, NULL);
+    }
+
+    return true;
+}
+
+static int sim_flows_init() {
+    uint16_t* hops = malloc(scenario.nodes * sizeof(uint16_t));
+    uint32_t* queue = malloc(scenario.nodes * sizeof(uint32_t));
+    uint32_t f;
+
+    // only connected pairs, partitions say nothing about the protocol
+    for(f = 0; f < scenario.flows; ++f) {
+        sim_flow_t* flow = &flows[f];
+        uint32_t attempts = 0;
+
+        do {
+            if(++attempts > 1000) {
+                fprintf(stderr, "could not find connected nodes for flow %" PRIu32 "\n", f);
+                free(hops);
+                free(queue);
+                return false;
+            }
+
+            flow->src = sim_rand() % scenario.nodes;
+            flow->dst = sim_rand() % scenario.nodes;
+            sim_bfs(flow->src, hops, queue);
+        }
+        while(flow->src == flow->dst || hops[flow->dst] == UINT16_MAX);
+
+        sim_event_add(sim_measure_from + sim_rand() % ((uint64_t) scenario.interval * 1000), SIM_EVENT_DATA, f, NULL);
+    }
+
+    free(hops);
+    free(queue);
+    return true;
+}
+
+// ---------------------------- report ---------------------------------------
+
+static void sim_report(uint64_t wall) {
+    double seconds = scenario.duration - scenario.warmup;
+    uint32_t n = scenario.nodes;
+    uint32_t i, c;
+
+    // topology at the end of the run
+    uint64_t links = 0;
+    uint32_t diameter = 0;
+    uint16_t* hops = malloc(n * sizeof(uint16_t));
+    uint32_t* queue = malloc(n * sizeof(uint32_t));
+
+    for(i = 0; i < n; ++i) {
+        links += nodes[i].neighbor_count;
+        sim_bfs(i, hops, queue);
+
+        uint32_t j;
+
+        for(j = 0; j < n; ++j) {
+            if(hops[j] != UINT16_MAX && hops[j] > diameter) {
+                diameter = hops[j];
+            }
+        }
+    }
+
+    free(hops);
+    free(queue);
+
+    printf("scenario     %s, %" PRIu32 " nodes, loss %.1f%%, %" PRIu32 " s after %" PRIu32 " s warmup, seed %" PRIu64 "\n",
+           sim_topology_names[scenario.topology], n, scenario.loss * 100, scenario.duration - scenario.warmup, scenario.warmup, scenario.seed);
+    printf("topology     mean degree %.1f, diameter %" PRIu32 " hops\n", (double) links / n, diameter);
+
+    // control overhead
+    uint64_t bytes[SIM_CLASS_COUNT] = { 0 };
+    uint64_t frames[SIM_CLASS_COUNT] = { 0 };
+    uint64_t ctrl_max = 0;
+
+    for(i = 0; i < n; ++i) {
+        uint64_t ctrl = 0;
+
+        for(c = 0; c < SIM_CLASS_COUNT; ++c) {
+            bytes[c] += nodes[i].tx_bytes[c];
+            frames[c] += nodes[i].tx_frames[c];
+
+            if(c != SIM_CLASS_DATA) {
+                ctrl += nodes[i].tx_bytes[c];
+            }
+        }
+
+        if(ctrl > ctrl_max) {
+            ctrl_max = ctrl;
+        }
+    }
+
+    uint64_t ctrl_bytes = 0;
+    uint64_t ctrl_frames = 0;
+
+    for(c = 0; c < SIM_CLASS_DATA; ++c) {
+        ctrl_bytes += bytes[c];
+        ctrl_frames += frames[c];
+    }
+
+    printf("control      %.0f bytes/node/s (max node %.0f), %.2f frames/node/s\n",
+           ctrl_bytes / seconds / n, ctrl_max / seconds, ctrl_frames / seconds / n);
+    printf("             ");
+
+    for(c = 0; c < SIM_CLASS_COUNT; ++c) {
+        printf("%s %.0f B/%.2f fr%s", sim_class_names[c], bytes[c] / seconds / n, frames[c] / seconds / n, c + 1 < SIM_CLASS_COUNT ? ", " : "\n");
+    }
+
+    // discovery, merged over all nodes
+    aodv_discovery_stats_t total;
+    uint64_t retries = 0;
+    memset(&total, 0, sizeof(total));
+
+    for(i = 0; i < n; ++i) {
+        aodv_discovery_stats_t stats;
+        sim_load(i);
+        aodv_discovery_stats(&stats);
+        total.succeeded += stats.succeeded;
+        total.failed += stats.failed;
+        aodv_hist_merge(&total.latency_us, &stats.latency_us);
+
+        for(c = 0; c <= RREQ_RETRIES; ++c) {
+            retries += c * stats.retries[c];
+        }
+    }
+
+    uint64_t finished = total.succeeded + total.failed;
+    printf("discovery    %" PRIu64 " finished, %" PRIu64 " failed, %.2f retries each, latency ms p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+           finished, total.failed, finished ? (double) retries / finished : 0.0,
+           aodv_hist_percentile(&total.latency_us, 0.5) / 1000.0, aodv_hist_percentile(&total.latency_us, 0.9) / 1000.0,
+           aodv_hist_percentile(&total.latency_us, 0.99) / 1000.0, total.latency_us.max / 1000.0);
+
+    // delivery
+    uint64_t sent = 0;
+    uint64_t delivered = 0;
+
+    for(i = 0; i < scenario.flows; ++i) {
+        sent += flows[i].sent;
+        delivered += flows[i].delivered;
+    }
+
+    printf("delivery     %" PRIu64 " of %" PRIu64 " packets in %" PRIu32 " flows (%.1f%%), delay ms p50 %.1f p99 %.1f, %" PRIu64 " frames lost\n",
+           delivered, sent, scenario.flows, sent ? 100.0 * delivered / sent : 0.0,
+           aodv_hist_percentile(&delay_us, 0.5) / 1000.0, aodv_hist_percentile(&delay_us, 0.99) / 1000.0, frames_lost);
+    printf("stretch      mean %.3f, max %.2f\n", stretch_count ? stretch_sum / stretch_count : 0.0, stretch_max);
+    printf("simulation   %" PRIu64 " events in %.2f s, %.1fx real time, %zu bytes state per node\n\n",
+           events_run, wall / 1e9, scenario.duration / (wall / 1e9), sim_state_size());
+}
+
+// ---------------------------- main -----------------------------------------
+
+static void sim_usage(const char* name) {
+    fprintf(stderr,
+            "usage: %s [-t grid|line|geo] [-T trace] [-n nodes] [-r range] [-g degree] [-l loss]\n"
+            "          [-d duration s] [-w warmup s] [-f flows] [-i interval ms] [-p payload bytes]\n"
+            "          [-R ring search 0|1] [-s seed]\n", name);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    int c;
+
+    while((c = getopt(argc, argv, "t:T:n:r:g:l:d:w:f:i:p:R:s:")) != -1) {
+        switch(c) {
+            case 't':
+                for(scenario.topology = SIM_TOPOLOGY_GRID; scenario.topology < SIM_TOPOLOGY_TRACE; scenario.topology++) {
+                    if(strcmp(optarg, sim_topology_names[scenario.topology]) == 0) {
+                        break;
+                    }
+                }
+                if(scenario.topology == SIM_TOPOLOGY_TRACE) {
+                    sim_usage(argv[0]);
+                }
+                break;
+            case 'T':
+                scenario.topology = SIM_TOPOLOGY_TRACE;
+                scenario.trace = optarg;
+                break;
+            case 'n':
+                scenario.nodes = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                scenario.range = strtod(optarg, NULL);
+                break;
+            case 'g':
+                scenario.degree = strtod(optarg, NULL);
+                break;
+            case 'l':
+                scenario.loss = strtod(optarg, NULL);
+                break;
+            case 'd':
+                scenario.duration = strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                scenario.warmup = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                scenario.flows = strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                scenario.interval = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                scenario.payload = strtoul(optarg, NULL, 10);
+                break;
+            case 'R':
+                ring_search = strtoul(optarg, NULL, 10) != 0;
+                break;
+            case 's':
+                scenario.seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                sim_usage(argv[0]);
+        }
+    }
+
+    if(scenario.nodes < 2 || scenario.range <= 0 || scenario.degree <= 0 || scenario.loss < 0 || scenario.loss >= 1
+       || scenario.duration < scenario.warmup + SIM_DRAIN + 1 || scenario.interval == 0
+       || scenario.payload < sizeof(sim_payload_t) || scenario.payload > DESSERT_MAXFRAMELEN - 128) {
+        sim_usage(argv[0]);
+    }
+
+    rng_state = scenario.seed * UINT64_C(0x9E3779B97F4A7C15) | 1;
+    srandom(scenario.seed);
+    sim_measure_from = (uint64_t) scenario.warmup * 1000000;
+
+    nodes = calloc(scenario.nodes, sizeof(*nodes));
+    flows = calloc(scenario.flows ? scenario.flows : 1, sizeof(*flows));
+    hops_from = malloc(scenario.nodes * sizeof(uint16_t));
+
+    if(nodes == NULL || flows == NULL || hops_from == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    if(!sim_topology_init() || !sim_nodes_init() || !sim_flows_init()) {
+        return EXIT_FAILURE;
+    }
+
+    uint64_t end = (uint64_t) scenario.duration * 1000000;
+    uint64_t wall_start = wall_ns();
+
+    while(event_count > 0 && events[0].at <= end) {
+        sim_event_t event = sim_event_pop();
+        sim_now = event.at;
+        events_run++;
+
+        switch(event.type) {
+            case SIM_EVENT_RX:
+                sim_handle_rx(event.node, event.msg);
+                break;
+            case SIM_EVENT_TIMER:
+                sim_handle_timer(event.node, event.at);
+                break;
+            case SIM_EVENT_HELLO:
+                sim_handle_hello(event.node);
+                break;
+            case SIM_EVENT_DATA:
+                sim_handle_data(event.node);
+                break;
+            case SIM_EVENT_MOVE:
+                sim_handle_move();
+                continue;
+        }
+
+        // commands the event posted to the discovery engine of the node
+        aodv_discovery_run_pending();
+    }
+
+    sim_report(wall_ns() - wall_start);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+/*
+ * Micro-benchmark of pb_push_packet: the cost of buffering one packet must
+ * not grow with the number of packets already buffered. 10000 packets are
+ * pushed, once for a single destination and once spread over 100
+ * destinations, and the mean cost of every block of 1000 pushes is printed.
+ * Fails if the last block is more than PB_BENCH_MAX_RATIO times slower than
+ * the first one.
+ */
+
+#include <time.h>
+#include "../src/config.h"
+#include "../src/database/packet_buffer/packet_buffer.h"
+
+#define PB_BENCH_PACKETS	10000
+#define PB_BENCH_BLOCK		1000
+#define PB_BENCH_MAX_RATIO	3.0
+
+uint32_t pb_dest_max_packets = PB_BENCH_PACKETS;
+uint32_t pb_dest_max_bytes = UINT32_MAX;
+uint32_t pb_max_bytes = UINT32_MAX;
+aodv_pb_policy_t pb_policy = PB_POLICY;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int run(const char* name, uint32_t destinations) {
+    dessert_msg_t* msg;
+    struct timeval timestamp;
+    double first = 0, last = 0;
+    uint32_t i, j;
+
+    if(!pb_init() || dessert_stub_msg_new(&msg, 64, 1000) != DESSERT_OK) {
+        fprintf(stderr, "setup failed\n");
+        return false;
+    }
+
+    gettimeofday(&timestamp, NULL);
+    printf("%s\n%10s %14s\n", name, "buffered", "ns per push");
+
+    for(i = 0; i < PB_BENCH_PACKETS; i += PB_BENCH_BLOCK) {
+        uint64_t start = now_ns();
+
+        for(j = i; j < i + PB_BENCH_BLOCK; ++j) {
+            mac_addr dest = {0x02, 0, 0, 0, (j % destinations) >> 8, (j % destinations) & 0xff};
+            pb_push_packet(dest, msg, &timestamp);
+        }
+
+        double per_push = (double)(now_ns() - start) / PB_BENCH_BLOCK;
+
+        if(i == 0) {
+            first = per_push;
+        }
+
+        last = per_push;
+        printf("%10" PRIu32 " %14.1f\n", i + PB_BENCH_BLOCK, per_push);
+    }
+
+    aodv_pb_stats_t stats;
+    pb_stats(&stats);
+    dessert_msg_destroy(msg);
+
+    double ratio = last / first;
+    printf("last/first block = %.2f (limit %.1f)\n\n", ratio, PB_BENCH_MAX_RATIO);
+    return stats.packets == PB_BENCH_PACKETS && ratio <= PB_BENCH_MAX_RATIO;
+}
+
+int main(int argc, char** argv) {
+    int ok = true;
+    ok &= run("pb_push: 1 destination", 1);
+    ok &= run("pb_push: 100 destinations", 100);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
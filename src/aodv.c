@@ -32,6 +32,9 @@ For further information and questions please use the web site
 #include "cli/aodv_cli.h"
 #include "pipeline/aodv_pipeline.h"
 #include "database/aodv_database.h"
+#include "pipeline/aodv_timer.h"
+#include "pipeline/aodv_discovery.h"
+#include "pipeline/aodv_stats.h"
 
 uint16_t hello_size = HELLO_SIZE;
 uint16_t hello_interval = HELLO_INTERVAL;
@@ -46,14 +49,34 @@ uint16_t metric_startvalue = AODV_METRIC_STARTVAL;
 uint16_t rreq_interval = RREQ_INTERVAL;
 int8_t signal_strength_threshold = AODV_SIGNAL_STRENGTH_THRESHOLD;
 uint16_t tracking_factor = PDR_TRACKING_FACTOR;
+uint32_t pb_dest_max_packets = PB_DEST_MAX_PACKETS;
+uint32_t pb_dest_max_bytes = PB_DEST_MAX_BYTES;
+uint32_t pb_max_bytes = PB_MAX_BYTES;
+aodv_pb_policy_t pb_policy = PB_POLICY;
 
 dessert_periodic_t* send_hello_periodic;
 dessert_periodic_t* send_rreq_periodic;
 
+/* every registered callback is wrapped to count its packets in aodv_stats */
+AODV_STATS_MESH_CB(dessert_msg_check_cb, AODV_CB_MSG_CHECK)
+AODV_STATS_MESH_CB(dessert_msg_ifaceflags_cb, AODV_CB_IFACEFLAGS)
+AODV_STATS_MESH_CB(aodv_drop_errors, AODV_CB_DROP_ERRORS)
+AODV_STATS_MESH_CB(aodv_handle_hello, AODV_CB_HANDLE_HELLO)
+AODV_STATS_MESH_CB(aodv_handle_rreq, AODV_CB_HANDLE_RREQ)
+AODV_STATS_MESH_CB(aodv_handle_rerr, AODV_CB_HANDLE_RERR)
+AODV_STATS_MESH_CB(aodv_handle_rrep, AODV_CB_HANDLE_RREP)
+AODV_STATS_MESH_CB(dessert_mesh_ipttl, AODV_CB_MESH_IPTTL)
+AODV_STATS_MESH_CB(aodv_forward_broadcast, AODV_CB_FORWARD_BROADCAST)
+AODV_STATS_MESH_CB(aodv_forward_multicast, AODV_CB_FORWARD_MULTICAST)
+AODV_STATS_MESH_CB(aodv_forward, AODV_CB_FORWARD)
+AODV_STATS_MESH_CB(aodv_local_unicast, AODV_CB_LOCAL_UNICAST)
+
+AODV_STATS_SYS_CB(dessert_sys_drop_ipv6, AODV_CB_SYS_DROP_IPV6)
+AODV_STATS_SYS_CB(aodv_sys_drop_multicast, AODV_CB_SYS_DROP_MULTICAST)
+AODV_STATS_SYS_CB(aodv_sys2rp, AODV_CB_SYS2RP)
+
 static void register_names() {
     dessert_register_ptr_name((void*)aodv_periodic_send_hello, "aodv_periodic_send_hello");
-    dessert_register_ptr_name((void*)aodv_periodic_cleanup_database, "aodv_periodic_cleanup_database");
-    dessert_register_ptr_name((void*)aodv_periodic_scexecute, "aodv_periodic_scexecute");
     dessert_register_ptr_name((void*)aodv_periodic_send_rreq, "aodv_periodic_send_rreq");
 }
 
@@ -155,35 +178,60 @@ int main(int argc, char** argv) {
     cli_register_command(dessert_cli, dessert_cli_set, "gossip_p", cli_set_gossip_p, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "set p for gossip  p in [0.0,...,1.0]");
     cli_register_command(dessert_cli, dessert_cli_show, "gossip_p", cli_show_gossip_p, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show p for gossip p in [0.0,...,1.0]");
 
+    cli_register_command(dessert_cli, dessert_cli_set, "rate_limit", cli_set_rate_limit, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "set control message rate limit");
+    cli_register_command(dessert_cli, dessert_cli_show, "rate_limit", cli_show_rate_limit, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show control message rate limits");
+
+    cli_register_command(dessert_cli, dessert_cli_set, "packet_buffer_dest_packets", cli_set_packet_buffer_dest_packets, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "set max buffered packets per destination");
+    cli_register_command(dessert_cli, dessert_cli_set, "packet_buffer_dest_bytes", cli_set_packet_buffer_dest_bytes, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "set max buffered bytes per destination");
+    cli_register_command(dessert_cli, dessert_cli_set, "packet_buffer_budget", cli_set_packet_buffer_budget, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "set max buffered bytes in total");
+    cli_register_command(dessert_cli, dessert_cli_set, "packet_buffer_policy", cli_set_packet_buffer_policy, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "set packet buffer drop policy");
+    cli_register_command(dessert_cli, dessert_cli_show, "packet_buffer", cli_show_packet_buffer, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show packet buffer occupancy and drops");
+
     cli_register_command(dessert_cli, dessert_cli_set, "dest_only", cli_set_dest_only, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "set destonly mode");
     cli_register_command(dessert_cli, dessert_cli_set, "ring_search", cli_set_ring_search, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "set ring_search  On/Off");
 
-    cli_register_command(dessert_cli, dessert_cli_show, "rt", cli_show_rt, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show routing table");
-    cli_register_command(dessert_cli, dessert_cli_show, "pdr_nt", cli_show_pdr_nt, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show pdr tracking table");
+    cli_register_command(dessert_cli, dessert_cli_show, "rt", cli_show_rt, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show routing table [destination MAC] [next_hop MAC] [offset N] [limit N] [format table|csv|json]");
+    cli_register_command(dessert_cli, dessert_cli_show, "pdr_nt", cli_show_pdr_nt, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show pdr tracking table [neighbor MAC] [offset N] [limit N] [format table|csv|json]");
 
     cli_register_command(dessert_cli, dessert_cli_show, "neighbor_timeslot", cli_show_neighbor_timeslot, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show neighbor table timeslot");
     cli_register_command(dessert_cli, dessert_cli_show, "packet_buffer_timeslot", cli_show_packet_buffer_timeslot, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show packet buffer timeslot");
     cli_register_command(dessert_cli, dessert_cli_show, "data_seq_timeslot", cli_show_data_seq_timeslot, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show data seq timeslot");
+    cli_register_command(dessert_cli, dessert_cli_show, "schedule_lateness", cli_show_schedule_lateness, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show lateness of executed schedules");
+
+    struct cli_command* cli_clear = cli_register_command(dessert_cli, NULL, "clear", NULL, PRIVILEGE_PRIVILEGED, MODE_EXEC, "reset counters");
+    cli_register_command(dessert_cli, dessert_cli_show, "stats", cli_show_stats, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show packet counters per callback, drop reason and message type");
+    cli_register_command(dessert_cli, cli_clear, "stats", cli_clear_stats, PRIVILEGE_PRIVILEGED, MODE_EXEC, "reset packet counters");
+
+    struct cli_command* cli_show_disc = cli_register_command(dessert_cli, dessert_cli_show, "discovery", cli_show_discovery, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show route discovery latency, success and retries");
+    cli_register_command(dessert_cli, cli_show_disc, "destinations", cli_show_discovery_destinations, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show route discovery results per destination [destination MAC] [offset N] [limit N] [format table|csv|json]");
+    cli_register_command(dessert_cli, cli_clear, "discovery", cli_clear_discovery, PRIVILEGE_PRIVILEGED, MODE_EXEC, "reset route discovery statistics");
+
+    cli_register_command(dessert_cli, dessert_cli_set, "pipeline_profiling", cli_set_pipeline_profiling, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "time every pipeline callback [0, 1], 1 also clears the latencies");
+    struct cli_command* cli_show_pipeline = cli_register_command(dessert_cli, dessert_cli_show, "pipeline", NULL, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show pipeline");
+    cli_register_command(dessert_cli, cli_show_pipeline, "latency", cli_show_pipeline_latency, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show latency percentiles per pipeline callback");
+
+    cli_register_command(dessert_cli, dessert_cli_set, "lock_profiling", cli_set_lock_profiling, PRIVILEGE_PRIVILEGED, MODE_CONFIG, "measure wait and hold times of the database and pipeline locks [0, 1], 1 also clears them");
+    cli_register_command(dessert_cli, dessert_cli_show, "locks", cli_show_locks, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "show lock acquisitions, wait and hold times per lock and caller");
 
     cli_register_command(dessert_cli, NULL, "send_rreq", cli_send_rreq, PRIVILEGE_UNPRIVILEGED, MODE_EXEC, "send RREQ to destination");
 
     /* registering callbacks */
-    dessert_meshrxcb_add(dessert_msg_check_cb, 10);
-    dessert_meshrxcb_add(dessert_msg_ifaceflags_cb, 20);
-    dessert_meshrxcb_add(aodv_drop_errors, 30);
-    dessert_meshrxcb_add(aodv_handle_hello, 40);
-    dessert_meshrxcb_add(aodv_handle_rreq, 50);
-    dessert_meshrxcb_add(aodv_handle_rerr, 60);
-    dessert_meshrxcb_add(aodv_handle_rrep, 70);
-    dessert_meshrxcb_add(dessert_mesh_ipttl, 75);
-    dessert_meshrxcb_add(aodv_forward_broadcast, 80);
-    dessert_meshrxcb_add(aodv_forward_multicast, 81);
-    dessert_meshrxcb_add(aodv_forward, 90);
-    dessert_meshrxcb_add(aodv_local_unicast, 100);
-
-    dessert_sysrxcb_add(dessert_sys_drop_ipv6, 1);
-    dessert_sysrxcb_add(aodv_sys_drop_multicast, 3);
-    dessert_sysrxcb_add(aodv_sys2rp, 10);
+    dessert_meshrxcb_add(dessert_msg_check_cb_counted, 10);
+    dessert_meshrxcb_add(dessert_msg_ifaceflags_cb_counted, 20);
+    dessert_meshrxcb_add(aodv_drop_errors_counted, 30);
+    dessert_meshrxcb_add(aodv_handle_hello_counted, 40);
+    dessert_meshrxcb_add(aodv_handle_rreq_counted, 50);
+    dessert_meshrxcb_add(aodv_handle_rerr_counted, 60);
+    dessert_meshrxcb_add(aodv_handle_rrep_counted, 70);
+    dessert_meshrxcb_add(dessert_mesh_ipttl_counted, 75);
+    dessert_meshrxcb_add(aodv_forward_broadcast_counted, 80);
+    dessert_meshrxcb_add(aodv_forward_multicast_counted, 81);
+    dessert_meshrxcb_add(aodv_forward_counted, 90);
+    dessert_meshrxcb_add(aodv_local_unicast_counted, 100);
+
+    dessert_sysrxcb_add(dessert_sys_drop_ipv6_counted, 1);
+    dessert_sysrxcb_add(aodv_sys_drop_multicast_counted, 3);
+    dessert_sysrxcb_add(aodv_sys2rp_counted, 10);
 
     /* registering periodic tasks */
     struct timeval hello_interval_t;
@@ -192,15 +240,17 @@ int main(int argc, char** argv) {
     send_hello_periodic = dessert_periodic_add(aodv_periodic_send_hello, NULL, NULL, &hello_interval_t);
     dessert_notice("setting HELLO interval to %" PRIu16 " ms", hello_interval);
 
-    struct timeval cleanup_interval;
-    cleanup_interval.tv_sec = DB_CLEANUP_INTERVAL / 1000;
-    cleanup_interval.tv_usec = (DB_CLEANUP_INTERVAL % 1000) * 1000;
-    dessert_periodic_add(aodv_periodic_cleanup_database, NULL, NULL, &cleanup_interval);
+    /* database expiry, schedules and the gossip hold queue are driven by the timer engine */
+    if(!aodv_timer_init()) {
+        dessert_crit("could not start timer engine");
+        return EXIT_FAILURE;
+    }
 
-    struct timeval schedule_check_interval;
-    schedule_check_interval.tv_sec = SCHEDULE_CHECK_INTERVAL / 1000;
-    schedule_check_interval.tv_usec = (SCHEDULE_CHECK_INTERVAL % 1000) * 1000;
-    dessert_periodic_add(aodv_periodic_scexecute, NULL, NULL, &schedule_check_interval);
+    /* RREQ series are owned by the discovery engine */
+    if(!aodv_discovery_init()) {
+        dessert_crit("could not start discovery engine");
+        return EXIT_FAILURE;
+    }
 
     /* running cli & daemon */
     for(i = 0; i < used; ++i) {
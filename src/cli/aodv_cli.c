@@ -28,7 +28,11 @@ For further information and questions please use the web site
 #include "../config.h"
 #include "aodv_cli.h"
 #include "../database/aodv_database.h"
+#include "../database/lockstat.h"
 #include "../pipeline/aodv_pipeline.h"
+#include "../pipeline/aodv_ratelimit.h"
+#include "../pipeline/aodv_discovery.h"
+#include "../pipeline/aodv_stats.h"
 
 // -------------------- Testing ------------------------------------------------------------
 
@@ -197,11 +201,7 @@ int cli_send_rreq(struct cli_def* cli, char* command, char* argv[], int argc) {
 
     cli_print(cli, MAC " -> using %" AODV_PRI_METRIC " as initial_metric\n", EXPLODE_ARRAY6(host), initial_metric);
 
-    struct timeval ts;
-
-    gettimeofday(&ts, NULL);
-
-    aodv_send_rreq(host, &ts);
+    aodv_discovery_start(host);
 
     return CLI_OK;
 }
@@ -388,6 +388,312 @@ int cli_set_preemptive_rreq_signal_strength_threshold(struct cli_def* cli, char*
     return CLI_OK;
 }
 
+int cli_set_rate_limit(struct cli_def* cli, char* command, char* argv[], int argc) {
+    aodv_rate_class_t rate_class;
+
+    if(argc < 2 || argc > 3 || !aodv_ratelimit_parse(argv[0], &rate_class)) {
+        cli_print(cli, "usage %s [rreq_originate|rreq_forward|rerr|rrep|hello|control_budget] [rate per s, 0 is off] [burst]\n", command);
+        return CLI_ERROR;
+    }
+
+    uint32_t rate = strtoul(argv[1], NULL, 10);
+    uint32_t burst = (argc == 3) ? strtoul(argv[2], NULL, 10) : 0;
+    aodv_ratelimit_set(rate_class, rate, burst);
+
+    if(rate == 0) {
+        cli_print(cli, "rate limit for %s is off", argv[0]);
+        dessert_notice("rate limit for %s is off", argv[0]);
+    }
+    else {
+        aodv_ratelimit_info_t info;
+        aodv_ratelimit_get(rate_class, &info);
+        cli_print(cli, "rate limit for %s set to %" PRIu32 " per s, burst %" PRIu32 "", argv[0], info.rate, info.burst);
+        dessert_notice("rate limit for %s set to %" PRIu32 " per s, burst %" PRIu32 "", argv[0], info.rate, info.burst);
+    }
+
+    return CLI_OK;
+}
+
+int cli_show_rate_limit(struct cli_def* cli, char* command, char* argv[], int argc) {
+    int i;
+
+    cli_print(cli, "%-16s %10s %10s %12s %12s", "class", "rate/s", "burst", "passed", "limited");
+
+    for(i = 0; i < AODV_RATE_COUNT; ++i) {
+        aodv_ratelimit_info_t info;
+        aodv_ratelimit_get(i, &info);
+
+        if(info.rate == 0) {
+            cli_print(cli, "%-16s %10s %10s %12" PRIu64 " %12" PRIu64 "", aodv_ratelimit_name(i), "off", "-", info.passed, info.limited);
+        }
+        else {
+            cli_print(cli, "%-16s %10" PRIu32 " %10" PRIu32 " %12" PRIu64 " %12" PRIu64 "", aodv_ratelimit_name(i), info.rate, info.burst, info.passed, info.limited);
+        }
+    }
+
+    cli_print(cli, "(control_budget counts bytes of all classes)");
+    return CLI_OK;
+}
+
+int cli_show_stats(struct cli_def* cli, char* command, char* argv[], int argc) {
+    aodv_stats_t stats;
+    int i;
+
+    aodv_stats_get(&stats);
+
+    cli_print(cli, "%-26s %12s %12s %12s", "callback", "in", "passed", "dropped");
+    for(i = 0; i < AODV_CB_COUNT; ++i) {
+        cli_print(cli, "%-26s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "", aodv_stats_cb_name(i), stats.cb_in[i], stats.cb_pass[i], stats.cb_drop[i]);
+    }
+
+    cli_print(cli, "\n%-26s %12s", "drop reason", "packets");
+    for(i = 0; i < AODV_DROP_COUNT; ++i) {
+        cli_print(cli, "%-26s %12" PRIu64 "", aodv_stats_drop_name(i), stats.drop[i]);
+    }
+
+    cli_print(cli, "\n%-26s %12s", "control received", "packets");
+    for(i = 0; i < AODV_CTRL_COUNT; ++i) {
+        cli_print(cli, "%-26s %12" PRIu64 "", aodv_stats_ctrl_name(i), stats.ctrl_rx[i]);
+    }
+
+    cli_print(cli, "\n%-26s %12s", "control sent", "packets");
+    for(i = 0; i < AODV_RATE_BUDGET; ++i) {
+        cli_print(cli, "%-26s %12" PRIu64 "", aodv_ratelimit_name(i), stats.ctrl_tx[i]);
+    }
+
+    cli_print(cli, "\n%-26s %12s", "data", "packets");
+    for(i = 0; i < AODV_DATA_COUNT; ++i) {
+        cli_print(cli, "%-26s %12" PRIu64 "", aodv_stats_data_name(i), stats.data[i]);
+    }
+
+    return CLI_OK;
+}
+
+int cli_clear_stats(struct cli_def* cli, char* command, char* argv[], int argc) {
+    aodv_stats_reset();
+    cli_print(cli, "packet counters reset");
+    dessert_notice("packet counters reset");
+    return CLI_OK;
+}
+
+int cli_set_pipeline_profiling(struct cli_def* cli, char* command, char* argv[], int argc) {
+    uint32_t mode;
+
+    if(argc != 1 || sscanf(argv[0], "%" PRIu32 "", &mode) != 1 || (mode != 0 && mode != 1)) {
+        cli_print(cli, "usage of %s command [0, 1]\n", command);
+        return CLI_ERROR_ARG;
+    }
+
+    aodv_latency_enable(mode == 1);
+    dessert_notice("use pipeline_profiling = %s", mode == 1 ? "true" : "false");
+    return CLI_OK;
+}
+
+int cli_show_pipeline_latency(struct cli_def* cli, char* command, char* argv[], int argc) {
+    double cycles_per_ns = aodv_latency_cycles_per_ns();
+    int i;
+
+    if(!aodv_latency_enabled) {
+        cli_print(cli, "pipeline profiling is off (set pipeline_profiling 1), showing the last results");
+    }
+
+    cli_print(cli, "%-26s %12s %10s %10s %10s %10s %10s", "callback", "calls", "avg ns", "p50 ns", "p99 ns", "p999 ns", "max ns");
+
+    for(i = 0; i < AODV_CB_COUNT; ++i) {
+        aodv_hist_t hist;
+        aodv_latency_get(i, &hist);
+
+        uint64_t avg = hist.count ? hist.sum / hist.count : 0;
+        cli_print(cli, "%-26s %12" PRIu64 " %10.0f %10.0f %10.0f %10.0f %10.0f", aodv_stats_cb_name(i), hist.count,
+                  avg / cycles_per_ns,
+                  aodv_hist_percentile(&hist, 0.5) / cycles_per_ns,
+                  aodv_hist_percentile(&hist, 0.99) / cycles_per_ns,
+                  aodv_hist_percentile(&hist, 0.999) / cycles_per_ns,
+                  hist.max / cycles_per_ns);
+    }
+
+    cli_print(cli, "(%.3f cycles per ns, percentiles are upper bounds of their histogram bucket)", cycles_per_ns);
+    return CLI_OK;
+}
+
+int cli_set_lock_profiling(struct cli_def* cli, char* command, char* argv[], int argc) {
+    uint32_t mode;
+
+    if(argc != 1 || sscanf(argv[0], "%" PRIu32 "", &mode) != 1 || (mode != 0 && mode != 1)) {
+        cli_print(cli, "usage of %s command [0, 1]\n", command);
+        return CLI_ERROR_ARG;
+    }
+
+    lockstat_enable(mode == 1);
+    dessert_notice("use lock_profiling = %s", mode == 1 ? "true" : "false");
+    return CLI_OK;
+}
+
+// by lock name, caller and mode, so that several sites of one caller are adjacent
+static int cli_cmp_lockstat_site(const void* a, const void* b) {
+    const lockstat_data_t* x = a;
+    const lockstat_data_t* y = b;
+    int cmp = strcmp(x->site->lock_name, y->site->lock_name);
+
+    if(cmp == 0) {
+        cmp = strcmp(x->site->caller, y->site->caller);
+    }
+    if(cmp == 0) {
+        cmp = (int) x->site->mode - (int) y->site->mode;
+    }
+    return cmp;
+}
+
+// by lock name, then the callers waiting longest in total first
+static int cli_cmp_lockstat(const void* a, const void* b) {
+    const lockstat_data_t* x = a;
+    const lockstat_data_t* y = b;
+    int cmp = strcmp(x->site->lock_name, y->site->lock_name);
+
+    if(cmp != 0) {
+        return cmp;
+    }
+    return (x->wait.sum < y->wait.sum) - (x->wait.sum > y->wait.sum);
+}
+
+int cli_show_locks(struct cli_def* cli, char* command, char* argv[], int argc) {
+    double cycles_per_ns = aodv_latency_cycles_per_ns();
+    lockstat_data_t* entries;
+    uint32_t count, i;
+
+    if(!lockstat_snapshot(&entries, &count)) {
+        cli_print(cli, "out of memory");
+        return CLI_ERROR;
+    }
+
+    if(!lockstat_enabled) {
+        cli_print(cli, "lock profiling is off (set lock_profiling 1), showing the last results");
+    }
+
+    // a caller locking the same lock in several places is shown once
+    qsort(entries, count, sizeof(lockstat_data_t), cli_cmp_lockstat_site);
+    uint32_t merged = 0;
+    for(i = 0; i < count; ++i) {
+        if(merged > 0 && cli_cmp_lockstat_site(&entries[merged - 1], &entries[i]) == 0) {
+            entries[merged - 1].count += entries[i].count;
+            entries[merged - 1].contended += entries[i].contended;
+            aodv_hist_merge(&entries[merged - 1].wait, &entries[i].wait);
+            aodv_hist_merge(&entries[merged - 1].hold, &entries[i].hold);
+        }
+        else {
+            if(merged != i) {
+                entries[merged] = entries[i];
+            }
+            merged++;
+        }
+    }
+    count = merged;
+
+    qsort(entries, count, sizeof(lockstat_data_t), cli_cmp_lockstat);
+
+    cli_print(cli, "%-16s %-5s %-48s %10s %10s %9s %9s %9s %9s %9s %9s", "lock", "mode", "caller", "count", "contended",
+              "wait p50", "wait p99", "wait max", "hold p50", "hold p99", "hold max");
+
+    for(i = 0; i < count; ++i) {
+        lockstat_data_t* e = &entries[i];
+        cli_print(cli, "%-16s %-5s %-48s %10" PRIu64 " %10" PRIu64 " %9.0f %9.0f %9.0f %9.0f %9.0f %9.0f",
+                  e->site->lock_name, lockstat_mode_name(e->site->mode), e->site->caller, e->count, e->contended,
+                  aodv_hist_percentile(&e->wait, 0.5) / cycles_per_ns,
+                  aodv_hist_percentile(&e->wait, 0.99) / cycles_per_ns,
+                  e->wait.max / cycles_per_ns,
+                  aodv_hist_percentile(&e->hold, 0.5) / cycles_per_ns,
+                  aodv_hist_percentile(&e->hold, 0.99) / cycles_per_ns,
+                  e->hold.max / cycles_per_ns);
+    }
+
+    cli_print(cli, "(times in ns, %.3f cycles per ns)", cycles_per_ns);
+    free(entries);
+    return CLI_OK;
+}
+
+int cli_set_packet_buffer_dest_packets(struct cli_def* cli, char* command, char* argv[], int argc) {
+    uint32_t packets;
+
+    if(argc != 1 || sscanf(argv[0], "%" SCNu32, &packets) != 1 || packets == 0 || packets > PB_DEST_MAX_PACKETS_LIMIT) {
+        cli_print(cli, "usage %s [packets 1-%d]\n", command, PB_DEST_MAX_PACKETS_LIMIT);
+        return CLI_ERROR_ARG;
+    }
+
+    pb_dest_max_packets = packets;
+    cli_print(cli, "packet buffer: at most %" PRIu32 " packets per destination (for destinations buffered from now on)", pb_dest_max_packets);
+    dessert_notice("packet buffer: at most %" PRIu32 " packets per destination", pb_dest_max_packets);
+    return CLI_OK;
+}
+
+int cli_set_packet_buffer_dest_bytes(struct cli_def* cli, char* command, char* argv[], int argc) {
+    uint32_t bytes;
+
+    if(argc != 1 || sscanf(argv[0], "%" SCNu32, &bytes) != 1 || bytes == 0) {
+        cli_print(cli, "usage %s [bytes > 0]\n", command);
+        return CLI_ERROR_ARG;
+    }
+
+    pb_dest_max_bytes = bytes;
+    cli_print(cli, "packet buffer: at most %" PRIu32 " bytes per destination", pb_dest_max_bytes);
+    dessert_notice("packet buffer: at most %" PRIu32 " bytes per destination", pb_dest_max_bytes);
+    return CLI_OK;
+}
+
+int cli_set_packet_buffer_budget(struct cli_def* cli, char* command, char* argv[], int argc) {
+    uint32_t bytes;
+
+    if(argc != 1 || sscanf(argv[0], "%" SCNu32, &bytes) != 1 || bytes == 0) {
+        cli_print(cli, "usage %s [bytes > 0]\n", command);
+        return CLI_ERROR_ARG;
+    }
+
+    pb_max_bytes = bytes;
+    cli_print(cli, "packet buffer: at most %" PRIu32 " bytes in total", pb_max_bytes);
+    dessert_notice("packet buffer: at most %" PRIu32 " bytes in total", pb_max_bytes);
+    return CLI_OK;
+}
+
+int cli_set_packet_buffer_policy(struct cli_def* cli, char* command, char* argv[], int argc) {
+    if(argc != 1) {
+        cli_print(cli, "usage %s [drop_oldest|drop_tail]\n", command);
+        return CLI_ERROR;
+    }
+
+    if(strcmp(argv[0], "drop_oldest") == 0) {
+        pb_policy = AODV_PB_DROP_OLDEST;
+    }
+    else if(strcmp(argv[0], "drop_tail") == 0) {
+        pb_policy = AODV_PB_DROP_TAIL;
+    }
+    else {
+        cli_print(cli, "usage %s [drop_oldest|drop_tail]\n", command);
+        return CLI_ERROR;
+    }
+
+    cli_print(cli, "packet buffer policy set to %s", argv[0]);
+    dessert_notice("packet buffer policy set to %s", argv[0]);
+    return CLI_OK;
+}
+
+int cli_show_packet_buffer(struct cli_def* cli, char* command, char* argv[], int argc) {
+    aodv_pb_stats_t stats;
+    aodv_db_packet_buffer_stats(&stats);
+    cli_print(cli, "policy               = %s", (pb_policy == AODV_PB_DROP_TAIL) ? "drop_tail" : "drop_oldest");
+    cli_print(cli, "limits               = %" PRIu32 " packets / %" PRIu32 " bytes per destination, %" PRIu32 " bytes total", pb_dest_max_packets, pb_dest_max_bytes, pb_max_bytes);
+    cli_print(cli, "destinations         = %" PRIu32 "", stats.destinations);
+    cli_print(cli, "packets              = %" PRIu32 "", stats.packets);
+    cli_print(cli, "bytes                = %" PRIu64 "", stats.bytes);
+    cli_print(cli, "overhead bytes       = %" PRIu64 " (destinations and rings, part of the budget)", stats.overhead);
+    cli_print(cli, "pushed               = %" PRIu64 "", stats.pushed);
+    cli_print(cli, "popped               = %" PRIu64 "", stats.popped);
+    cli_print(cli, "dropped dest packets = %" PRIu64 "", stats.dropped_dest_packets);
+    cli_print(cli, "dropped dest bytes   = %" PRIu64 "", stats.dropped_dest_bytes);
+    cli_print(cli, "dropped budget       = %" PRIu64 "", stats.dropped_budget);
+    cli_print(cli, "dropped expired      = %" PRIu64 "", stats.dropped_expired);
+    cli_print(cli, "dropped no memory    = %" PRIu64 "", stats.dropped_nomem);
+    return CLI_OK;
+}
+
 int cli_show_preemptive_rreq_signal_strength_threshold(struct cli_def* cli, char* command, char* argv[], int argc) {
 
     if(signal_strength_threshold == 0) {
@@ -499,19 +805,357 @@ int cli_show_tracking_factor(struct cli_def* cli, char* command, char* argv[], i
     return CLI_OK; 
 } 
 
+typedef enum cli_dump_format {
+    CLI_DUMP_TABLE,
+    CLI_DUMP_CSV,
+    CLI_DUMP_JSON
+} cli_dump_format_t;
+
+/** options shared by the table dumps: [<addr_name> MAC] [next_hop MAC] [offset N] [limit N] [format table|csv|json] */
+typedef struct cli_dump_args {
+    int addr_set;
+    mac_addr addr;
+    int next_hop_set;
+    mac_addr next_hop;
+    uint32_t offset;
+    uint32_t limit; // 0 is unlimited
+    cli_dump_format_t format;
+} cli_dump_args_t;
+
+static int cli_parse_dump_args(struct cli_def* cli, char* command, char* argv[], int argc,
+                               const char* addr_name, int next_hop_allowed, cli_dump_args_t* args) {
+    int i;
+    memset(args, 0, sizeof(*args));
+    args->format = CLI_DUMP_TABLE;
+
+    for(i = 0; i + 1 < argc; i += 2) {
+        if(strcmp(argv[i], addr_name) == 0 && dessert_parse_mac(argv[i + 1], &args->addr) == 0) {
+            args->addr_set = true;
+        }
+        else if(next_hop_allowed && strcmp(argv[i], "next_hop") == 0 && dessert_parse_mac(argv[i + 1], &args->next_hop) == 0) {
+            args->next_hop_set = true;
+        }
+        else if(strcmp(argv[i], "offset") == 0 && sscanf(argv[i + 1], "%" SCNu32, &args->offset) == 1) {
+        }
+        else if(strcmp(argv[i], "limit") == 0 && sscanf(argv[i + 1], "%" SCNu32, &args->limit) == 1) {
+        }
+        else if(strcmp(argv[i], "format") == 0 && strcmp(argv[i + 1], "table") == 0) {
+            args->format = CLI_DUMP_TABLE;
+        }
+        else if(strcmp(argv[i], "format") == 0 && strcmp(argv[i + 1], "csv") == 0) {
+            args->format = CLI_DUMP_CSV;
+        }
+        else if(strcmp(argv[i], "format") == 0 && strcmp(argv[i + 1], "json") == 0) {
+            args->format = CLI_DUMP_JSON;
+        }
+        else {
+            break;
+        }
+    }
+
+    if(i != argc) {
+        cli_print(cli, "usage of %s command [%s XX:XX:XX:XX:XX:XX]%s [offset N] [limit N] [format table|csv|json]\n",
+                  command, addr_name, next_hop_allowed ? " [next_hop XX:XX:XX:XX:XX:XX]" : "");
+        return false;
+    }
+    return true;
+}
+
+/** true if the index-th matching entry belongs to the requested page */
+static inline int cli_dump_in_page(cli_dump_args_t* args, uint32_t index) {
+    return index >= args->offset && (args->limit == 0 || index - args->offset < args->limit);
+}
+
+static int cli_rt_snapshot_cmp(const void* a, const void* b) {
+    return memcmp(((const aodv_rt_snapshot_entry_t*) a)->addr, ((const aodv_rt_snapshot_entry_t*) b)->addr, ETH_ALEN);
+}
+
 int cli_show_rt(struct cli_def* cli, char* command, char* argv[], int argc) {
-    char* rt_report;
-    aodv_db_view_routing_table(&rt_report);
-    cli_print(cli, "\n%s\n", rt_report);
-    free(rt_report);
+    cli_dump_args_t args;
+
+    if(!cli_parse_dump_args(cli, command, argv, argc, "destination", true, &args)) {
+        return CLI_ERROR_ARG;
+    }
+
+    aodv_rt_snapshot_entry_t* entries;
+    uint32_t count;
+
+    if(!aodv_db_snapshot_routing_table(&entries, &count)) {
+        cli_print(cli, "could not copy routing table\n");
+        return CLI_ERROR;
+    }
+
+    // the order of the shards changes with every removal, sort so that pages are stable
+    qsort(entries, count, sizeof(aodv_rt_snapshot_entry_t), cli_rt_snapshot_cmp);
+
+    const char* separator = "+-------------------+-------------------+-------------------+-------------+---------------+";
+
+    switch(args.format) {
+        case CLI_DUMP_TABLE:
+            cli_print(cli, "%s", separator);
+            cli_print(cli, "|    destination    |      next hop     |  out iface addr   |  route inv  | next hop unkn |");
+            cli_print(cli, "%s", separator);
+            break;
+        case CLI_DUMP_CSV:
+            cli_print(cli, "destination,next_hop,output_iface,invalid,next_hop_unknown,sequence_number,metric,hop_count");
+            break;
+        case CLI_DUMP_JSON:
+            cli_print(cli, "[");
+            break;
+    }
+
+    uint32_t i, matching = 0, shown = 0;
+
+    for(i = 0; i < count; ++i) {
+        aodv_rt_snapshot_entry_t* el = &entries[i];
+        int unknown = (el->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) != 0;
+        int invalid = (el->flags & AODV_FLAGS_ROUTE_INVALID) != 0;
+
+        if((args.addr_set && !mac_equal(el->addr, args.addr))
+           || (args.next_hop_set && (unknown || !mac_equal(el->next_hop, args.next_hop)))) {
+            continue;
+        }
+
+        if(!cli_dump_in_page(&args, matching++)) {
+            continue;
+        }
+
+        switch(args.format) {
+            case CLI_DUMP_TABLE:
+                if(unknown) {
+                    cli_print(cli, "| " MAC " |                   |                   |   %5s     |     true      |",
+                              EXPLODE_ARRAY6(el->addr), invalid ? "true" : "false");
+                }
+                else {
+                    cli_print(cli, "| " MAC " | " MAC " | " MAC " |    %5s    |     false     |",
+                              EXPLODE_ARRAY6(el->addr), EXPLODE_ARRAY6(el->next_hop), EXPLODE_ARRAY6(el->output_iface),
+                              invalid ? "true" : "false");
+                }
+                cli_print(cli, "%s", separator);
+                break;
+            case CLI_DUMP_CSV:
+                cli_print(cli, MAC "," MAC "," MAC ",%d,%d,%" PRIu32 ",%" AODV_PRI_METRIC ",%" PRIu8,
+                          EXPLODE_ARRAY6(el->addr), EXPLODE_ARRAY6(el->next_hop), EXPLODE_ARRAY6(el->output_iface),
+                          invalid, unknown, el->sequence_number, el->metric, el->hop_count);
+                break;
+            case CLI_DUMP_JSON:
+                cli_print(cli, "%s{\"destination\":\"" MAC "\",\"next_hop\":\"" MAC "\",\"output_iface\":\"" MAC "\","
+                          "\"invalid\":%s,\"next_hop_unknown\":%s,\"sequence_number\":%" PRIu32 ",\"metric\":%" AODV_PRI_METRIC ",\"hop_count\":%" PRIu8 "}",
+                          shown ? "," : "", EXPLODE_ARRAY6(el->addr), EXPLODE_ARRAY6(el->next_hop), EXPLODE_ARRAY6(el->output_iface),
+                          invalid ? "true" : "false", unknown ? "true" : "false", el->sequence_number, el->metric, el->hop_count);
+                break;
+        }
+        shown++;
+    }
+
+    if(args.format == CLI_DUMP_JSON) {
+        cli_print(cli, "]");
+    }
+    else if(args.format == CLI_DUMP_TABLE) {
+        cli_print(cli, "%" PRIu32 " of %" PRIu32 " matching routes shown, %" PRIu32 " routes total\n", shown, matching, count);
+    }
+
+    free(entries);
     return CLI_OK;
 }
 
+static int cli_pdr_nt_snapshot_cmp(const void* a, const void* b) {
+    return memcmp(((const aodv_pdr_nt_snapshot_entry_t*) a)->neighbor, ((const aodv_pdr_nt_snapshot_entry_t*) b)->neighbor, ETH_ALEN);
+}
+
 int cli_show_pdr_nt(struct cli_def* cli, char* command, char* argv[], int argc) {
-    char* pdr_nt_report;
-    aodv_db_view_pdr_nt(&pdr_nt_report);
-    cli_print(cli, "\n%s\n", pdr_nt_report);
-    free(pdr_nt_report);
+    cli_dump_args_t args;
+
+    if(!cli_parse_dump_args(cli, command, argv, argc, "neighbor", false, &args)) {
+        return CLI_ERROR_ARG;
+    }
+
+    aodv_pdr_nt_snapshot_entry_t* entries;
+    uint32_t count;
+
+    if(!aodv_db_snapshot_pdr_nt(&entries, &count)) {
+        cli_print(cli, "could not copy pdr tracking table\n");
+        return CLI_ERROR;
+    }
+
+    qsort(entries, count, sizeof(aodv_pdr_nt_snapshot_entry_t), cli_pdr_nt_snapshot_cmp);
+
+    const char* separator = "+-------------------+-------------------+-------------------+-------------------+----------------------+";
+
+    switch(args.format) {
+        case CLI_DUMP_TABLE:
+            cli_print(cli, "%s", separator);
+            cli_print(cli, "|     neighbor      |  hello interval   |  received hellos  |  expected hellos  | neighbor rcvd hellos |");
+            cli_print(cli, "%s", separator);
+            break;
+        case CLI_DUMP_CSV:
+            cli_print(cli, "neighbor,hello_interval,rcvd_hellos,expected_hellos,nb_rcvd_hellos");
+            break;
+        case CLI_DUMP_JSON:
+            cli_print(cli, "[");
+            break;
+    }
+
+    uint32_t i, matching = 0, shown = 0;
+
+    for(i = 0; i < count; ++i) {
+        aodv_pdr_nt_snapshot_entry_t* el = &entries[i];
+
+        if(args.addr_set && !mac_equal(el->neighbor, args.addr)) {
+            continue;
+        }
+
+        if(!cli_dump_in_page(&args, matching++)) {
+            continue;
+        }
+
+        switch(args.format) {
+            case CLI_DUMP_TABLE:
+                cli_print(cli, "| " MAC " |      %" PRIu16 " ms      |        %" PRIu8 "        |       %" PRIu16 "       |        %" PRIu8 "        |",
+                          EXPLODE_ARRAY6(el->neighbor), el->hello_interval, el->rcvd_hellos, el->expected_hellos, el->nb_rcvd_hellos);
+                cli_print(cli, "%s", separator);
+                break;
+            case CLI_DUMP_CSV:
+                cli_print(cli, MAC ",%" PRIu16 ",%" PRIu8 ",%" PRIu16 ",%" PRIu8,
+                          EXPLODE_ARRAY6(el->neighbor), el->hello_interval, el->rcvd_hellos, el->expected_hellos, el->nb_rcvd_hellos);
+                break;
+            case CLI_DUMP_JSON:
+                cli_print(cli, "%s{\"neighbor\":\"" MAC "\",\"hello_interval\":%" PRIu16 ",\"rcvd_hellos\":%" PRIu8 ",\"expected_hellos\":%" PRIu16 ",\"nb_rcvd_hellos\":%" PRIu8 "}",
+                          shown ? "," : "", EXPLODE_ARRAY6(el->neighbor), el->hello_interval, el->rcvd_hellos, el->expected_hellos, el->nb_rcvd_hellos);
+                break;
+        }
+        shown++;
+    }
+
+    if(args.format == CLI_DUMP_JSON) {
+        cli_print(cli, "]");
+    }
+    else if(args.format == CLI_DUMP_TABLE) {
+        cli_print(cli, "%" PRIu32 " of %" PRIu32 " matching neighbors shown, %" PRIu32 " neighbors total\n", shown, matching, count);
+    }
+
+    free(entries);
+    return CLI_OK;
+}
+
+int cli_show_discovery(struct cli_def* cli, char* command, char* argv[], int argc) {
+    aodv_discovery_stats_t stats;
+    uint32_t i;
+
+    aodv_discovery_stats(&stats);
+
+    uint64_t finished = stats.succeeded + stats.failed;
+    cli_print(cli, "finished discoveries = %" PRIu64 "", finished);
+    cli_print(cli, "succeeded            = %" PRIu64 " (%.1f%%)", stats.succeeded, finished ? 100.0 * stats.succeeded / finished : 0.0);
+    cli_print(cli, "failed               = %" PRIu64 "", stats.failed);
+
+    cli_print(cli, "\nlatency of successful discoveries:");
+    cli_print(cli, "avg  = %" PRIu64 " us", stats.latency_us.count ? stats.latency_us.sum / stats.latency_us.count : 0);
+    cli_print(cli, "p50  = %" PRIu64 " us", aodv_hist_percentile(&stats.latency_us, 0.5));
+    cli_print(cli, "p90  = %" PRIu64 " us", aodv_hist_percentile(&stats.latency_us, 0.9));
+    cli_print(cli, "p99  = %" PRIu64 " us", aodv_hist_percentile(&stats.latency_us, 0.99));
+    cli_print(cli, "max  = %" PRIu64 " us", stats.latency_us.max);
+
+    cli_print(cli, "\n%-8s %12s", "retries", "discoveries");
+    for(i = 0; i <= RREQ_RETRIES; ++i) {
+        cli_print(cli, "%-8" PRIu32 " %12" PRIu64 "", i, stats.retries[i]);
+    }
+
+    cli_print(cli, "\n%-8s %12s", "ttl", "successes");
+    for(i = 0; i <= UINT8_MAX; ++i) {
+        if(stats.ttl[i]) {
+            cli_print(cli, "%-8" PRIu32 " %12" PRIu64 "", i, stats.ttl[i]);
+        }
+    }
+
+    return CLI_OK;
+}
+
+static int cli_discovery_dest_cmp(const void* a, const void* b) {
+    return memcmp(((const aodv_discovery_dest_stats_t*) a)->dest, ((const aodv_discovery_dest_stats_t*) b)->dest, ETH_ALEN);
+}
+
+int cli_show_discovery_destinations(struct cli_def* cli, char* command, char* argv[], int argc) {
+    cli_dump_args_t args;
+
+    if(!cli_parse_dump_args(cli, command, argv, argc, "destination", false, &args)) {
+        return CLI_ERROR_ARG;
+    }
+
+    aodv_discovery_dest_stats_t* entries;
+    uint32_t count;
+
+    if(!aodv_discovery_dest_stats(&entries, &count)) {
+        cli_print(cli, "could not copy discovery statistics\n");
+        return CLI_ERROR;
+    }
+
+    qsort(entries, count, sizeof(aodv_discovery_dest_stats_t), cli_discovery_dest_cmp);
+
+    switch(args.format) {
+        case CLI_DUMP_TABLE:
+            cli_print(cli, "%-17s %9s %9s %9s %11s %11s %11s %11s %8s", "destination", "succeeded", "failed", "retries",
+                      "avg us", "min us", "max us", "last us", "last ttl");
+            break;
+        case CLI_DUMP_CSV:
+            cli_print(cli, "destination,succeeded,failed,retries,latency_avg_us,latency_min_us,latency_max_us,latency_last_us,ttl_last");
+            break;
+        case CLI_DUMP_JSON:
+            cli_print(cli, "[");
+            break;
+    }
+
+    uint32_t i, matching = 0, shown = 0;
+
+    for(i = 0; i < count; ++i) {
+        aodv_discovery_dest_stats_t* el = &entries[i];
+        uint64_t avg = el->succeeded ? el->latency_sum_us / el->succeeded : 0;
+
+        if(args.addr_set && !mac_equal(el->dest, args.addr)) {
+            continue;
+        }
+
+        if(!cli_dump_in_page(&args, matching++)) {
+            continue;
+        }
+
+        switch(args.format) {
+            case CLI_DUMP_TABLE:
+                cli_print(cli, MAC " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %11" PRIu64 " %11" PRIu64 " %11" PRIu64 " %11" PRIu64 " %8" PRIu8 "",
+                          EXPLODE_ARRAY6(el->dest), el->succeeded, el->failed, el->retries,
+                          avg, el->latency_min_us, el->latency_max_us, el->latency_last_us, el->ttl_last);
+                break;
+            case CLI_DUMP_CSV:
+                cli_print(cli, MAC ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu8,
+                          EXPLODE_ARRAY6(el->dest), el->succeeded, el->failed, el->retries,
+                          avg, el->latency_min_us, el->latency_max_us, el->latency_last_us, el->ttl_last);
+                break;
+            case CLI_DUMP_JSON:
+                cli_print(cli, "%s{\"destination\":\"" MAC "\",\"succeeded\":%" PRIu32 ",\"failed\":%" PRIu32 ",\"retries\":%" PRIu32 ","
+                          "\"latency_avg_us\":%" PRIu64 ",\"latency_min_us\":%" PRIu64 ",\"latency_max_us\":%" PRIu64 ",\"latency_last_us\":%" PRIu64 ",\"ttl_last\":%" PRIu8 "}",
+                          shown ? "," : "", EXPLODE_ARRAY6(el->dest), el->succeeded, el->failed, el->retries,
+                          avg, el->latency_min_us, el->latency_max_us, el->latency_last_us, el->ttl_last);
+                break;
+        }
+        shown++;
+    }
+
+    if(args.format == CLI_DUMP_JSON) {
+        cli_print(cli, "]");
+    }
+    else if(args.format == CLI_DUMP_TABLE) {
+        cli_print(cli, "%" PRIu32 " of %" PRIu32 " matching destinations shown, %" PRIu32 " destinations total (at most %u tracked)\n",
+                  shown, matching, count, DISCOVERY_STATS_DESTS);
+    }
+
+    free(entries);
+    return CLI_OK;
+}
+
+int cli_clear_discovery(struct cli_def* cli, char* command, char* argv[], int argc) {
+    aodv_discovery_stats_reset();
+    cli_print(cli, "discovery statistics reset");
+    dessert_notice("discovery statistics reset");
     return CLI_OK;
 }
 
@@ -538,3 +1182,14 @@ int cli_show_data_seq_timeslot(struct cli_def* cli, char* command, char* argv[],
     free(report);
     return CLI_OK;
 }
+
+int cli_show_schedule_lateness(struct cli_def* cli, char* command, char* argv[], int argc) {
+    aodv_sc_lateness_t lateness;
+    aodv_periodic_sc_lateness(&lateness);
+    uint64_t avg_us = lateness.executed ? lateness.total_us / lateness.executed : 0;
+    cli_print(cli, "executed schedules = %" PRIu64 "", lateness.executed);
+    cli_print(cli, "late (> %u ms)      = %" PRIu64 "", SCHEDULE_LATE_THRESHOLD, lateness.late);
+    cli_print(cli, "avg lateness       = %" PRIu64 " us", avg_us);
+    cli_print(cli, "max lateness       = %" PRIu64 " us", lateness.max_us);
+    return CLI_OK;
+}
@@ -38,6 +38,13 @@ int cli_set_metric(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_set_gossip(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_set_periodic_rreq_interval(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_set_preemptive_rreq_signal_strength_threshold(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_set_rate_limit(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_set_pipeline_profiling(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_set_lock_profiling(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_set_packet_buffer_dest_packets(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_set_packet_buffer_dest_bytes(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_set_packet_buffer_budget(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_set_packet_buffer_policy(struct cli_def* cli, char* command, char* argv[], int argc);
 
 int cli_show_gossip_p(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_show_preemptive_rreq_signal_strength_threshold(struct cli_def* cli, char* command, char* argv[], int argc);
@@ -48,13 +55,23 @@ int cli_show_hello_size(struct cli_def* cli, char* command, char* argv[], int ar
 int cli_show_hello_interval(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_show_rreq_size(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_show_tracking_factor(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_show_rate_limit(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_show_packet_buffer(struct cli_def* cli, char* command, char* argv[], int argc);
 
 int cli_show_rt(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_show_pdr_nt(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_show_discovery(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_show_discovery_destinations(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_clear_discovery(struct cli_def* cli, char* command, char* argv[], int argc);
 
 int cli_show_neighbor_timeslot(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_show_packet_buffer_timeslot(struct cli_def* cli, char* command, char* argv[], int argc);
 int cli_show_data_seq_timeslot(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_show_schedule_lateness(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_show_stats(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_clear_stats(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_show_pipeline_latency(struct cli_def* cli, char* command, char* argv[], int argc);
+int cli_show_locks(struct cli_def* cli, char* command, char* argv[], int argc);
 
 int cli_send_rreq(struct cli_def* cli, char* command, char* argv[], int argc);
 
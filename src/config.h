@@ -42,6 +42,10 @@ For further information and questions please use the web site
 #define MY_ROUTE_TIMEOUT			(2 * ACTIVE_ROUTE_TIMEOUT) /* rfc */
 #define PATH_DESCOVERY_TIME			(2 * NET_TRAVERSAL_TIME) /* rfc */
 #define RERR_RATELIMIT				10 /* rfc=10 */
+#define RREQ_FORWARD_RATELIMIT		0 /* per s, 0 is unlimited, not in rfc */
+#define RREP_RATELIMIT				0 /* per s, 0 is unlimited, not in rfc */
+#define HELLO_RATELIMIT				0 /* per s, 0 is unlimited, not in rfc */
+#define CONTROL_BYTE_BUDGET			0 /* bytes per s of all control messages, 0 is unlimited, not in rfc */
 
 #define RREQ_EXT_TYPE				DESSERT_EXT_USER
 #define RREP_EXT_TYPE				(DESSERT_EXT_USER + 1)
@@ -50,9 +54,22 @@ For further information and questions please use the web site
 #define HELLO_EXT_TYPE				(DESSERT_EXT_USER + 4)
 #define BROADCAST_EXT_TYPE			(DESSERT_EXT_USER + 5)
 
-#define FIFO_BUFFER_MAX_ENTRY_SIZE	UINT32_MAX /* maximal packet count that can be stored in FIFO for one destination */
-#define DB_CLEANUP_INTERVAL			NET_TRAVERSAL_TIME /* not in rfc */
-#define SCHEDULE_CHECK_INTERVAL		20 /* ms not in rfc */
+#define PB_DEST_MAX_PACKETS			64 /* packets buffered per destination during route discovery */
+#define PB_DEST_MAX_PACKETS_LIMIT	UINT16_MAX /* highest per destination packet cap, keeps the ring of a destination allocatable, not in rfc */
+#define PB_DEST_MAX_BYTES			(128 * 1024) /* bytes buffered per destination during route discovery */
+#define PB_MAX_BYTES				(4 * 1024 * 1024) /* bytes buffered for all destinations */
+#define PB_POLICY					AODV_PB_DROP_OLDEST
+#define SCHEDULE_TIME_BUDGET		5 /* ms one schedule run may spend executing due schedules, not in rfc */
+#define SCHEDULE_LATE_THRESHOLD		10 /* ms after which an executed schedule counts as late, not in rfc */
+#define RT_SHARD_COUNT				16 /* number of independently locked routing table shards, not in rfc */
+#define RT_FIB_SLOTS				256 /* initial lock-free forwarding slots per routing table shard (power of two), grows with the routes, not in rfc */
+#define RT_FIB_PROBES				8 /* max slots probed for one destination, the slots grow if a route finds none free */
+#define FWD_CACHE_SLOTS				64 /* per-thread forwarding cache entries (power of two), not in rfc */
+#define FWD_CACHE_REFRESH			500 /* ms after which a cached route is looked up again to record its use, not in rfc */
+#define DISCOVERY_HINT_SLOTS		1024 /* slots of running discoveries readable without posting to the discovery engine, not in rfc */
+#define DISCOVERY_STATS_DESTS		4096 /* destinations with their own discovery statistics, not in rfc */
+#define AODV_STATS_CPUS				64 /* per-CPU copies of the packet statistics, CPUs beyond share copies, not in rfc */
+#define LOCKSTAT_MAX_HELD			(RT_SHARD_COUNT + 8) /* locks one thread may hold with measured hold times, not in rfc */
 
 #define HELLO_INTERVAL				1000 /* ms rfc=1000 */
 
@@ -81,6 +98,11 @@ typedef enum aodv_metric {
     AODV_METRIC_PDR
 } aodv_metric_t;
 
+typedef enum aodv_pb_policy {
+    AODV_PB_DROP_OLDEST = 0, /* make room by dropping the oldest buffered packets */
+    AODV_PB_DROP_TAIL /* drop the new packet */
+} aodv_pb_policy_t;
+
 typedef uint16_t metric_t;
 #define AODV_PRI_METRIC				PRIu16
 #define AODV_MAX_METRIC				UINT16_MAX /* the type of the variable in the packets -> u16 it is the maximum value of a metric */
@@ -90,10 +112,10 @@ typedef uint16_t metric_t;
 #define PDR_TRACKING_PURGE_FACTOR	2  /* timeout for nb entry in pdr tracker := nb_hello_interval * PDR_TRACKING_FACTOR * PDR_TRACKING_PURGE_FACTOR */
 #define PDR_MIN_TRACKING_INTERVAL	500 /* minimum tracking interval in ms */
 
-#define REPORT_RT_STR_LEN			150 /* default: 150 (should not be switched, needed for string inits)*/
 #define RREQ_INTERVAL				0 /* off */
 
 #define AODV_DATA_SEQ_TIMEOUT		MY_ROUTE_TIMEOUT /* wait MY_ROUTE_TIMEOUT for dropping data seq information -> this is the time a route is valid */
+#define AODV_DATA_SEQ_WINDOW		256 /* data seq numbers per source remembered for duplicate detection (power of two, max 32768), not in rfc */
 
 /**
  * Schedule type = repeat RREQ
@@ -139,6 +161,10 @@ extern aodv_gossip_t				gossip_type;
 extern aodv_metric_t				metric_type;
 extern uint16_t 					metric_startvalue;
 extern int8_t						signal_strength_threshold;
+extern uint32_t						pb_dest_max_packets;
+extern uint32_t						pb_dest_max_bytes;
+extern uint32_t						pb_max_bytes;
+extern aodv_pb_policy_t				pb_policy;
 
 typedef struct aodv_link_break_element {
     mac_addr host;
@@ -152,6 +178,48 @@ typedef struct aodv_mac_seq {
     uint32_t sequence_number;
 } __attribute__((__packed__)) aodv_mac_seq_t;
 
+typedef struct aodv_pb_stats {
+    uint32_t destinations;
+    uint32_t packets;
+    uint64_t bytes;
+    uint64_t overhead; // destination records and their rings, counted against the budget like bytes
+    uint64_t pushed;
+    uint64_t popped;
+    uint64_t dropped_dest_packets; // per destination packet cap
+    uint64_t dropped_dest_bytes; // per destination byte cap
+    uint64_t dropped_budget; // global byte budget
+    uint64_t dropped_expired; // no route found in time
+    uint64_t dropped_nomem;
+} aodv_pb_stats_t;
+
+/** copy of one route for reports, taken under a short lock and formatted without it */
+typedef struct aodv_rt_snapshot_entry {
+    mac_addr addr;
+    mac_addr next_hop;
+    mac_addr output_iface; // hardware address, zero if the next hop is unknown
+    uint8_t flags;
+    uint32_t sequence_number;
+    metric_t metric;
+    uint8_t hop_count;
+} aodv_rt_snapshot_entry_t;
+
+/** copy of one pdr tracker neighbor for reports */
+typedef struct aodv_pdr_nt_snapshot_entry {
+    mac_addr neighbor;
+    uint16_t hello_interval;
+    uint8_t rcvd_hellos;
+    uint16_t expected_hellos;
+    uint8_t nb_rcvd_hellos;
+} aodv_pdr_nt_snapshot_entry_t;
+
+/** all packets buffered for one destination, oldest first at msgs[head] */
+typedef struct aodv_pb_batch {
+    dessert_msg_t** msgs; // ring of capacity entries, free after use
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+} aodv_pb_batch_t;
+
 #define MAX_MAC_SEQ_PER_EXT (DESSERT_MAXEXTDATALEN / sizeof(aodv_mac_seq_t))
 
 #endif
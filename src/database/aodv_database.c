@@ -32,122 +32,258 @@ For further information and questions please use the web site
 #include "data_seq/ds.h"
 #include "packet_buffer/packet_buffer.h"
 #include "schedule_table/aodv_st.h"
-#include "rreq_log/rreq_log.h"
-#include "rerr_log/rerr_log.h"
+#include "lockstat.h"
+#include "../pipeline/aodv_timer.h"
+
+/*
+ * Every table has its own lock so that independent tables never serialize each
+ * other. The routing table is split into RT_SHARD_COUNT shards by destination
+ * address, each with its own lock. If several locks are needed they are always
+ * taken in this order: routing table shards (ascending index) -> neighbor table
+ * -> schedule table. The timer engine lock is taken last and never held while
+ * taking another one.
+ */
+pthread_rwlock_t rt_rwlock[RT_SHARD_COUNT];
+pthread_rwlock_t nt_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+pthread_rwlock_t pdr_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+pthread_rwlock_t ds_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+pthread_rwlock_t pb_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+pthread_mutex_t sc_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline pthread_rwlock_t* rt_lock(mac_addr dhost_ether) {
+    return &rt_rwlock[aodv_db_rt_shard(dhost_ether)];
+}
 
-pthread_rwlock_t db_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+// the helpers take the lockstat site of their caller, see the macros below
+static void rt_lock_all_at(lockstat_site_t* site) {
+    uint32_t i;
 
-void aodv_db_rlock() {
-    pthread_rwlock_rdlock(&db_rwlock);
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        lockstat_rw_at(&rt_rwlock[i], site);
+    }
 }
 
-void aodv_db_wlock() {
-    pthread_rwlock_wrlock(&db_rwlock);
+#define rt_rlock_all() rt_lock_all_at(LOCKSTAT_SITE("rt_rwlock", LOCKSTAT_READ))
+#define rt_wlock_all() rt_lock_all_at(LOCKSTAT_SITE("rt_rwlock", LOCKSTAT_WRITE))
+
+static void rt_unlock_all() {
+    uint32_t i;
+
+    for(i = RT_SHARD_COUNT; i > 0; --i) {
+        lockstat_unlock(&rt_rwlock[i - 1]);
+    }
 }
 
-void aodv_db_unlock() {
-    pthread_rwlock_unlock(&db_rwlock);
+static void rt_pair_wlock_at(mac_addr first, mac_addr second, lockstat_site_t* site) {
+    uint32_t a = aodv_db_rt_shard(first);
+    uint32_t b = aodv_db_rt_shard(second);
+
+    if(a > b) {
+        uint32_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    lockstat_rw_at(&rt_rwlock[a], site);
+
+    if(b != a) {
+        lockstat_rw_at(&rt_rwlock[b], site);
+    }
+}
+
+#define rt_pair_wlock(first, second) rt_pair_wlock_at(first, second, LOCKSTAT_SITE("rt_rwlock", LOCKSTAT_WRITE))
+
+static void rt_pair_unlock(mac_addr first, mac_addr second) {
+    uint32_t a = aodv_db_rt_shard(first);
+    uint32_t b = aodv_db_rt_shard(second);
+
+    lockstat_unlock(&rt_rwlock[a]);
+
+    if(b != a) {
+        lockstat_unlock(&rt_rwlock[b]);
+    }
 }
 
 int aodv_db_init() {
     int success = true;
-    aodv_db_wlock();
+    uint32_t i;
+
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        pthread_rwlock_init(&rt_rwlock[i], NULL);
+    }
+
     success &= db_nt_init();
     success &= aodv_db_pdr_nt_init();
     success &= db_ds_init();
     success &= aodv_db_rt_init();
     success &= pb_init();
-    success &= aodv_db_rerrl_init();
-    success &= aodv_db_rl_init();
-    aodv_db_unlock();
     return success;
 }
 
+/**
+ * Whether a table has anything to purge at timestamp. The expiry reported by
+ * next_expiry needs no lock, so tables with nothing due are not locked at all.
+ */
+static int aodv_db_due(int (*next_expiry)(struct timeval*), struct timeval* timestamp) {
+    struct timeval next;
+    return next_expiry(&next) && dessert_timevalcmp(&next, timestamp) <= 0;
+}
+
+static int aodv_db_rt_due(uint32_t shard, struct timeval* timestamp) {
+    struct timeval next;
+    return aodv_db_rt_next_expiry(shard, &next) && dessert_timevalcmp(&next, timestamp) <= 0;
+}
+
 int aodv_db_cleanup(struct timeval* timestamp) {
     int success = true;
-    aodv_db_wlock();
-    success &= db_nt_cleanup(timestamp);
-    success &= db_ds_cleanup(timestamp);
-    success &= aodv_db_rt_cleanup(timestamp);
-    success &= pb_cleanup(timestamp);
-    success &= aodv_db_pdr_nt_cleanup(timestamp);
-    aodv_db_unlock();
+    uint32_t i;
+
+    if(aodv_db_due(db_nt_next_expiry, timestamp)) {
+        lockstat_wrlock(&nt_rwlock, "nt_rwlock");
+        success &= db_nt_cleanup(timestamp);
+        lockstat_unlock(&nt_rwlock);
+    }
+
+    if(aodv_db_due(db_ds_next_expiry, timestamp)) {
+        lockstat_wrlock(&ds_rwlock, "ds_rwlock");
+        success &= db_ds_cleanup(timestamp);
+        lockstat_unlock(&ds_rwlock);
+    }
+
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        if(aodv_db_rt_due(i, timestamp)) {
+            lockstat_wrlock(&rt_rwlock[i], "rt_rwlock");
+            success &= aodv_db_rt_cleanup(i, timestamp);
+            lockstat_unlock(&rt_rwlock[i]);
+        }
+    }
+
+    if(aodv_db_due(pb_next_expiry, timestamp)) {
+        lockstat_wrlock(&pb_rwlock, "pb_rwlock");
+        success &= pb_cleanup(timestamp);
+        lockstat_unlock(&pb_rwlock);
+    }
+
+    if(aodv_db_due(aodv_db_pdr_nt_next_expiry, timestamp)) {
+        lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
+        success &= aodv_db_pdr_nt_cleanup(timestamp);
+        lockstat_unlock(&pdr_rwlock);
+    }
+
     return success;
 }
 
+static void aodv_db_min_expiry(int found, struct timeval* candidate, int* any, struct timeval* next_out) {
+    if(found && (!*any || dessert_timevalcmp(candidate, next_out) < 0)) {
+        *next_out = *candidate;
+        *any = true;
+    }
+}
+
+int aodv_db_next_expiry(struct timeval* next_out) {
+    struct timeval candidate;
+    int any = false;
+    int found;
+    uint32_t i;
+
+    // the tables publish their earliest expiry without lock, see timeslot_next_expiry
+    found = db_nt_next_expiry(&candidate);
+    aodv_db_min_expiry(found, &candidate, &any, next_out);
+
+    found = db_ds_next_expiry(&candidate);
+    aodv_db_min_expiry(found, &candidate, &any, next_out);
+
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        found = aodv_db_rt_next_expiry(i, &candidate);
+        aodv_db_min_expiry(found, &candidate, &any, next_out);
+    }
+
+    found = pb_next_expiry(&candidate);
+    aodv_db_min_expiry(found, &candidate, &any, next_out);
+
+    found = aodv_db_pdr_nt_next_expiry(&candidate);
+    aodv_db_min_expiry(found, &candidate, &any, next_out);
+
+    lockstat_mutex_lock(&sc_mutex, "sc_mutex");
+    found = aodv_db_sc_next_schedule(&candidate);
+    lockstat_mutex_unlock(&sc_mutex);
+    aodv_db_min_expiry(found, &candidate, &any, next_out);
+    return any;
+}
+
 int aodv_db_neighbor_reset(uint32_t* count_out) {
-    pthread_rwlock_wrlock(&db_rwlock);
+    lockstat_wrlock(&nt_rwlock, "nt_rwlock");
     int result = aodv_db_nt_neighbor_reset(count_out);
-    pthread_rwlock_unlock(&db_rwlock);
+    lockstat_unlock(&nt_rwlock);
     return result;
 }
 
 int aodv_db_pdr_neighbor_reset(uint32_t* count_out) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
     int result = aodv_db_pdr_nt_neighbor_reset(count_out);
-    aodv_db_unlock();
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 int aodv_db_pdr_upd_expected(uint16_t new_interval) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
     int result = aodv_db_pdr_nt_upd_expected(new_interval);
-    aodv_db_unlock();
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 int aodv_db_pdr_cap_hello(mac_addr ether_neighbor_addr, uint16_t hello_seq, uint16_t hello_interv, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
     int result = aodv_db_pdr_nt_cap_hello(ether_neighbor_addr, hello_seq, hello_interv, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 int aodv_db_pdr_cap_hellorsp(mac_addr ether_neighbor_addr, uint16_t hello_interv, uint8_t hello_count, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
     int result = aodv_db_pdr_nt_cap_hellorsp(ether_neighbor_addr, hello_interv, hello_count, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 int aodv_db_pdr_get_pdr(mac_addr ether_neighbor_addr, uint16_t* pdr_out, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
     int result = aodv_db_pdr_nt_get_pdr(ether_neighbor_addr, pdr_out, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 int aodv_db_pdr_get_etx_mul(mac_addr ether_neighbor_addr, uint16_t* etx_out, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
     int result = aodv_db_pdr_nt_get_etx_mul(ether_neighbor_addr, etx_out, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 int aodv_db_pdr_get_etx_add(mac_addr ether_neighbor_addr, uint16_t* etx_out, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
     int result = aodv_db_pdr_nt_get_etx_add(ether_neighbor_addr, etx_out, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 int aodv_db_pdr_get_rcvdhellocount(mac_addr ether_neighbor_addr, uint8_t* count_out, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pdr_rwlock, "pdr_rwlock");
     int result = aodv_db_pdr_nt_get_rcvdhellocount(ether_neighbor_addr, count_out, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 void aodv_db_push_packet(mac_addr dhost_ether, dessert_msg_t* msg, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&pb_rwlock, "pb_rwlock");
     pb_push_packet(dhost_ether, msg, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&pb_rwlock);
 }
 
-dessert_msg_t* aodv_db_pop_packet(mac_addr dhost_ether) {
-    aodv_db_wlock();
-    dessert_msg_t* result = pb_pop_packet(dhost_ether);
-    aodv_db_unlock();
+int aodv_db_pop_packets(mac_addr dhost_ether, aodv_pb_batch_t* batch_out) {
+    lockstat_wrlock(&pb_rwlock, "pb_rwlock");
+    int result = pb_pop_packets(dhost_ether, batch_out);
+    lockstat_unlock(&pb_rwlock);
     return result;
 }
 
@@ -157,114 +293,123 @@ dessert_msg_t* aodv_db_pop_packet(mac_addr dhost_ether) {
  * over shost_prev_hop (nodes output interface: output_iface).
  */
 int aodv_db_capt_rreq(mac_addr destination_host, mac_addr originator_host, mac_addr prev_hop, dessert_meshif_t* iface, uint32_t originator_sequence_number, metric_t metric, uint8_t hop_count, struct timeval* timestamp, aodv_capt_rreq_result_t* result_out) {
-    aodv_db_wlock();
+    rt_pair_wlock(destination_host, originator_host);
     int result = aodv_db_rt_capt_rreq(destination_host, originator_host, prev_hop, iface, originator_sequence_number, metric, hop_count, timestamp, result_out);
-    aodv_db_unlock();
+    rt_pair_unlock(destination_host, originator_host);
     return result;
 }
 
 int aodv_db_capt_rrep(mac_addr destination_host, mac_addr destination_host_next_hop, dessert_meshif_t* output_iface, uint32_t destination_sequence_number, metric_t metric, uint8_t hop_count, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(rt_lock(destination_host), "rt_rwlock");
     int result =  aodv_db_rt_capt_rrep(destination_host, destination_host_next_hop, output_iface, destination_sequence_number, metric, hop_count, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(destination_host));
     return result;
 }
 
 int aodv_db_getroute2dest(mac_addr dhost_ether, mac_addr dhost_next_hop_out, dessert_meshif_t** output_iface_out, struct timeval* timestamp, uint8_t flags) {
-    aodv_db_wlock();
+    // data packets to valid routes are served without taking the shard lock
+    if(aodv_db_rt_fib_getroute2dest(dhost_ether, dhost_next_hop_out, output_iface_out, timestamp, flags)) {
+        return true;
+    }
+
+    lockstat_rdlock(rt_lock(dhost_ether), "rt_rwlock");
     int result =  aodv_db_rt_getroute2dest(dhost_ether, dhost_next_hop_out, output_iface_out, timestamp, flags);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(dhost_ether));
     return result;
 }
 
+uint64_t aodv_db_route_generation() {
+    return aodv_db_rt_generation();
+}
+
 int aodv_db_getnexthop(mac_addr dhost_ether, mac_addr dhost_next_hop_out) {
-    aodv_db_rlock();
+    lockstat_rdlock(rt_lock(dhost_ether), "rt_rwlock");
     int result =  aodv_db_rt_getnexthop(dhost_ether, dhost_next_hop_out);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(dhost_ether));
     return result;
 }
 
 int aodv_db_get_destination_sequence_number(mac_addr dhost_ether, uint32_t* destination_sequence_number_out) {
-    aodv_db_rlock();
+    lockstat_rdlock(rt_lock(dhost_ether), "rt_rwlock");
     int result = aodv_db_rt_get_destination_sequence_number(dhost_ether, destination_sequence_number_out);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(dhost_ether));
     return result;
 }
 
 int aodv_db_get_hopcount(mac_addr dhost_ether, uint8_t* hop_count_out) {
-    aodv_db_rlock();
+    lockstat_rdlock(rt_lock(dhost_ether), "rt_rwlock");
     int result = aodv_db_rt_get_hopcount(dhost_ether, hop_count_out);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(dhost_ether));
     return result;
 }
 
 int aodv_db_get_metric(mac_addr dhost_ether, metric_t* last_metric_out) {
-    aodv_db_rlock();
+    lockstat_rdlock(rt_lock(dhost_ether), "rt_rwlock");
     int result = aodv_db_rt_get_metric(dhost_ether, last_metric_out);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(dhost_ether));
     return result;
 }
 
 int aodv_db_markrouteinv(mac_addr dhost_ether, uint32_t destination_sequence_number) {
-    aodv_db_wlock();
+    lockstat_wrlock(rt_lock(dhost_ether), "rt_rwlock");
     int result =  aodv_db_rt_markrouteinv(dhost_ether, destination_sequence_number);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(dhost_ether));
     return result;
 }
 
 int aodv_db_add_precursor(mac_addr destination, mac_addr precursor, dessert_meshif_t *iface) {
-    aodv_db_wlock();
+    lockstat_wrlock(rt_lock(destination), "rt_rwlock");
     int result =  aodv_db_rt_add_precursor(destination, precursor, iface);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(destination));
     return result;
 }
 
 int aodv_db_remove_nexthop(mac_addr next_hop) {
-    pthread_rwlock_wrlock(&db_rwlock);
+    rt_wlock_all();
     int result =  aodv_db_rt_remove_nexthop(next_hop);
-    pthread_rwlock_unlock(&db_rwlock);
+    rt_unlock_all();
     return result;
 }
 
 int aodv_db_inv_over_nexthop(mac_addr next_hop) {
-    pthread_rwlock_wrlock(&db_rwlock);
+    rt_wlock_all();
     int result = aodv_db_rt_inv_over_nexthop(next_hop);
-    pthread_rwlock_unlock(&db_rwlock);
+    rt_unlock_all();
     return result;
 }
 
 int aodv_db_get_destlist(mac_addr dhost_next_hop, aodv_link_break_element_t** destlist) {
-    pthread_rwlock_wrlock(&db_rwlock);
+    rt_rlock_all();
     int result = aodv_db_rt_get_destlist(dhost_next_hop, destlist);
-    pthread_rwlock_unlock(&db_rwlock);
+    rt_unlock_all();
     return result;
 }
 
 int aodv_db_get_warn_endpoints_from_neighbor_and_set_warn(mac_addr neighbor, aodv_link_break_element_t** head) {
-    aodv_db_wlock();
+    rt_wlock_all();
     int result = aodv_db_rt_get_warn_endpoints_from_neighbor_and_set_warn(neighbor, head);
-    aodv_db_unlock();
+    rt_unlock_all();
     return result;
 }
 
 int aodv_db_get_warn_status(mac_addr dhost_ether) {
-    aodv_db_wlock();
+    lockstat_rdlock(rt_lock(dhost_ether), "rt_rwlock");
     int result = aodv_db_rt_get_warn_status(dhost_ether);
-    aodv_db_unlock();
+    lockstat_unlock(rt_lock(dhost_ether));
     return result;
 }
 
 int aodv_db_get_active_routes(aodv_link_break_element_t** head) {
-    pthread_rwlock_wrlock(&db_rwlock);
+    rt_rlock_all();
     int result = aodv_db_rt_get_active_routes(head);
-    pthread_rwlock_unlock(&db_rwlock);
+    rt_unlock_all();
     return result;
 }
 
 int aodv_db_routing_reset(uint32_t* count_out) {
-    pthread_rwlock_wrlock(&db_rwlock);
+    rt_wlock_all();
     int result = aodv_db_rt_routing_reset(count_out);
-    pthread_rwlock_unlock(&db_rwlock);
+    rt_unlock_all();
     return result;
 }
 
@@ -273,9 +418,9 @@ int aodv_db_routing_reset(uint32_t* count_out) {
  * the 1 hop bidirectional neighbor
  */
 int aodv_db_cap2Dneigh(mac_addr ether_neighbor_addr, uint16_t hello_seq, dessert_meshif_t* iface, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&nt_rwlock, "nt_rwlock");
     int result = db_nt_cap2Dneigh(ether_neighbor_addr, hello_seq, iface, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&nt_rwlock);
     return result;
 }
 
@@ -283,117 +428,127 @@ int aodv_db_cap2Dneigh(mac_addr ether_neighbor_addr, uint16_t hello_seq, dessert
  * Check whether given neighbor is 1 hop bidirectional neighbor
  */
 int aodv_db_check2Dneigh(mac_addr ether_neighbor_addr, dessert_meshif_t* iface, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&nt_rwlock, "nt_rwlock");
     int result =  db_nt_check2Dneigh(ether_neighbor_addr, iface, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&nt_rwlock);
     return result;
 }
 
 #ifndef ANDROID
 int aodv_db_reset_rssi(mac_addr ether_neighbor_addr, dessert_meshif_t* iface, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&nt_rwlock, "nt_rwlock");
     int result = db_nt_reset_rssi(ether_neighbor_addr, iface, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&nt_rwlock);
     return result;
 }
 
 int8_t aodv_db_update_rssi(mac_addr ether_neighbor, dessert_meshif_t* iface, struct timeval* timestamp) {
-    aodv_db_wlock();
+    lockstat_wrlock(&nt_rwlock, "nt_rwlock");
     int result = db_nt_update_rssi(ether_neighbor, iface, timestamp);
-    aodv_db_unlock();
+    lockstat_unlock(&nt_rwlock);
     return result;
 }
 #endif
 
 int aodv_db_addschedule(struct timeval* execute_ts, mac_addr ether_addr, uint8_t type, void* param) {
-    aodv_db_wlock();
+    lockstat_mutex_lock(&sc_mutex, "sc_mutex");
     int result =  aodv_db_sc_addschedule(execute_ts, ether_addr, type, param);
-    aodv_db_unlock();
+    lockstat_mutex_unlock(&sc_mutex);
+
+    if(result) {
+        aodv_timer_wakeup(execute_ts);
+    }
+
     return result;
 }
 
-int aodv_db_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, uint8_t* type, void* param) {
-    aodv_db_wlock();
-    int result =  aodv_db_sc_popschedule(timestamp, ether_addr_out, type, param);
-    aodv_db_unlock();
+int aodv_db_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, uint8_t* type, void* param, struct timeval* execute_ts_out) {
+    lockstat_mutex_lock(&sc_mutex, "sc_mutex");
+    int result =  aodv_db_sc_popschedule(timestamp, ether_addr_out, type, param, execute_ts_out);
+    lockstat_mutex_unlock(&sc_mutex);
     return result;
 }
 
 int aodv_db_schedule_exists(mac_addr ether_addr, uint8_t type) {
-    aodv_db_wlock();
+    lockstat_mutex_lock(&sc_mutex, "sc_mutex");
     int result =  aodv_db_sc_schedule_exists(ether_addr, type);
-    aodv_db_unlock();
+    lockstat_mutex_unlock(&sc_mutex);
     return result;
 }
 
 int aodv_db_dropschedule(mac_addr ether_addr, uint8_t type) {
-    aodv_db_wlock();
+    lockstat_mutex_lock(&sc_mutex, "sc_mutex");
     int result =  aodv_db_sc_dropschedule(ether_addr, type);
-    aodv_db_unlock();
+    lockstat_mutex_unlock(&sc_mutex);
     return result;
 }
 
-void aodv_db_putrreq(struct timeval* timestamp) {
-    aodv_db_wlock();
-    aodv_db_rl_putrreq(timestamp);
-    aodv_db_unlock();
-}
-
-void aodv_db_getrreqcount(struct timeval* timestamp, uint32_t* count_out) {
-    aodv_db_wlock();
-    aodv_db_rl_getrreqcount(timestamp, count_out);
-    aodv_db_unlock();
-}
-
-void aodv_db_putrerr(struct timeval* timestamp) {
-    aodv_db_wlock();
-    aodv_db_rl_putrerr(timestamp);
-    aodv_db_unlock();
-}
+int aodv_db_capt_data_seq(mac_addr src_addr, uint16_t data_seq_num, uint8_t hop_count, struct timeval* timestamp) {
+    int result;
 
-void aodv_db_getrerrcount(struct timeval* timestamp, uint32_t* count_out) {
-    aodv_db_wlock();
-    aodv_db_rl_getrerrcount(timestamp, count_out);
-    aodv_db_unlock();
-}
+    // every packet of a known source is captured without lock, only new sources need it
+    if(aodv_db_ds_capt_data_seq_nolock(src_addr, data_seq_num, timestamp, &result)) {
+        return result;
+    }
 
-int aodv_db_capt_data_seq(mac_addr src_addr, uint16_t data_seq_num, uint8_t hop_count, struct timeval* timestamp) {
-    aodv_db_wlock();
-    int result = aodv_db_ds_capt_data_seq(src_addr, data_seq_num, hop_count, timestamp);
-    aodv_db_unlock();
+    lockstat_wrlock(&ds_rwlock, "ds_rwlock");
+    result = aodv_db_ds_capt_data_seq(src_addr, data_seq_num, hop_count, timestamp);
+    lockstat_unlock(&ds_rwlock);
     return result;
 }
 
 // --------------------------------------- reporting ---------------------------------------------------------------
 
-int aodv_db_view_routing_table(char** str_out) {
-    aodv_db_rlock();
-    int result =  aodv_db_rt_report(str_out);
-    aodv_db_unlock();
-    return result;
+int aodv_db_snapshot_routing_table(aodv_rt_snapshot_entry_t** entries_out, uint32_t* count_out) {
+    aodv_rt_snapshot_entry_t* entries = NULL;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+    uint32_t i;
+
+    // one shard at a time, so forwarding over the other shards goes on
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        lockstat_rdlock(&rt_rwlock[i], "rt_rwlock");
+        int result = aodv_db_rt_snapshot(i, &entries, &count, &capacity);
+        lockstat_unlock(&rt_rwlock[i]);
+
+        if(!result) {
+            free(entries);
+            return false;
+        }
+    }
+
+    *entries_out = entries;
+    *count_out = count;
+    return true;
 }
 
-int aodv_db_view_pdr_nt(char** str_out) {
-    aodv_db_rlock();
-    int result = aodv_db_pdr_nt_report(str_out);
-    aodv_db_unlock();
+int aodv_db_snapshot_pdr_nt(aodv_pdr_nt_snapshot_entry_t** entries_out, uint32_t* count_out) {
+    lockstat_rdlock(&pdr_rwlock, "pdr_rwlock");
+    int result = aodv_db_pdr_nt_snapshot(entries_out, count_out);
+    lockstat_unlock(&pdr_rwlock);
     return result;
 }
 
 void aodv_db_neighbor_timeslot_report(char** str_out) {
-    aodv_db_rlock();
+    lockstat_rdlock(&nt_rwlock, "nt_rwlock");
     nt_report(str_out);
-    aodv_db_unlock();
+    lockstat_unlock(&nt_rwlock);
 }
 
 void aodv_db_packet_buffer_timeslot_report(char** str_out) {
-    aodv_db_rlock();
+    lockstat_rdlock(&pb_rwlock, "pb_rwlock");
     pb_report(str_out);
-    aodv_db_unlock();
+    lockstat_unlock(&pb_rwlock);
+}
+
+void aodv_db_packet_buffer_stats(aodv_pb_stats_t* stats_out) {
+    lockstat_rdlock(&pb_rwlock, "pb_rwlock");
+    pb_stats(stats_out);
+    lockstat_unlock(&pb_rwlock);
 }
 
 void aodv_db_data_seq_timeslot_report(char** str_out) {
-    aodv_db_rlock();
+    lockstat_rdlock(&ds_rwlock, "ds_rwlock");
     ds_report(str_out);
-    aodv_db_unlock();
+    lockstat_unlock(&ds_rwlock);
 }
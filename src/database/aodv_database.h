@@ -61,9 +61,17 @@ int aodv_db_pdr_get_rcvdhellocount(mac_addr ether_neighbor_addr, uint8_t* count_
 /** cleanup (purge) old entries from all database tables except from pdr_tracker */
 int aodv_db_cleanup(struct timeval* timestamp);
 
+/**
+ * Earliest point in time at which aodv_db_cleanup or a schedule has work to do.
+ * Returns false if all tables and the schedule table are empty. Only takes the
+ * lock of the schedule table.
+ */
+int aodv_db_next_expiry(struct timeval* next_out);
+
 void aodv_db_push_packet(mac_addr dhost_ether, dessert_msg_t* msg, struct timeval* timestamp);
 
-dessert_msg_t* aodv_db_pop_packet(mac_addr dhost_ether);
+/** take all packets buffered for dhost_ether in one go */
+int aodv_db_pop_packets(mac_addr dhost_ether, aodv_pb_batch_t* batch_out);
 
 typedef enum aodv_capt_rreq_result {
     AODV_CAPT_RREQ_OLD,
@@ -96,6 +104,9 @@ int aodv_db_capt_rrep(mac_addr destination_host,
 int aodv_db_getroute2dest(mac_addr dhost_ether, mac_addr dhost_next_hop_out,
                           dessert_meshif_t** output_iface_out, struct timeval* timestamp, uint8_t flags);
 
+/** current route generation; needs no lock (see aodv_db_rt_generation) */
+uint64_t aodv_db_route_generation();
+
 int aodv_db_getnexthop(mac_addr dhost_ether, mac_addr dhost_next_hop_out);
 
 int aodv_db_get_destination_sequence_number(mac_addr dhost_ether, uint32_t* destination_sequence_number_out);
@@ -133,28 +144,28 @@ int8_t aodv_db_update_rssi(mac_addr ether_neighbor, dessert_meshif_t* iface, str
 
 int aodv_db_addschedule(struct timeval* execute_ts, mac_addr ether_addr, uint8_t type, void* param);
 
-int aodv_db_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, uint8_t* type, void* param);
+int aodv_db_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, uint8_t* type, void* param, struct timeval* execute_ts_out);
 
 int aodv_db_schedule_exists(mac_addr ether_addr, uint8_t type);
 
 int aodv_db_dropschedule(mac_addr ether_addr, uint8_t type);
 
-void aodv_db_putrreq(struct timeval* timestamp);
-
-void aodv_db_getrreqcount(struct timeval* timestamp, uint32_t* count_out);
-
-void aodv_db_putrerr(struct timeval* timestamp);
-
-void aodv_db_getrerrcount(struct timeval* timestamp, uint32_t* count_out);
-
+/** true if data_seq_num of src_addr was not seen yet; known sources are captured without lock */
 int aodv_db_capt_data_seq(mac_addr src_addr, uint16_t data_seq_num, uint8_t hop_count, struct timeval* timestamp);
 
 // ----------------------------------- reporting -------------------------------------------------------------------------
 
-int aodv_db_view_routing_table(char** str_out);
-int aodv_db_view_pdr_nt(char** str_out);
+/**
+ * Copy all routes into a new array, free it after use. Every shard is locked
+ * only while it is copied, so the copy is not one atomic view of the table.
+ */
+int aodv_db_snapshot_routing_table(aodv_rt_snapshot_entry_t** entries_out, uint32_t* count_out);
+
+/** copy all neighbors of the pdr tracker into a new array, free it after use */
+int aodv_db_snapshot_pdr_nt(aodv_pdr_nt_snapshot_entry_t** entries_out, uint32_t* count_out);
 void aodv_db_neighbor_timeslot_report(char** str_out);
 void aodv_db_packet_buffer_timeslot_report(char** str_out);
+void aodv_db_packet_buffer_stats(aodv_pb_stats_t* stats_out);
 void aodv_db_data_seq_timeslot_report(char** str_out);
 
 #endif
@@ -22,41 +22,266 @@ For further information and questions please use the web site
 *******************************************************************************/
 
 #include "ds.h"
+#include <string.h>
 
+#define DS_WINDOW_WORDS (AODV_DATA_SEQ_WINDOW / 64)
+
+#if (AODV_DATA_SEQ_WINDOW % 64) || (AODV_DATA_SEQ_WINDOW > (1 << 15))
+#error "AODV_DATA_SEQ_WINDOW must be a multiple of 64 and at most 32768"
+#endif
+
+#define DS_KEY_EMPTY		UINT64_MAX // no mac address maps to this key
+#define DS_INDEX_MIN_SLOTS	64
+
+/**
+ * Known sources are captured without lock (see aodv_db_ds_capt_data_seq_nolock),
+ * so entries are never freed: an expired entry goes to the free list and may be
+ * reused for another source while a reader still looks at it. Readers detect this
+ * by checking key again after they are done.
+ */
 typedef struct data_packet_id {
-    uint8_t         src_addr[ETH_ALEN]; // key
-    uint16_t        seq_num;
-    UT_hash_handle  hh;
+    uint64_t        key; // hf_mac_addr_to_uint64 of src_addr, DS_KEY_EMPTY while free; read without lock
+    uint8_t         src_addr[ETH_ALEN];
+    uint32_t        seq_num; // highest seq number seen; updated without lock
+    uint64_t        last_used; // ms, last packet captured; updated without lock
+    /** bit (seq % AODV_DATA_SEQ_WINDOW) is set if seq in (seq_num - AODV_DATA_SEQ_WINDOW, seq_num] was seen; updated without lock */
+    uint64_t        window[DS_WINDOW_WORDS];
+    timeslot_node_t ts_node;
+    struct data_packet_id* next_free;
 } data_packet_id_t;
 
+/** open addressing over the entries, searched without lock and changed only under the lock of the table */
+typedef struct ds_index {
+    uint32_t			mask; // slot count - 1
+    uint32_t			used; // slots not NULL, including tombstones
+    struct ds_index*	retired; // replaced index, kept since readers may still search it
+    data_packet_id_t*	slots[];
+} ds_index_t;
+
 typedef struct aodv_ds {
-    data_packet_id_t*	entries;
+    ds_index_t*			index; // replaced under the lock, read without lock
+    uint32_t			count; // entries in index
+    data_packet_id_t*	free_list;
     timeslot_t*			ts;
 } data_seq_t;
 
 data_seq_t ds;
 
-data_packet_id_t* ds_entry_create(mac_addr src_addr, uint16_t seq_num) {
-    data_packet_id_t* new_entry;
-    new_entry = malloc(sizeof(data_packet_id_t));
+/** marks a deleted slot, the probe sequence continues behind it */
+static data_packet_id_t ds_tombstone;
+
+static inline uint32_t ds_hash(uint64_t key) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+static data_packet_id_t* ds_index_find(ds_index_t* index, uint64_t key) {
+    uint32_t i = ds_hash(key) & index->mask;
+
+    while(true) {
+        data_packet_id_t* entry = __atomic_load_n(&index->slots[i], __ATOMIC_ACQUIRE);
+
+        if(entry == NULL) {
+            return NULL;
+        }
+
+        if(entry != &ds_tombstone && __atomic_load_n(&entry->key, __ATOMIC_RELAXED) == key) {
+            return entry;
+        }
+
+        i = (i + 1) & index->mask;
+    }
+}
+
+/** put entry into a slot of index, key of entry must not be in index yet */
+static void ds_index_put(ds_index_t* index, data_packet_id_t* entry) {
+    uint32_t i = ds_hash(entry->key) & index->mask;
+
+    while(true) {
+        data_packet_id_t* curr = index->slots[i];
+
+        if(curr == NULL || curr == &ds_tombstone) {
+            if(curr == NULL) {
+                index->used++;
+            }
+
+            __atomic_store_n(&index->slots[i], entry, __ATOMIC_RELEASE);
+            return;
+        }
+
+        i = (i + 1) & index->mask;
+    }
+}
+
+/** make room for one more entry, building a new index if the current one is half full */
+static int ds_index_reserve() {
+    ds_index_t* index = ds.index;
+
+    if(index != NULL && (index->used + 1) * 2 <= index->mask + 1) {
+        return true;
+    }
+
+    uint32_t slots = DS_INDEX_MIN_SLOTS;
 
-    if(new_entry == NULL) {
-        dessert_warn("malloc returned NULL");
-        return NULL;
+    while(slots < (ds.count + 1) * 4) {
+        slots *= 2;
+    }
+
+    ds_index_t* new_index = calloc(1, sizeof(ds_index_t) + slots * sizeof(data_packet_id_t*));
+
+    if(new_index == NULL) {
+        dessert_warn("calloc returned NULL");
+        return false;
+    }
+
+    new_index->mask = slots - 1;
+    new_index->retired = index;
+
+    if(index != NULL) {
+        uint32_t i;
+
+        for(i = 0; i <= index->mask; i++) {
+            if(index->slots[i] != NULL && index->slots[i] != &ds_tombstone) {
+                ds_index_put(new_index, index->slots[i]);
+            }
+        }
+    }
+
+    // the sizes are geometric, so all retired indexes together are smaller than the current one
+    __atomic_store_n(&ds.index, new_index, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void ds_index_del(data_packet_id_t* entry) {
+    ds_index_t* index = ds.index;
+    uint32_t i = ds_hash(entry->key) & index->mask;
+
+    while(index->slots[i] != entry) {
+        i = (i + 1) & index->mask;
+    }
+
+    __atomic_store_n(&index->slots[i], &ds_tombstone, __ATOMIC_RELEASE);
+}
+
+static inline int ds_window_test_and_set(data_packet_id_t* entry, uint16_t seq_num) {
+    uint32_t bit = seq_num % AODV_DATA_SEQ_WINDOW;
+    uint64_t mask = (uint64_t) 1 << (bit % 64);
+    return (__atomic_fetch_or(&entry->window[bit / 64], mask, __ATOMIC_RELAXED) & mask) != 0;
+}
+
+/** forget shift seq numbers after seq_num, which was the head of the window before it moved */
+static void ds_window_advance(data_packet_id_t* entry, uint16_t seq_num, uint16_t shift) {
+    uint32_t i;
+
+    if(shift >= AODV_DATA_SEQ_WINDOW) {
+        for(i = 0; i < DS_WINDOW_WORDS; i++) {
+            __atomic_store_n(&entry->window[i], 0, __ATOMIC_RELAXED);
+        }
+
+        return;
+    }
+
+    uint16_t seq = seq_num + 1;
+    uint32_t left = shift;
+
+    // each bit is cleared at most once per pass of the window, so this is amortized O(1) per packet
+    while(left > 0) {
+        uint32_t bit = seq % AODV_DATA_SEQ_WINDOW;
+
+        if(bit % 64 == 0 && left >= 64) {
+            __atomic_store_n(&entry->window[bit / 64], 0, __ATOMIC_RELAXED); // whole word leaves the window
+            seq += 64;
+            left -= 64;
+            continue;
+        }
+
+        __atomic_fetch_and(&entry->window[bit / 64], ~((uint64_t) 1 << (bit % 64)), __ATOMIC_RELAXED);
+        seq++;
+        left--;
+    }
+}
+
+/**
+ * Capture data_seq_num in the window of entry, true if it was not seen yet.
+ * The head is moved by compare and swap, so of two threads that race for the same
+ * new seq number only one wins. A packet older than the head that races with a
+ * move of the window may be misjudged, that is at most one duplicate or drop per race.
+ */
+static int ds_window_capture(data_packet_id_t* entry, uint16_t data_seq_num) {
+    uint32_t head = __atomic_load_n(&entry->seq_num, __ATOMIC_RELAXED);
+
+    while(true) {
+        uint16_t ahead = data_seq_num - (uint16_t) head;
+
+        if(ahead == 0 || ahead >= (1 << 15)) {
+            break;
+        }
+
+        //data packet is newer
+        if(__atomic_compare_exchange_n(&entry->seq_num, &head, data_seq_num, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            ds_window_advance(entry, head, ahead);
+            ds_window_test_and_set(entry, data_seq_num);
+            return true;
+        }
+    }
+
+    uint16_t behind = (uint16_t) head - data_seq_num;
+
+    if(behind == 0 || behind >= AODV_DATA_SEQ_WINDOW) {
+        //data packet is a duplicate or too old to tell
+        return false;
+    }
+
+    //data packet is late, new if it was not seen yet (reordered)
+    return !ds_window_test_and_set(entry, data_seq_num);
+}
+
+static data_packet_id_t* ds_entry_create(mac_addr src_addr, uint16_t seq_num, uint64_t now) {
+    data_packet_id_t* new_entry = ds.free_list;
+
+    if(new_entry != NULL) {
+        ds.free_list = new_entry->next_free;
+    } else {
+        new_entry = malloc(sizeof(data_packet_id_t));
+
+        if(new_entry == NULL) {
+            dessert_warn("malloc returned NULL");
+            return NULL;
+        }
     }
 
     mac_copy(new_entry->src_addr, src_addr);
     new_entry->seq_num = seq_num;
+    new_entry->last_used = now;
+    memset(new_entry->window, 0, sizeof(new_entry->window));
+    ds_window_test_and_set(new_entry, seq_num);
+    timeslot_node_init(&new_entry->ts_node, new_entry);
+    new_entry->next_free = NULL;
+    // publish the key last, a reader that still holds the entry from its old source must see the new state
+    __atomic_store_n(&new_entry->key, hf_mac_addr_to_uint64(src_addr), __ATOMIC_RELEASE);
 
     return new_entry;
 }
 
 void db_nt_on_ds_timeout(struct timeval* timestamp, void* src_object, void* object) {
     data_packet_id_t* curr_entry = object;
-    dessert_debug("data seq timeout:" MAC " last_seq_num=% " PRIu16 "", EXPLODE_ARRAY6(curr_entry->src_addr), curr_entry->seq_num);
-    HASH_DEL(ds.entries, curr_entry);
 
-    free(curr_entry);
+    // packets captured without lock do not refresh the lifetime, so check for them lazily
+    uint64_t last_used = __atomic_load_n(&curr_entry->last_used, __ATOMIC_RELAXED);
+
+    if(last_used + AODV_DATA_SEQ_TIMEOUT > hf_tv_to_ms(timestamp)) {
+        struct timeval used;
+        used.tv_sec = last_used / 1000;
+        used.tv_usec = (last_used % 1000) * 1000;
+        timeslot_addnode(ds.ts, &used, &curr_entry->ts_node);
+        return;
+    }
+
+    dessert_debug("data seq timeout:" MAC " last_seq_num=% " PRIu32 "", EXPLODE_ARRAY6(curr_entry->src_addr), curr_entry->seq_num);
+    ds_index_del(curr_entry);
+    ds.count--;
+    __atomic_store_n(&curr_entry->key, DS_KEY_EMPTY, __ATOMIC_RELEASE);
+    curr_entry->next_free = ds.free_list;
+    ds.free_list = curr_entry;
 }
 
 int db_ds_init() {
@@ -70,41 +295,68 @@ int db_ds_init() {
         return false;
     }
 
-    ds.entries = NULL;
+    ds.index = NULL;
+    ds.count = 0;
+    ds.free_list = NULL;
     ds.ts = new_ts;
     return true;
 }
 
-int aodv_db_ds_capt_data_seq(mac_addr src_addr, uint16_t data_seq_num, uint8_t hop_count, struct timeval* timestamp) {
+int aodv_db_ds_capt_data_seq_nolock(mac_addr src_addr, uint16_t data_seq_num, struct timeval* timestamp, int* result_out) {
+    ds_index_t* index = __atomic_load_n(&ds.index, __ATOMIC_ACQUIRE);
 
-    data_packet_id_t* curr_entry = NULL;
-    HASH_FIND(hh, ds.entries, src_addr, ETH_ALEN, curr_entry);
+    if(index == NULL) {
+        return false;
+    }
+
+    uint64_t key = hf_mac_addr_to_uint64(src_addr);
+    data_packet_id_t* curr_entry = ds_index_find(index, key);
 
     if(curr_entry == NULL) {
-        //never got data from this host
+        return false;
+    }
 
-        curr_entry = ds_entry_create(src_addr, data_seq_num);
+    uint64_t now = hf_tv_to_ms(timestamp);
 
-        if(curr_entry == NULL) {
-            return false;
-        }
+    if(__atomic_load_n(&curr_entry->last_used, __ATOMIC_RELAXED) < now) {
+        __atomic_store_n(&curr_entry->last_used, now, __ATOMIC_RELAXED);
+    }
 
-        HASH_ADD_KEYPTR(hh, ds.entries, curr_entry->src_addr, ETH_ALEN, curr_entry);
-        dessert_debug("data seq - new source: " MAC " data_seq=% " PRIu16 "", EXPLODE_ARRAY6(src_addr), data_seq_num);
-        timeslot_addobject(ds.ts, timestamp, curr_entry);
-        return true;
+    int result = ds_window_capture(curr_entry, data_seq_num);
+
+    // the entry expired and was reused for another source meanwhile, let the caller retry under the lock
+    if(__atomic_load_n(&curr_entry->key, __ATOMIC_ACQUIRE) != key) {
+        return false;
     }
 
-    //data source is known
-    if((curr_entry->seq_num - data_seq_num > (1 << 15)) || (curr_entry->seq_num < data_seq_num)) {
-        //data packet is newer
-        curr_entry->seq_num = data_seq_num;
-        timeslot_addobject(ds.ts, timestamp, curr_entry);
-        return true;
+    *result_out = result;
+    return true;
+}
+
+int aodv_db_ds_capt_data_seq(mac_addr src_addr, uint16_t data_seq_num, uint8_t hop_count, struct timeval* timestamp) {
+    int result;
+
+    if(aodv_db_ds_capt_data_seq_nolock(src_addr, data_seq_num, timestamp, &result)) {
+        return result;
+    }
+
+    //never got data from this host
+    if(!ds_index_reserve()) {
+        return false;
     }
 
-    //data packet is old
-    return false;
+    data_packet_id_t* curr_entry = ds_entry_create(src_addr, data_seq_num, hf_tv_to_ms(timestamp));
+
+    if(curr_entry == NULL) {
+        return false;
+    }
+
+    ds_index_put(ds.index, curr_entry);
+    ds.count++;
+
+    dessert_debug("data seq - new source: " MAC " data_seq=% " PRIu16 "", EXPLODE_ARRAY6(src_addr), data_seq_num);
+    timeslot_addnode(ds.ts, timestamp, &curr_entry->ts_node);
+    return true;
 }
 
 void ds_report(char** str_out) {
@@ -115,3 +367,7 @@ int db_ds_cleanup(struct timeval* timestamp) {
     return timeslot_purgeobjects(ds.ts, timestamp);
 }
 
+int db_ds_next_expiry(struct timeval* next_out) {
+    return timeslot_next_expiry(ds.ts, next_out);
+}
+
@@ -22,8 +22,8 @@ For further information and questions please use the web site
 *******************************************************************************/
 
 #include <dessert.h>
-#include <uthash.h>
 #include "../timeslot.h"
+#include "../hashmap.h"
 #include "../../config.h"
 #include "../../helper.h"
 
@@ -34,10 +34,20 @@ For further information and questions please use the web site
 /** initialize neighbor table */
 int db_ds_init();
 
+/** must be called with the lock of the table held for writing */
 int aodv_db_ds_capt_data_seq(mac_addr src_addr, uint16_t data_seq_num, uint8_t hop_count, struct timeval* timestamp);
 
+/**
+ * Capture data_seq_num of a known source without any lock and store in result_out
+ * whether it was new. Returns false if the source is unknown and the caller has to
+ * take the lock and call aodv_db_ds_capt_data_seq instead.
+ */
+int aodv_db_ds_capt_data_seq_nolock(mac_addr src_addr, uint16_t data_seq_num, struct timeval* timestamp, int* result_out);
+
 int db_ds_cleanup(struct timeval* timestamp);
 
+int db_ds_next_expiry(struct timeval* next_out);
+
 void ds_report(char** str_out);
 
 void db_ds_on_neigbor_timeout(struct timeval* timestamp, void* src_object, void* object);
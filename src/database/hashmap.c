@@ -0,0 +1,235 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "hashmap.h"
+#include "../config.h"
+
+#define HASHMAP_MIN_CAPACITY	HASHMAP_GROUP
+
+static inline uint64_t hashmap_hash(uint64_t key) {
+    // murmur3 finalizer; MAC addresses share their vendor bytes, so mix all of them
+    key ^= key >> 33;
+    key *= UINT64_C(0xff51afd7ed558ccd);
+    key ^= key >> 33;
+    key *= UINT64_C(0xc4ceb9fe1a85ec53);
+    key ^= key >> 33;
+    return key;
+}
+
+/** bit i is set if group[i] == key; written branch free so it vectorizes */
+static inline uint32_t hashmap_group_match(const uint64_t* group, uint64_t key) {
+    uint32_t mask = 0;
+    uint32_t i;
+
+    for(i = 0; i < HASHMAP_GROUP; ++i) {
+        mask |= (uint32_t)(group[i] == key) << i;
+    }
+
+    return mask;
+}
+
+/** bit i is set if group[i] may take a new key */
+static inline uint32_t hashmap_group_free(const uint64_t* group) {
+    uint32_t mask = 0;
+    uint32_t i;
+
+    for(i = 0; i < HASHMAP_GROUP; ++i) {
+        mask |= (uint32_t)(group[i] >= HASHMAP_DELETED) << i;
+    }
+
+    return mask;
+}
+
+/** index of key or capacity if it is not in the map */
+static uint32_t hashmap_lookup(hashmap_t* map, uint64_t key) {
+    if(map->capacity == 0) {
+        return 0;
+    }
+
+    uint32_t mask = map->capacity - 1;
+    uint32_t group = (uint32_t) hashmap_hash(key) & mask & ~(HASHMAP_GROUP - 1);
+    uint32_t probed;
+
+    for(probed = 0; probed < map->capacity; probed += HASHMAP_GROUP) {
+        const uint64_t* keys = map->keys + group;
+        uint32_t match = hashmap_group_match(keys, key);
+
+        if(match) {
+            return group + __builtin_ctz(match);
+        }
+
+        // nothing ever probed past a group with an empty slot
+        if(hashmap_group_match(keys, HASHMAP_EMPTY)) {
+            break;
+        }
+
+        group = (group + HASHMAP_GROUP) & mask;
+    }
+
+    return map->capacity;
+}
+
+/** store key in the first free slot of its probe sequence; key must not be in the map */
+static void hashmap_insert(hashmap_t* map, uint64_t key, void* value) {
+    uint32_t mask = map->capacity - 1;
+    uint32_t group = (uint32_t) hashmap_hash(key) & mask & ~(HASHMAP_GROUP - 1);
+
+    while(true) {
+        uint32_t free_slots = hashmap_group_free(map->keys + group);
+
+        if(free_slots) {
+            uint32_t idx = group + __builtin_ctz(free_slots);
+
+            if(map->keys[idx] == HASHMAP_EMPTY) {
+                map->used++;
+            }
+
+            map->keys[idx] = key;
+            map->values[idx] = value;
+            map->count++;
+            return;
+        }
+
+        group = (group + HASHMAP_GROUP) & mask;
+    }
+}
+
+static int hashmap_resize(hashmap_t* map, uint32_t capacity) {
+    uint64_t* keys;
+    void** values = malloc(capacity * sizeof(void*));
+
+    // keys are aligned so that every group is one cache line
+    if(values == NULL || posix_memalign((void**) &keys, HASHMAP_GROUP * sizeof(uint64_t), capacity * sizeof(uint64_t)) != 0) {
+        free(values);
+        return false;
+    }
+
+    memset(keys, 0xff, capacity * sizeof(uint64_t)); // HASHMAP_EMPTY
+
+    hashmap_t old = *map;
+    map->keys = keys;
+    map->values = values;
+    map->capacity = capacity;
+    map->count = 0;
+    map->used = 0;
+
+    uint32_t i;
+
+    for(i = 0; i < old.capacity; ++i) {
+        if(old.keys[i] < HASHMAP_DELETED) {
+            hashmap_insert(map, old.keys[i], old.values[i]);
+        }
+    }
+
+    free(old.keys);
+    free(old.values);
+    return true;
+}
+
+void hashmap_init(hashmap_t* map) {
+    map->keys = NULL;
+    map->values = NULL;
+    map->capacity = 0;
+    map->count = 0;
+    map->used = 0;
+}
+
+void hashmap_destroy(hashmap_t* map) {
+    free(map->keys);
+    free(map->values);
+    hashmap_init(map);
+}
+
+void* hashmap_find(hashmap_t* map, uint64_t key) {
+    uint32_t idx = hashmap_lookup(map, key);
+    return (idx < map->capacity) ? map->values[idx] : NULL;
+}
+
+int hashmap_add(hashmap_t* map, uint64_t key, void* value) {
+    uint32_t idx = hashmap_lookup(map, key);
+
+    if(idx < map->capacity) {
+        map->values[idx] = value;
+        return true;
+    }
+
+    // keep at least a quarter of the slots empty so that probes stay short
+    if((map->used + 1) * 4 > map->capacity * 3) {
+        uint32_t capacity = max(map->capacity, HASHMAP_MIN_CAPACITY);
+
+        // only grow if the live entries need it, otherwise just drop the deleted slots
+        while((map->count + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+
+        if(!hashmap_resize(map, capacity)) {
+            return false;
+        }
+    }
+
+    hashmap_insert(map, key, value);
+    return true;
+}
+
+int hashmap_del(hashmap_t* map, uint64_t key) {
+    uint32_t idx = hashmap_lookup(map, key);
+
+    if(idx >= map->capacity) {
+        return false;
+    }
+
+    uint32_t group = idx & ~(HASHMAP_GROUP - 1);
+
+    // a group that already has an empty slot was never probed past, so the slot can be reused right away
+    if(hashmap_group_match(map->keys + group, HASHMAP_EMPTY)) {
+        map->keys[idx] = HASHMAP_EMPTY;
+        map->used--;
+    }
+    else {
+        map->keys[idx] = HASHMAP_DELETED;
+    }
+
+    map->values[idx] = NULL;
+    map->count--;
+    return true;
+}
+
+int hashmap_next(hashmap_t* map, uint32_t* pos, uint64_t* key_out, void** value_out) {
+    while(*pos < map->capacity) {
+        uint32_t idx = (*pos)++;
+
+        if(map->keys[idx] < HASHMAP_DELETED) {
+            if(key_out != NULL) {
+                *key_out = map->keys[idx];
+            }
+
+            *value_out = map->values[idx];
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,80 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#ifndef AODV_HASHMAP
+#define AODV_HASHMAP
+
+#include <stdint.h>
+
+/**
+ * Flat open addressing hash map from 64 bit keys to pointers, used by all
+ * database tables. MAC addresses are stored as returned by
+ * hf_mac_addr_to_uint64, composite keys are packed into the unused upper
+ * 16 bits. The keys live in one contiguous array that is probed in groups of
+ * HASHMAP_GROUP keys (one cache line), so a lookup usually touches a single
+ * line of keys and one of values instead of walking a chain.
+ *
+ * The two largest key values are reserved for empty and deleted slots.
+ * Deleting during hashmap_next is fine; adding is not, since it may rehash.
+ * The map is not locked, callers hold the lock of the table it belongs to.
+ */
+#define HASHMAP_GROUP		8
+#define HASHMAP_EMPTY		UINT64_MAX
+#define HASHMAP_DELETED		(UINT64_MAX - 1)
+
+typedef struct hashmap {
+    uint64_t*	keys;
+    void**		values;
+    uint32_t	capacity; // power of two and multiple of HASHMAP_GROUP, 0 before the first add
+    uint32_t	count; // live entries
+    uint32_t	used; // live and deleted slots
+} hashmap_t;
+
+/** Prepare an empty map; nothing is allocated until the first add */
+void hashmap_init(hashmap_t* map);
+
+/** Free the slots of the map; the values are left to the caller */
+void hashmap_destroy(hashmap_t* map);
+
+/** Returns the value stored for key or NULL */
+void* hashmap_find(hashmap_t* map, uint64_t key);
+
+/** Add key or replace its value; returns false if the map could not grow */
+int hashmap_add(hashmap_t* map, uint64_t key, void* value);
+
+/** Remove key; returns false if it was not in the map */
+int hashmap_del(hashmap_t* map, uint64_t key);
+
+/**
+ * Iterate over all entries; *pos has to be 0 for the first call.
+ * Returns false after the last entry. key_out may be NULL.
+ */
+int hashmap_next(hashmap_t* map, uint32_t* pos, uint64_t* key_out, void** value_out);
+
+static inline uint32_t hashmap_count(hashmap_t* map) __attribute__ ((__unused__));
+static inline uint32_t hashmap_count(hashmap_t* map) {
+    return map->count;
+}
+
+#endif
@@ -0,0 +1,194 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "lockstat.h"
+#include "../config.h"
+#include "../pipeline/aodv_latency.h"
+
+typedef struct lockstat_held {
+    void* lock;
+    lockstat_data_t* data;
+    uint64_t acquired;
+} lockstat_held_t;
+
+bool lockstat_enabled = false;
+__thread uint32_t lockstat_held_count = 0;
+static __thread lockstat_held_t held[LOCKSTAT_MAX_HELD];
+
+// every site that was used while profiling, sites are never removed
+static lockstat_data_t* sites = NULL;
+static uint32_t site_count = 0;
+static pthread_mutex_t lockstat_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* mode_names[] = {
+    [LOCKSTAT_READ] = "read",
+    [LOCKSTAT_WRITE] = "write",
+    [LOCKSTAT_MUTEX] = "mutex",
+};
+
+static lockstat_data_t* lockstat_data(lockstat_site_t* site) {
+    lockstat_data_t* data = __atomic_load_n(&site->data, __ATOMIC_ACQUIRE);
+
+    if(__builtin_expect(data != NULL, 1)) {
+        return data;
+    }
+
+    pthread_mutex_lock(&lockstat_mutex);
+    data = site->data;
+    if(!data) {
+        data = calloc(1, sizeof(lockstat_data_t));
+        if(data) {
+            data->site = site;
+            data->next = sites;
+            sites = data;
+            site_count++;
+            __atomic_store_n(&site->data, data, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&lockstat_mutex);
+    return data;
+}
+
+static void lockstat_acquired(void* lock, lockstat_data_t* data, uint64_t start, int contended) {
+    uint64_t now = aodv_latency_cycles();
+
+    __atomic_fetch_add(&data->count, 1, __ATOMIC_RELAXED);
+    if(contended) {
+        __atomic_fetch_add(&data->contended, 1, __ATOMIC_RELAXED);
+    }
+    aodv_hist_add(&data->wait, now - start);
+
+    // deeper nesting is counted, but its hold time is not measured
+    if(lockstat_held_count < LOCKSTAT_MAX_HELD) {
+        held[lockstat_held_count].lock = lock;
+        held[lockstat_held_count].data = data;
+        held[lockstat_held_count].acquired = now;
+        lockstat_held_count++;
+    }
+}
+
+void lockstat_rw_slow(pthread_rwlock_t* lock, lockstat_site_t* site) {
+    lockstat_data_t* data = lockstat_data(site);
+    uint64_t start = aodv_latency_cycles();
+    int contended;
+
+    if(site->mode == LOCKSTAT_READ) {
+        contended = (pthread_rwlock_tryrdlock(lock) != 0);
+        if(contended) {
+            pthread_rwlock_rdlock(lock);
+        }
+    }
+    else {
+        contended = (pthread_rwlock_trywrlock(lock) != 0);
+        if(contended) {
+            pthread_rwlock_wrlock(lock);
+        }
+    }
+
+    if(data) {
+        lockstat_acquired(lock, data, start, contended);
+    }
+}
+
+void lockstat_mutex_slow(pthread_mutex_t* mutex, lockstat_site_t* site) {
+    lockstat_data_t* data = lockstat_data(site);
+    uint64_t start = aodv_latency_cycles();
+    int contended = (pthread_mutex_trylock(mutex) != 0);
+
+    if(contended) {
+        pthread_mutex_lock(mutex);
+    }
+
+    if(data) {
+        lockstat_acquired(mutex, data, start, contended);
+    }
+}
+
+void lockstat_release(void* lock) {
+    uint64_t now = aodv_latency_cycles();
+    uint32_t i = lockstat_held_count;
+
+    // read locks may be held several times, the latest one is released
+    while(i > 0) {
+        --i;
+        if(held[i].lock == lock) {
+            aodv_hist_add(&held[i].data->hold, now - held[i].acquired);
+            memmove(&held[i], &held[i + 1], (lockstat_held_count - i - 1) * sizeof(lockstat_held_t));
+            lockstat_held_count--;
+            return;
+        }
+    }
+}
+
+void lockstat_enable(bool enable) {
+    lockstat_data_t* data;
+
+    pthread_mutex_lock(&lockstat_mutex);
+    if(enable) {
+        aodv_latency_calibrate();
+
+        for(data = sites; data; data = data->next) {
+            __atomic_store_n(&data->count, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&data->contended, 0, __ATOMIC_RELAXED);
+            aodv_hist_clear(&data->wait);
+            aodv_hist_clear(&data->hold);
+        }
+    }
+    __atomic_store_n(&lockstat_enabled, enable, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&lockstat_mutex);
+}
+
+int lockstat_snapshot(lockstat_data_t** entries_out, uint32_t* count_out) {
+    lockstat_data_t* data;
+    uint32_t i = 0;
+
+    pthread_mutex_lock(&lockstat_mutex);
+    lockstat_data_t* entries = malloc((site_count ? site_count : 1) * sizeof(lockstat_data_t));
+
+    if(!entries) {
+        pthread_mutex_unlock(&lockstat_mutex);
+        return false;
+    }
+
+    for(data = sites; data; data = data->next) {
+        entries[i].site = data->site;
+        entries[i].next = NULL;
+        entries[i].count = __atomic_load_n(&data->count, __ATOMIC_RELAXED);
+        entries[i].contended = __atomic_load_n(&data->contended, __ATOMIC_RELAXED);
+        aodv_hist_read(&data->wait, &entries[i].wait);
+        aodv_hist_read(&data->hold, &entries[i].hold);
+        i++;
+    }
+    pthread_mutex_unlock(&lockstat_mutex);
+
+    *entries_out = entries;
+    *count_out = i;
+    return true;
+}
+
+const char* lockstat_mode_name(lockstat_mode_t mode) {
+    return mode_names[mode];
+}
@@ -0,0 +1,132 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#ifndef LOCKSTAT
+#define LOCKSTAT
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../pipeline/aodv_histogram.h"
+
+/**
+ * Instrumented locking. The macros below replace the pthread lock calls of
+ * the database facade and the pipeline. Every call site owns a static
+ * lockstat_site_t naming the lock and the calling function. While lock
+ * profiling is switched on, each site counts its acquisitions, how many of
+ * them had to wait, and keeps histograms of wait and hold times in cycles.
+ * While it is off, every lock and unlock costs one extra branch.
+ *
+ * Hold times are measured with a per-thread stack of held locks. An unlock
+ * finds the matching entry by the address of the lock, so locks may be
+ * released in any order and by helpers other than the locking function.
+ */
+
+typedef enum lockstat_mode {
+    LOCKSTAT_READ = 0,
+    LOCKSTAT_WRITE,
+    LOCKSTAT_MUTEX
+} lockstat_mode_t;
+
+typedef struct lockstat_data {
+    struct lockstat_site* site;
+    struct lockstat_data* next;
+    uint64_t count;
+    uint64_t contended; // the first try to lock failed
+    aodv_hist_t wait;
+    aodv_hist_t hold;
+} lockstat_data_t;
+
+typedef struct lockstat_site {
+    const char* lock_name;
+    const char* caller;
+    lockstat_mode_t mode;
+    lockstat_data_t* data; // allocated on first use while profiling
+} lockstat_site_t;
+
+extern bool lockstat_enabled;
+extern __thread uint32_t lockstat_held_count;
+
+/** static site of the calling function, name is the (logical) lock name */
+#define LOCKSTAT_SITE(name, mode) ({ static lockstat_site_t lockstat_site_ = { name, __func__, mode, NULL }; &lockstat_site_; })
+
+#define lockstat_rdlock(lock, name) lockstat_rw_at(lock, LOCKSTAT_SITE(name, LOCKSTAT_READ))
+#define lockstat_wrlock(lock, name) lockstat_rw_at(lock, LOCKSTAT_SITE(name, LOCKSTAT_WRITE))
+#define lockstat_mutex_lock(mutex, name) lockstat_mutex_at(mutex, LOCKSTAT_SITE(name, LOCKSTAT_MUTEX))
+
+void lockstat_rw_slow(pthread_rwlock_t* lock, lockstat_site_t* site);
+void lockstat_mutex_slow(pthread_mutex_t* mutex, lockstat_site_t* site);
+void lockstat_release(void* lock);
+
+static inline void lockstat_rw_at(pthread_rwlock_t* lock, lockstat_site_t* site) __attribute__ ((__unused__));
+static inline void lockstat_rw_at(pthread_rwlock_t* lock, lockstat_site_t* site) {
+    if(__builtin_expect(__atomic_load_n(&lockstat_enabled, __ATOMIC_RELAXED), 0)) {
+        lockstat_rw_slow(lock, site);
+    }
+    else if(site->mode == LOCKSTAT_READ) {
+        pthread_rwlock_rdlock(lock);
+    }
+    else {
+        pthread_rwlock_wrlock(lock);
+    }
+}
+
+static inline void lockstat_mutex_at(pthread_mutex_t* mutex, lockstat_site_t* site) __attribute__ ((__unused__));
+static inline void lockstat_mutex_at(pthread_mutex_t* mutex, lockstat_site_t* site) {
+    if(__builtin_expect(__atomic_load_n(&lockstat_enabled, __ATOMIC_RELAXED), 0)) {
+        lockstat_mutex_slow(mutex, site);
+    }
+    else {
+        pthread_mutex_lock(mutex);
+    }
+}
+
+static inline void lockstat_unlock(pthread_rwlock_t* lock) __attribute__ ((__unused__));
+static inline void lockstat_unlock(pthread_rwlock_t* lock) {
+    if(__builtin_expect(lockstat_held_count, 0)) {
+        lockstat_release(lock);
+    }
+    pthread_rwlock_unlock(lock);
+}
+
+static inline void lockstat_mutex_unlock(pthread_mutex_t* mutex) __attribute__ ((__unused__));
+static inline void lockstat_mutex_unlock(pthread_mutex_t* mutex) {
+    if(__builtin_expect(lockstat_held_count, 0)) {
+        lockstat_release(mutex);
+    }
+    pthread_mutex_unlock(mutex);
+}
+
+/** switch lock profiling on or off, switching it on clears all statistics */
+void lockstat_enable(bool enable);
+
+/**
+ * copy of the statistics of every site used while profiling; entries_out must
+ * be freed by the caller
+ */
+int lockstat_snapshot(lockstat_data_t** entries_out, uint32_t* count_out);
+
+const char* lockstat_mode_name(lockstat_mode_t mode);
+
+#endif
@@ -24,25 +24,66 @@ For further information and questions please use the web site
 #include "nt.h"
 #include "../timeslot.h"
 #include "../../config.h"
-#include "../schedule_table/aodv_st.h"
+#include "../../helper.h"
+#include "../aodv_database.h"
+#include "../hashmap.h"
 
 typedef struct neighbor_entry {
-    struct __attribute__((__packed__)) {  // key
-        uint8_t             ether_neighbor[ETH_ALEN];
-        dessert_meshif_t*   iface;
-        uint16_t            last_hello_seq;
-        int8_t              max_rssi;
-    };
-    UT_hash_handle          hh;
+    uint8_t                 ether_neighbor[ETH_ALEN]; // key together with iface
+    dessert_meshif_t*       iface;
+    uint16_t                last_hello_seq;
+    int8_t                  max_rssi;
+    struct neighbor_entry*  next; // same neighbor seen over another interface
+    timeslot_node_t         ts_node;
 } neighbor_entry_t;
 
+/** entries maps the neighbor address to the list of its entries, one per interface */
 typedef struct neighbor_table {
-    neighbor_entry_t*   entries;
+    hashmap_t           entries;
     timeslot_t*         ts;
 } neighbor_table_t;
 
 neighbor_table_t nt;
 
+static neighbor_entry_t* nt_find(mac_addr ether_neighbor_addr, dessert_meshif_t* iface) {
+    neighbor_entry_t* curr_entry = hashmap_find(&nt.entries, hf_mac_addr_to_uint64(ether_neighbor_addr));
+
+    while(curr_entry != NULL && curr_entry->iface != iface) {
+        curr_entry = curr_entry->next;
+    }
+
+    return curr_entry;
+}
+
+static int nt_add(neighbor_entry_t* new_entry) {
+    uint64_t key = hf_mac_addr_to_uint64(new_entry->ether_neighbor);
+    new_entry->next = hashmap_find(&nt.entries, key);
+    return hashmap_add(&nt.entries, key, new_entry);
+}
+
+static void nt_del(neighbor_entry_t* del_entry) {
+    uint64_t key = hf_mac_addr_to_uint64(del_entry->ether_neighbor);
+    neighbor_entry_t* head = hashmap_find(&nt.entries, key);
+
+    if(head == del_entry) {
+        if(del_entry->next != NULL) {
+            hashmap_add(&nt.entries, key, del_entry->next); // replaces, never allocates
+        }
+        else {
+            hashmap_del(&nt.entries, key);
+        }
+        return;
+    }
+
+    while(head != NULL && head->next != del_entry) {
+        head = head->next;
+    }
+
+    if(head != NULL) {
+        head->next = del_entry->next;
+    }
+}
+
 neighbor_entry_t* db_neighbor_entry_create(mac_addr ether_neighbor_addr, dessert_meshif_t* iface) {
     neighbor_entry_t* new_entry;
     new_entry = malloc(sizeof(neighbor_entry_t));
@@ -55,26 +96,24 @@ neighbor_entry_t* db_neighbor_entry_create(mac_addr ether_neighbor_addr, dessert
     new_entry->iface = iface;
     new_entry->last_hello_seq = 0; /* initial */
     new_entry->max_rssi = AODV_SIGNAL_STRENGTH_INIT;
+    new_entry->next = NULL;
+    timeslot_node_init(&new_entry->ts_node, new_entry);
     return new_entry;
 }
 
 void db_nt_on_neigbor_timeout(struct timeval* timestamp, void* src_object, void* object) {
     neighbor_entry_t* curr_entry = object;
     dessert_debug("%s <= x => " MAC, curr_entry->iface->if_name, EXPLODE_ARRAY6(curr_entry->ether_neighbor));
-    HASH_DEL(nt.entries, curr_entry);
+    nt_del(curr_entry);
 
-    aodv_db_sc_addschedule(timestamp, curr_entry->ether_neighbor, AODV_SC_SEND_OUT_RERR, 0);
-    aodv_db_sc_dropschedule(curr_entry->ether_neighbor, AODV_SC_UPDATE_RSSI);
+    aodv_db_addschedule(timestamp, curr_entry->ether_neighbor, AODV_SC_SEND_OUT_RERR, 0);
+    aodv_db_dropschedule(curr_entry->ether_neighbor, AODV_SC_UPDATE_RSSI);
     free(curr_entry);
 }
 
 #ifndef ANDROID
 int db_nt_reset_rssi(mac_addr ether_neighbor_addr, dessert_meshif_t* iface, struct timeval* timestamp) {
-    neighbor_entry_t* curr_entry = NULL;
-    uint8_t addr_sum[ETH_ALEN + sizeof(void*)];
-    mac_copy(addr_sum, ether_neighbor_addr);
-    memcpy(addr_sum + ETH_ALEN, &iface, sizeof(void*));
-    HASH_FIND(hh, nt.entries, addr_sum, ETH_ALEN + sizeof(void*), curr_entry);
+    neighbor_entry_t* curr_entry = nt_find(ether_neighbor_addr, iface);
 
     if(curr_entry == NULL) {
         return false;
@@ -88,11 +127,7 @@ int db_nt_reset_rssi(mac_addr ether_neighbor_addr, dessert_meshif_t* iface, stru
 
 int8_t db_nt_update_rssi(mac_addr ether_neighbor_addr, dessert_meshif_t* iface, struct timeval* timestamp) {
 
-    neighbor_entry_t* curr_entry = NULL;
-    uint8_t addr_sum[ETH_ALEN + sizeof(void*)];
-    mac_copy(addr_sum, ether_neighbor_addr);
-    memcpy(addr_sum + ETH_ALEN, &iface, sizeof(void*));
-    HASH_FIND(hh, nt.entries, addr_sum, ETH_ALEN + sizeof(void*), curr_entry);
+    neighbor_entry_t* curr_entry = nt_find(ether_neighbor_addr, iface);
 
     if(curr_entry == NULL) {
         return 0;
@@ -128,7 +163,7 @@ int db_nt_init() {
         return false;
     }
 
-    nt.entries = NULL;
+    hashmap_init(&nt.entries);
     nt.ts = new_ts;
     return true;
 }
@@ -137,13 +172,19 @@ int aodv_db_nt_neighbor_destroy(uint32_t* count_out) {
     *count_out = 0;
 
     neighbor_entry_t* neigh = NULL;
-    neighbor_entry_t* tmp = NULL;
-    HASH_ITER(hh, nt.entries, neigh, tmp) {
-        aodv_db_sc_dropschedule(neigh->ether_neighbor, AODV_SC_UPDATE_RSSI);
-        HASH_DEL(nt.entries, neigh);
-        free(neigh);
-        (*count_out)++;
+    uint32_t pos = 0;
+
+    while(hashmap_next(&nt.entries, &pos, NULL, (void**) &neigh)) {
+        while(neigh != NULL) {
+            neighbor_entry_t* next = neigh->next;
+            aodv_db_dropschedule(neigh->ether_neighbor, AODV_SC_UPDATE_RSSI);
+            free(neigh);
+            neigh = next;
+            (*count_out)++;
+        }
     }
+
+    hashmap_destroy(&nt.entries);
     return true;
 }
 
@@ -158,11 +199,7 @@ int aodv_db_nt_neighbor_reset(uint32_t* count_out) {
 }
 
 int db_nt_cap2Dneigh(mac_addr ether_neighbor_addr, uint16_t hello_seq, dessert_meshif_t* iface, struct timeval* timestamp) {
-    neighbor_entry_t* curr_entry = NULL;
-    uint8_t addr_sum[ETH_ALEN + sizeof(void*)];
-    mac_copy(addr_sum, ether_neighbor_addr);
-    memcpy(addr_sum + ETH_ALEN, &iface, sizeof(void*));
-    HASH_FIND(hh, nt.entries, addr_sum, ETH_ALEN + sizeof(void*), curr_entry);
+    neighbor_entry_t* curr_entry = nt_find(ether_neighbor_addr, iface);
 
     if(curr_entry == NULL) {
         //this neigbor is new, so create an entry
@@ -172,7 +209,11 @@ int db_nt_cap2Dneigh(mac_addr ether_neighbor_addr, uint16_t hello_seq, dessert_m
             return false;
         }
 
-        HASH_ADD_KEYPTR(hh, nt.entries, curr_entry->ether_neighbor, ETH_ALEN + sizeof(void*), curr_entry);
+        if(!nt_add(curr_entry)) {
+            free(curr_entry);
+            return false;
+        }
+
         dessert_debug("%s <=====> " MAC, iface->if_name, EXPLODE_ARRAY6(ether_neighbor_addr));
     }
 
@@ -180,20 +221,16 @@ int db_nt_cap2Dneigh(mac_addr ether_neighbor_addr, uint16_t hello_seq, dessert_m
 
     if(signal_strength_threshold > 0) {
         /* preemptive rreq is turned on */
-        aodv_db_sc_addschedule(timestamp, curr_entry->ether_neighbor, AODV_SC_UPDATE_RSSI, (void*) iface);
+        aodv_db_addschedule(timestamp, curr_entry->ether_neighbor, AODV_SC_UPDATE_RSSI, (void*) iface);
     }
 
-    timeslot_addobject(nt.ts, timestamp, curr_entry);
+    timeslot_addnode(nt.ts, timestamp, &curr_entry->ts_node);
     return true;
 }
 
 int db_nt_check2Dneigh(mac_addr ether_neighbor_addr, dessert_meshif_t* iface, struct timeval* timestamp) {
     timeslot_purgeobjects(nt.ts, timestamp);
-    neighbor_entry_t* curr_entry;
-    uint8_t addr_sum[ETH_ALEN + sizeof(void*)];
-    mac_copy(addr_sum, ether_neighbor_addr);
-    memcpy(addr_sum + ETH_ALEN, &iface, sizeof(void*));
-    HASH_FIND(hh, nt.entries, addr_sum, ETH_ALEN + sizeof(void*), curr_entry);
+    neighbor_entry_t* curr_entry = nt_find(ether_neighbor_addr, iface);
 
     if(curr_entry == NULL) {
         return false;
@@ -209,3 +246,7 @@ void nt_report(char** str_out) {
 int db_nt_cleanup(struct timeval* timestamp) {
     return timeslot_purgeobjects(nt.ts, timestamp);
 }
+
+int db_nt_next_expiry(struct timeval* next_out) {
+    return timeslot_next_expiry(nt.ts, next_out);
+}
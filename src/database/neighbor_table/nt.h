@@ -51,6 +51,8 @@ int db_nt_check2Dneigh(mac_addr ether_neighbor_addr, dessert_meshif_t* iface, st
 
 int db_nt_cleanup(struct timeval* timestamp);
 
+int db_nt_next_expiry(struct timeval* next_out);
+
 void nt_report(char** str_out);
 
 void db_nt_on_neigbor_timeout(struct timeval* timestamp, void* src_object, void* object);
@@ -23,159 +23,252 @@ For further information and questions please use the web site
 
 #include "packet_buffer.h"
 #include "../../config.h"
+#include "../../helper.h"
 #include "../timeslot.h"
-
-
-typedef struct fifo_list_el {
-    dessert_msg_t*          msg;
-    struct fifo_list_el*    next;
-} fifo_list_el_t;
-
-typedef struct fifo_list {
-    fifo_list_el_t* head;
-    fifo_list_el_t* tail;
-    uint32_t        size;
-} fifo_list_t;
+#include "../hashmap.h"
+#include <string.h>
+#include <utlist.h>
 
 /**
- * Packet buffer element
+ * Packet buffer element: the packets for one destination in a ring buffer that
+ * is allocated once with room for pb_dest_max_packets packets.
  */
 typedef struct pb_el {
     uint8_t         dhost_ether[ETH_ALEN];
-    fifo_list_t     fl;
-    UT_hash_handle  hh;
+    dessert_msg_t** ring;
+    uint32_t        capacity;
+    uint32_t        head; // index of the oldest packet
+    uint32_t        count;
+    uint32_t        bytes;
+    timeslot_node_t ts_node;
+    struct pb_el*   prev; // age list, destination buffered first comes first
+    struct pb_el*   next;
 } pb_el_t;
 
 /**
  * Packet buffer
  */
 typedef struct pb {
-    pb_el_t*    entries;
-    timeslot_t* ts;
+    hashmap_t       entries;
+    pb_el_t*        age_list;
+    timeslot_t*     ts;
+    aodv_pb_stats_t stats;
 } pb_t;
 
 pb_t pbt;
 
-void purge_packets(struct timeval* timestamp, void* src_object, void* object) {
-    dessert_debug("purging packet buffer");
-    pb_el_t* pb_el = object;
-    fifo_list_el_t* fl_el = pb_el->fl.head;
+static inline uint32_t pb_msg_size(dessert_msg_t* msg) {
+    return msg->hlen + msg->plen;
+}
+
+/** memory of a destination besides its packets */
+static inline uint32_t pb_el_overhead(pb_el_t* pb_el) {
+    return sizeof(pb_el_t) + pb_el->capacity * sizeof(dessert_msg_t*);
+}
 
-    while(fl_el != NULL) {
-        dessert_msg_destroy(pb_el->fl.head->msg);
-        pb_el->fl.head = pb_el->fl.head->next;
-        free(fl_el);
-        fl_el = pb_el->fl.head;
+static pb_el_t* pb_el_create(mac_addr dhost_ether) {
+    pb_el_t* pb_el = malloc(sizeof(pb_el_t));
+
+    if(pb_el == NULL) {
+        return NULL;
     }
 
-    HASH_DEL(pbt.entries, pb_el);
+    pb_el->capacity = min(max(pb_dest_max_packets, 1), PB_DEST_MAX_PACKETS_LIMIT);
+    pb_el->ring = malloc(pb_el->capacity * sizeof(dessert_msg_t*));
+
+    if(pb_el->ring == NULL) {
+        free(pb_el);
+        return NULL;
+    }
+
+    if(!hashmap_add(&pbt.entries, hf_mac_addr_to_uint64(dhost_ether), pb_el)) {
+        free(pb_el->ring);
+        free(pb_el);
+        return NULL;
+    }
+
+    mac_copy(pb_el->dhost_ether, dhost_ether);
+    pb_el->head = 0;
+    pb_el->count = 0;
+    pb_el->bytes = 0;
+    timeslot_node_init(&pb_el->ts_node, pb_el);
+    DL_APPEND(pbt.age_list, pb_el);
+    pbt.stats.destinations++;
+    pbt.stats.overhead += pb_el_overhead(pb_el);
+    return pb_el;
+}
+
+/** remove the oldest packet of the destination */
+static dessert_msg_t* pb_el_take(pb_el_t* pb_el) {
+    dessert_msg_t* msg = pb_el->ring[pb_el->head];
+    uint32_t size = pb_msg_size(msg);
+
+    pb_el->head = (pb_el->head + 1) % pb_el->capacity;
+    pb_el->count--;
+    pb_el->bytes -= size;
+    pbt.stats.packets--;
+    pbt.stats.bytes -= size;
+    return msg;
+}
+
+/** free the destination and all of its packets */
+static void pb_el_destroy(pb_el_t* pb_el) {
+    while(pb_el->count > 0) {
+        dessert_msg_destroy(pb_el_take(pb_el));
+    }
+
+    hashmap_del(&pbt.entries, hf_mac_addr_to_uint64(pb_el->dhost_ether));
+    DL_DELETE(pbt.age_list, pb_el);
+    timeslot_deletenode(pbt.ts, &pb_el->ts_node);
+    pbt.stats.destinations--;
+    pbt.stats.overhead -= pb_el_overhead(pb_el);
+    free(pb_el->ring);
     free(pb_el);
 }
 
+void purge_packets(struct timeval* timestamp, void* src_object, void* object) {
+    dessert_debug("purging packet buffer");
+    pb_el_t* pb_el = object;
+    pbt.stats.dropped_expired += pb_el->count;
+    pb_el_destroy(pb_el);
+}
+
 int pb_init() {
-    pbt.entries = NULL;
+    hashmap_init(&pbt.entries);
+    pbt.age_list = NULL;
+    memset(&pbt.stats, 0, sizeof(pbt.stats));
     struct timeval timeout;
     timeout.tv_sec = BLACKLIST_TIMEOUT / 1000;
     timeout.tv_usec = (BLACKLIST_TIMEOUT % 1000) * 1000;
-    return timeslot_create(&pbt.ts, &timeout, NULL, purge_packets);
-}
 
-void fl_push_packet(fifo_list_t* fl, dessert_msg_t* msg) {
-    fifo_list_el_t* new_el = malloc(sizeof(fifo_list_el_t));
-
-    if(new_el == NULL) {
-        return;
+    if(!timeslot_create(&pbt.ts, &timeout, NULL, purge_packets)) {
+        return false;
     }
 
-    dessert_msg_t* msg_copy;
-    dessert_msg_clone(&msg_copy, msg, false);
-    new_el->msg = msg_copy;
-    new_el->next = NULL;
+    // buffered destinations expire through aodv_db_cleanup only, pushing stays O(1)
+    timeslot_set_purge_on_add(pbt.ts, false);
+    return true;
+}
 
-    if(fl->head == NULL) {
-        fl->head = new_el;
-        fl->tail = new_el;
+/**
+ * Make room for size bytes in pb_el. Returns false if the packet has to be
+ * dropped instead; the reason is counted.
+ */
+static int pb_make_room(pb_el_t* pb_el, uint32_t size) {
+    uint32_t max_packets = min(pb_el->capacity, max(pb_dest_max_packets, 1));
+
+    // a packet that does not fit into an empty buffer must not evict others first
+    if(size > pb_dest_max_bytes) {
+        pbt.stats.dropped_dest_bytes++;
+        return false;
     }
-    else {
-        fl->tail->next = new_el;
-        fl->tail = new_el;
+
+    if((uint64_t) size + pb_el_overhead(pb_el) > pb_max_bytes) {
+        pbt.stats.dropped_budget++;
+        return false;
     }
 
-    fl->size++;
+    // per destination caps
+    while(pb_el->count >= max_packets || pb_el->bytes + size > pb_dest_max_bytes) {
+        uint64_t* counter = (pb_el->count >= max_packets) ? &pbt.stats.dropped_dest_packets : &pbt.stats.dropped_dest_bytes;
+
+        if(pb_policy == AODV_PB_DROP_TAIL || pb_el->count == 0) {
+            (*counter)++;
+            return false;
+        }
 
-    if(fl->size > FIFO_BUFFER_MAX_ENTRY_SIZE) {
-        dessert_debug("reached maximum number of packets in buffer for this destination host -> purge old packets");
-        dessert_msg_destroy(fl->head->msg);
-        fifo_list_el_t* curr_head = fl->head;
-        fl->head = fl->head->next;
-        free(curr_head);
-        fl->size--;
+        dessert_msg_destroy(pb_el_take(pb_el));
+        (*counter)++;
     }
-}
 
-dessert_msg_t* fl_pop_packet(fifo_list_t* fl) {
-    dessert_msg_t* msg;
-    fifo_list_el_t* head_el;
+    // global budget, which also pays for the records and rings of all destinations including pb_el
+    while(pbt.stats.bytes + pbt.stats.overhead + size > pb_max_bytes) {
+        if(pb_policy == AODV_PB_DROP_TAIL || pbt.stats.packets == 0) {
+            pbt.stats.dropped_budget++;
+            return false;
+        }
 
-    if(fl->head == NULL) {
-        return NULL;
-    }
+        // oldest destination first; skip destinations that only wait for this packet
+        pb_el_t* oldest = pbt.age_list;
 
-    head_el = fl->head;
-    msg = fl->head->msg;
+        while(oldest->count == 0) {
+            oldest = oldest->next;
+        }
 
-    if(fl->head == fl->tail) {
-        fl->head = fl->tail = NULL;
-    }
-    else {
-        fl->head = fl->head->next;
+        dessert_msg_destroy(pb_el_take(oldest));
+        pbt.stats.dropped_budget++;
+
+        if(oldest->count == 0 && oldest != pb_el) {
+            pb_el_destroy(oldest);
+        }
     }
 
-    free(head_el);
-    fl->size--;
-    return msg;
+    return true;
 }
 
 void pb_push_packet(mac_addr dhost_ether, dessert_msg_t* msg, struct timeval* timestamp) {
-    pb_cleanup(timestamp);
-    pb_el_t* pb_el;
-    HASH_FIND(hh, pbt.entries, dhost_ether, ETH_ALEN, pb_el);
+    uint32_t size = pb_msg_size(msg);
+    pb_el_t* pb_el = hashmap_find(&pbt.entries, hf_mac_addr_to_uint64(dhost_ether));
 
     if(pb_el == NULL) {
-        pb_el = malloc(sizeof(pb_el_t));
+        pb_el = pb_el_create(dhost_ether);
 
         if(pb_el == NULL) {
-            dessert_msg_destroy(msg);
+            pbt.stats.dropped_nomem++;
             return;
         }
+    }
 
-        mac_copy(pb_el->dhost_ether, dhost_ether);
-        pb_el->fl.head = pb_el->fl.tail = NULL;
-        pb_el->fl.size = 0;
-        HASH_ADD_KEYPTR(hh, pbt.entries, pb_el->dhost_ether, ETH_ALEN, pb_el);
+    dessert_msg_t* msg_copy = NULL;
+
+    if(!pb_make_room(pb_el, size)) {
+        dessert_debug("packet buffer limit reached -> dropping packet to " MAC, EXPLODE_ARRAY6(dhost_ether));
+    }
+    // sparse: only hlen + plen are allocated, which is what the limits account for
+    else if(dessert_msg_clone(&msg_copy, msg, true) != DESSERT_OK) {
+        pbt.stats.dropped_nomem++;
+    }
+    else {
+        pb_el->ring[(pb_el->head + pb_el->count) % pb_el->capacity] = msg_copy;
+        pb_el->count++;
+        pb_el->bytes += size;
+        pbt.stats.packets++;
+        pbt.stats.bytes += size;
+        pbt.stats.pushed++;
     }
 
-    fl_push_packet(&pb_el->fl, msg);
-    timeslot_addobject(pbt.ts, timestamp, pb_el);
+    if(pb_el->count == 0) {
+        pb_el_destroy(pb_el);
+        return;
+    }
+
+    timeslot_addnode(pbt.ts, timestamp, &pb_el->ts_node);
 }
 
-dessert_msg_t* pb_pop_packet(mac_addr dhost_ether) {
-    pb_el_t* pb_el;
-    HASH_FIND(hh, pbt.entries, dhost_ether, ETH_ALEN, pb_el);
+int pb_pop_packets(mac_addr dhost_ether, aodv_pb_batch_t* batch_out) {
+    pb_el_t* pb_el = hashmap_find(&pbt.entries, hf_mac_addr_to_uint64(dhost_ether));
 
     if(pb_el == NULL) {
-        return NULL;
+        return false;
     }
 
-    dessert_msg_t* msg = fl_pop_packet(&pb_el->fl);
-
-    if(pb_el->fl.head == NULL) {
-        HASH_DEL(pbt.entries, pb_el);
-        timeslot_deleteobject(pbt.ts, pb_el);
-        free(pb_el);
-    }
+    // hand the whole ring to the caller, the packets are sent without the lock
+    batch_out->msgs = pb_el->ring;
+    batch_out->capacity = pb_el->capacity;
+    batch_out->head = pb_el->head;
+    batch_out->count = pb_el->count;
+
+    pbt.stats.packets -= pb_el->count;
+    pbt.stats.bytes -= pb_el->bytes;
+    pbt.stats.popped += pb_el->count;
+    pb_el->count = 0;
+    pb_el->ring = NULL;
+    pb_el_destroy(pb_el);
+    return true;
+}
 
-    return msg;
+void pb_stats(aodv_pb_stats_t* stats_out) {
+    *stats_out = pbt.stats;
 }
 
 void pb_report(char** str_out) {
@@ -186,3 +279,6 @@ int pb_cleanup(struct timeval* timestamp) {
     return timeslot_purgeobjects(pbt.ts, timestamp);
 }
 
+int pb_next_expiry(struct timeval* next_out) {
+    return timeslot_next_expiry(pbt.ts, next_out);
+}
@@ -25,6 +25,7 @@ For further information and questions please use the web site
 #define PACKET_BUFFER
 
 #include <dessert.h>
+#include "../../config.h"
 
 #ifdef ANDROID
 #include <linux/if_ether.h>
@@ -35,12 +36,17 @@ int pb_init();
 
 void pb_push_packet(mac_addr dhost_ether, dessert_msg_t* msg, struct timeval* timestamp);
 
-dessert_msg_t* pb_pop_packet(mac_addr dhost_ether);
+/** detach all packets buffered for dhost_ether; false if there are none */
+int pb_pop_packets(mac_addr dhost_ether, aodv_pb_batch_t* batch_out);
+
+void pb_stats(aodv_pb_stats_t* stats_out);
 
 void pb_drop_packets(mac_addr dhost_ether);
 
 int pb_cleanup(struct timeval* timestamp);
 
+int pb_next_expiry(struct timeval* next_out);
+
 void pb_report(char** str_out);
 
 #endif
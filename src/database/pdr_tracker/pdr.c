@@ -24,6 +24,8 @@ For further information and questions please use the web site
 #include "pdr.h"
 #include "../../config.h"
 
+pdr_neighbor_table_t pdr_nt;
+
 pdr_neighbor_entry_t* pdr_neighbor_entry_create(mac_addr ether_neighbor_addr, uint16_t hello_interv) {
     pdr_neighbor_entry_t* new_entry;
     new_entry = malloc(sizeof(pdr_neighbor_entry_t));
@@ -36,7 +38,8 @@ pdr_neighbor_entry_t* pdr_neighbor_entry_create(mac_addr ether_neighbor_addr, ui
     new_entry->rcvd_hello_count = 0;
     new_entry->nb_rcvd_hello_count = 0;
     new_entry->hello_interv = hello_interv;
-    new_entry->msg_list = NULL;
+    hashmap_init(&new_entry->msg_list);
+    timeslot_node_init(&new_entry->ts_node, new_entry);
 
     if(hello_interv*tracking_factor >= PDR_MIN_TRACKING_INTERVAL) {
         new_entry->expected_hellos = tracking_factor;
@@ -80,7 +83,7 @@ void pdr_neighbor_entry_update(pdr_neighbor_entry_t* update_entry, uint16_t new_
 void pdr_nt_purge_hello_msg(struct timeval* timestamp, void* src_object, void* object) {
     pdr_neighbor_entry_t* curr_entry = src_object;
     pdr_neighbor_hello_msg_t* curr_hello = object;
-    HASH_DEL(curr_entry->msg_list, curr_hello);
+    hashmap_del(&curr_entry->msg_list, curr_hello->seq_num);
 
     curr_entry->rcvd_hello_count -= 1;
     free(curr_hello);
@@ -92,12 +95,12 @@ void pdr_nt_purge_nb(struct timeval* timestamp, void* src_object, void* del_obje
     dessert_info("Delete entry in pdr tracker for " MAC " due to no hello communication", EXPLODE_ARRAY6(nb_entry->ether_neighbor));
     pdr_nt_msg_destroy(nb_entry);
     timeslot_destroy(nb_entry->ts);
-    HASH_DEL(pdr_nt.entries, nb_entry);
+    hashmap_del(&pdr_nt.entries, hf_mac_addr_to_uint64(nb_entry->ether_neighbor));
     free(nb_entry);
 }
 
 int aodv_db_pdr_nt_init() {
-    pdr_nt.entries = NULL;
+    hashmap_init(&pdr_nt.entries);
 
     if(hello_interval*tracking_factor >= PDR_MIN_TRACKING_INTERVAL) {
         pdr_nt.nb_expected_hellos = tracking_factor;
@@ -129,24 +132,28 @@ int pdr_nt_neighbor_destroy(uint32_t* count_out) {
     *count_out = 0;
 
     pdr_neighbor_entry_t* neigh = NULL;
-    pdr_neighbor_entry_t* tmp = NULL;
-    HASH_ITER(hh, pdr_nt.entries, neigh, tmp) {
+    uint32_t pos = 0;
+
+    while(hashmap_next(&pdr_nt.entries, &pos, NULL, (void**) &neigh)) {
         pdr_nt_msg_destroy(neigh);
         timeslot_destroy(neigh->ts);
-        HASH_DEL(pdr_nt.entries, neigh);
         free(neigh);
         (*count_out)++;
     }
+
+    hashmap_destroy(&pdr_nt.entries);
     return true;
 }
 
 int pdr_nt_msg_destroy(pdr_neighbor_entry_t* curr_nb) {
     pdr_neighbor_hello_msg_t* nb_msg = NULL;
-    pdr_neighbor_hello_msg_t* tmp = NULL;
-    HASH_ITER(hh, curr_nb->msg_list, nb_msg, tmp) {
-        HASH_DEL(curr_nb->msg_list, nb_msg);
+    uint32_t pos = 0;
+
+    while(hashmap_next(&curr_nb->msg_list, &pos, NULL, (void**) &nb_msg)) {
         free(nb_msg);
     }
+
+    hashmap_destroy(&curr_nb->msg_list);
     return true;
 }
 
@@ -155,6 +162,7 @@ int aodv_db_pdr_nt_neighbor_reset(uint32_t* count_out) {
     int result = true;
     
     result &= pdr_nt_neighbor_destroy(count_out);
+    result &= timeslot_destroy(pdr_nt.ts);
     result &= aodv_db_pdr_nt_init();
 
     return result;
@@ -164,12 +172,15 @@ int aodv_db_pdr_nt_cleanup(struct timeval* timestamp) {
     return timeslot_purgeobjects(pdr_nt.ts, timestamp);
 }
 
+int aodv_db_pdr_nt_next_expiry(struct timeval* next_out) {
+    return timeslot_next_expiry(pdr_nt.ts, next_out);
+}
+
 int aodv_db_pdr_nt_cap_hello(mac_addr ether_neighbor_addr, uint16_t hello_seq, uint16_t hello_interv, struct timeval* timestamp) {
     struct timeval teststamp;
     teststamp.tv_sec = timestamp->tv_sec;
     teststamp.tv_usec = timestamp->tv_usec;
-    pdr_neighbor_entry_t* curr_entry = NULL;
-    HASH_FIND(hh, pdr_nt.entries, ether_neighbor_addr, ETH_ALEN, curr_entry);
+    pdr_neighbor_entry_t* curr_entry = hashmap_find(&pdr_nt.entries, hf_mac_addr_to_uint64(ether_neighbor_addr));
 
     if(curr_entry == NULL) {
         //start new pdr tracker
@@ -193,7 +204,12 @@ int aodv_db_pdr_nt_cap_hello(mac_addr ether_neighbor_addr, uint16_t hello_seq, u
             return false;
         }
 
-        HASH_ADD_KEYPTR(hh, pdr_nt.entries, curr_entry->ether_neighbor, ETH_ALEN, curr_entry);
+        if(!hashmap_add(&pdr_nt.entries, hf_mac_addr_to_uint64(curr_entry->ether_neighbor), curr_entry)) {
+            timeslot_destroy(curr_entry->ts);
+            free(curr_entry);
+            return false;
+        }
+
         dessert_info("New neighbor entry with %" PRIu16 " expected hellos in pdr tracker created for " MAC, curr_entry->expected_hellos, EXPLODE_ARRAY6(ether_neighbor_addr));
     }
     else if (curr_entry->hello_interv != hello_interv) {
@@ -201,10 +217,9 @@ int aodv_db_pdr_nt_cap_hello(mac_addr ether_neighbor_addr, uint16_t hello_seq, u
         pdr_neighbor_entry_update(curr_entry, hello_interv);
     }
 
-    timeslot_addobject_varpurge(pdr_nt.ts, timestamp, curr_entry, &(curr_entry->purge_tv));
+    timeslot_addnode_varpurge(pdr_nt.ts, timestamp, &curr_entry->ts_node, &(curr_entry->purge_tv));
 
-    pdr_neighbor_hello_msg_t* curr_hello = NULL;
-    HASH_FIND(hh, curr_entry->msg_list, &hello_seq, 2, curr_hello);
+    pdr_neighbor_hello_msg_t* curr_hello = hashmap_find(&curr_entry->msg_list, hello_seq);
     if(curr_hello == NULL) {
         //this hello seq number is unknown, create new entry
         curr_hello = pdr_hello_entry_create(hello_seq);
@@ -213,7 +228,10 @@ int aodv_db_pdr_nt_cap_hello(mac_addr ether_neighbor_addr, uint16_t hello_seq, u
             return false;
         }
 
-        HASH_ADD_KEYPTR(hh, curr_entry->msg_list, &(curr_hello->seq_num), 2, curr_hello);
+        if(!hashmap_add(&curr_entry->msg_list, curr_hello->seq_num, curr_hello)) {
+            free(curr_hello);
+            return false;
+        }
     }
 
     curr_entry->rcvd_hello_count += 1;
@@ -223,8 +241,7 @@ int aodv_db_pdr_nt_cap_hello(mac_addr ether_neighbor_addr, uint16_t hello_seq, u
 }
 
 int aodv_db_pdr_nt_cap_hellorsp(mac_addr ether_neighbor_addr, uint16_t hello_interv, uint8_t hello_count, struct timeval* timestamp) {
-    pdr_neighbor_entry_t* curr_entry = NULL;
-    HASH_FIND(hh, pdr_nt.entries, ether_neighbor_addr, ETH_ALEN, curr_entry);
+    pdr_neighbor_entry_t* curr_entry = hashmap_find(&pdr_nt.entries, hf_mac_addr_to_uint64(ether_neighbor_addr));
 
     if(curr_entry == NULL) {
         //start new pdr tracker for neighbor
@@ -248,7 +265,12 @@ int aodv_db_pdr_nt_cap_hellorsp(mac_addr ether_neighbor_addr, uint16_t hello_int
             return false;
         }
 
-        HASH_ADD_KEYPTR(hh, pdr_nt.entries, curr_entry->ether_neighbor, ETH_ALEN, curr_entry);
+        if(!hashmap_add(&pdr_nt.entries, hf_mac_addr_to_uint64(curr_entry->ether_neighbor), curr_entry)) {
+            timeslot_destroy(curr_entry->ts);
+            free(curr_entry);
+            return false;
+        }
+
         dessert_info("New neighbor entry with %" PRIu16 " expected hellos in pdr tracker created for " MAC, curr_entry->expected_hellos, EXPLODE_ARRAY6(ether_neighbor_addr));
     }
     else if (curr_entry->hello_interv != hello_interv) {
@@ -256,7 +278,7 @@ int aodv_db_pdr_nt_cap_hellorsp(mac_addr ether_neighbor_addr, uint16_t hello_int
         pdr_neighbor_entry_update(curr_entry, hello_interv);
     }
 
-    timeslot_addobject_varpurge(pdr_nt.ts, timestamp, curr_entry, &(curr_entry->purge_tv));
+    timeslot_addnode_varpurge(pdr_nt.ts, timestamp, &curr_entry->ts_node, &(curr_entry->purge_tv));
 
     curr_entry->nb_rcvd_hello_count = hello_count;
 
@@ -269,8 +291,7 @@ int pdr_nt_cleanup(pdr_neighbor_entry_t* given_entry, struct timeval* timestamp)
 }
 
 int aodv_db_pdr_nt_get_pdr(mac_addr ether_neighbor_addr, metric_t* pdr_out, struct timeval* timestamp) {
-    pdr_neighbor_entry_t* curr_entry = NULL;
-    HASH_FIND(hh, pdr_nt.entries, ether_neighbor_addr, ETH_ALEN, curr_entry);
+    pdr_neighbor_entry_t* curr_entry = hashmap_find(&pdr_nt.entries, hf_mac_addr_to_uint64(ether_neighbor_addr));
 
     if(curr_entry == NULL){
         return false;
@@ -289,8 +310,7 @@ int aodv_db_pdr_nt_get_pdr(mac_addr ether_neighbor_addr, metric_t* pdr_out, stru
 }
 
 int aodv_db_pdr_nt_get_etx_mul(mac_addr ether_neighbor_addr, metric_t* etx_out, struct timeval* timestamp) {
-    pdr_neighbor_entry_t* curr_entry = NULL;
-    HASH_FIND(hh, pdr_nt.entries, ether_neighbor_addr, ETH_ALEN, curr_entry);
+    pdr_neighbor_entry_t* curr_entry = hashmap_find(&pdr_nt.entries, hf_mac_addr_to_uint64(ether_neighbor_addr));
 
     if(curr_entry == NULL){
         return false;
@@ -311,8 +331,7 @@ int aodv_db_pdr_nt_get_etx_mul(mac_addr ether_neighbor_addr, metric_t* etx_out,
 }
 
 int aodv_db_pdr_nt_get_etx_add(mac_addr ether_neighbor_addr, metric_t* etx_out, struct timeval* timestamp) {
-    pdr_neighbor_entry_t* curr_entry = NULL;
-    HASH_FIND(hh, pdr_nt.entries, ether_neighbor_addr, ETH_ALEN, curr_entry);
+    pdr_neighbor_entry_t* curr_entry = hashmap_find(&pdr_nt.entries, hf_mac_addr_to_uint64(ether_neighbor_addr));
 
     if(curr_entry == NULL){
         return false;
@@ -337,8 +356,7 @@ int aodv_db_pdr_nt_get_etx_add(mac_addr ether_neighbor_addr, metric_t* etx_out,
 }
 
 int aodv_db_pdr_nt_get_rcvdhellocount(mac_addr ether_neighbor_addr, uint8_t* count_out, struct timeval* timestamp) {
-    pdr_neighbor_entry_t* curr_entry = NULL;
-    HASH_FIND(hh, pdr_nt.entries, ether_neighbor_addr, ETH_ALEN, curr_entry);
+    pdr_neighbor_entry_t* curr_entry = hashmap_find(&pdr_nt.entries, hf_mac_addr_to_uint64(ether_neighbor_addr));
 
     if(curr_entry == NULL){
         return false;
@@ -353,37 +371,27 @@ int aodv_db_pdr_nt_get_rcvdhellocount(mac_addr ether_neighbor_addr, uint8_t* cou
     return true;
 }
 
-int aodv_db_pdr_nt_report(char** str_out) {
-    pdr_neighbor_entry_t* current_entry = pdr_nt.entries;
-    char* output;
-    char entry_str[REPORT_RT_STR_LEN  + 1];
+int aodv_db_pdr_nt_snapshot(aodv_pdr_nt_snapshot_entry_t** entries_out, uint32_t* count_out) {
+    pdr_neighbor_entry_t* current_entry;
+    uint32_t pos = 0;
+    uint32_t count = 0;
 
-    uint32_t len = 0;
+    aodv_pdr_nt_snapshot_entry_t* entries = malloc((hashmap_count(&pdr_nt.entries) + 1) * sizeof(aodv_pdr_nt_snapshot_entry_t));
 
-    while(current_entry != NULL) {
-        len += REPORT_RT_STR_LEN * 2;
-        current_entry = current_entry->hh.next;
-    }
-
-    current_entry = pdr_nt.entries;
-    output = malloc(sizeof(char) * REPORT_RT_STR_LEN * (4 + len) + 1);
-
-    if(output == NULL) {
+    if(entries == NULL) {
         return false;
     }
 
-    output[0] = '\0';
-    strcat(output, "+-------------------+-------------------+-------------------+-------------------+----------------------+\n"
-           "|     neighbor      |  hello interval   |  received hellos  |  expected hellos  | neighbor rcvd hellos |\n"
-           "+-------------------+-------------------+-------------------+-------------------+----------------------+\n");
-
-    while(current_entry != NULL) {
-        snprintf(entry_str, REPORT_RT_STR_LEN, "| " MAC " |      %" PRIu16 " ms      |        %" PRIu8 "        |       %" PRIu16 "       |        %" PRIu8 "        |\n", EXPLODE_ARRAY6(current_entry->ether_neighbor), current_entry->hello_interv, current_entry->rcvd_hello_count, current_entry->expected_hellos, current_entry->nb_rcvd_hello_count);
-        strcat(output, entry_str);
-        strcat(output, "+-------------------+-------------------+-------------------+-------------------+----------------------+\n");
-        current_entry = current_entry->hh.next;
+    while(hashmap_next(&pdr_nt.entries, &pos, NULL, (void**) &current_entry)) {
+        aodv_pdr_nt_snapshot_entry_t* el = &entries[count++];
+        mac_copy(el->neighbor, current_entry->ether_neighbor);
+        el->hello_interval = current_entry->hello_interv;
+        el->rcvd_hellos = current_entry->rcvd_hello_count;
+        el->expected_hellos = current_entry->expected_hellos;
+        el->nb_rcvd_hellos = current_entry->nb_rcvd_hello_count;
     }
 
-    *str_out = output;
+    *entries_out = entries;
+    *count_out = count;
     return true;
 }
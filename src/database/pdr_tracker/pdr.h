@@ -26,8 +26,8 @@ For further information and questions please use the web site
 
 #include <dessert.h>
 #include <utlist.h>
-#include <uthash.h>
 #include "../timeslot.h"
+#include "../hashmap.h"
 #include "../../helper.h"
 
 #ifdef ANDROID
@@ -36,7 +36,6 @@ For further information and questions please use the web site
 
 typedef struct pdr_neighbor_hello_msg {
     uint16_t			seq_num; //KEY
-    UT_hash_handle		hh;
 } pdr_neighbor_hello_msg_t;
 
 typedef struct pdr_neighbor_entry {
@@ -46,18 +45,18 @@ typedef struct pdr_neighbor_entry {
     uint8_t						rcvd_hello_count;
     uint8_t						nb_rcvd_hello_count;
     timeslot_t*					ts;
-    pdr_neighbor_hello_msg_t* 	msg_list;
+    hashmap_t				 	msg_list; // seq_num -> pdr_neighbor_hello_msg_t
     struct timeval				purge_tv;
-    UT_hash_handle		hh;
+    timeslot_node_t				ts_node;
 } pdr_neighbor_entry_t;
 
 typedef struct pdr_neighbor_table {
-    pdr_neighbor_entry_t*   entries;
+    hashmap_t				entries;
     uint16_t				nb_expected_hellos;
     timeslot_t*				ts;
 } pdr_neighbor_table_t;
 
-pdr_neighbor_table_t pdr_nt;
+extern pdr_neighbor_table_t pdr_nt;
 
 /**Initialize PDR Tracker Structure*/
 int aodv_db_pdr_nt_init();
@@ -96,6 +95,9 @@ int pdr_nt_cleanup(pdr_neighbor_entry_t* given_entry, struct timeval* timestamp)
 /**Cleanup function used for periodic cleanup*/
 int aodv_db_pdr_nt_cleanup(struct timeval* timestamp);
 
+/**Earliest time at which the periodic cleanup has something to purge*/
+int aodv_db_pdr_nt_next_expiry(struct timeval* next_out);
+
 /**Returns the pdr for the link encoded as uint16_t*/
 int aodv_db_pdr_nt_get_pdr(mac_addr ether_neighbor_addr, uint16_t* pdr_out, struct timeval* timestamp);
 
@@ -109,6 +111,7 @@ int aodv_db_pdr_nt_get_etx_add(mac_addr ether_neighbor_addr, uint16_t* etx_out,
 int aodv_db_pdr_nt_get_rcvdhellocount(mac_addr ether_neighbor_addr, uint8_t* count_out, struct timeval* timestamp);
 
 /**Creates a visual representation of the pdr neighbor table*/
-int aodv_db_pdr_nt_report(char** str_out);
+/** copy all tracked neighbors into a new array, free it after use */
+int aodv_db_pdr_nt_snapshot(aodv_pdr_nt_snapshot_entry_t** entries_out, uint32_t* count_out);
 
 #endif
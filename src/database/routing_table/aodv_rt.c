@@ -24,102 +24,430 @@ For further information and questions please use the web site
 #include "aodv_rt.h"
 #include "../neighbor_table/nt.h"
 
-aodv_rt_t				rt;
-nht_entry_t*				nht = NULL;
+aodv_rt_t				rt[RT_SHARD_COUNT];
 
-void purge_rt_entry(struct timeval* timestamp, void* src_object, void* del_object) {
-    aodv_rt_entry_t* rt_entry = del_object;
+/** bumped whenever the forwarding state of any route changes; 0 is never a valid generation */
+uint64_t				rt_generation = 1;
 
-    // delete precursor list from routing entry
-    while(rt_entry->precursor_list) {
-        aodv_rt_precursor_list_entry_t* precursor = rt_entry->precursor_list;
-        HASH_DEL(rt_entry->precursor_list, precursor);
-        free(precursor);
+static inline uint32_t rt_fib_index(aodv_rt_fib_t* fib, uint64_t key) {
+    // aodv_db_rt_shard uses bits 32-63 of the same product, so take the upper ones
+    return (uint32_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 40) & fib->mask;
+}
+
+/** find the forwarding slot of key; if create is set, claim a free slot if there is none */
+static aodv_rt_fib_slot_t* rt_fib_find(aodv_rt_fib_t* fib, uint64_t key, int create) {
+    aodv_rt_fib_slot_t* free_slot = NULL;
+    uint32_t idx = rt_fib_index(fib, key);
+    uint32_t i;
+
+    for(i = 0; i < RT_FIB_PROBES; ++i) {
+        aodv_rt_fib_slot_t* slot = &fib->slots[(idx + i) & fib->mask];
+
+        if(slot->key == key) {
+            return slot;
+        }
+
+        if(slot->key == RT_FIB_EMPTY && free_slot == NULL) {
+            free_slot = slot;
+        }
     }
 
-    if(!(rt_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN)) {
-        // delete mapping from next hop to this entry
-        nht_entry_t* nht_entry;
-        nht_destlist_entry_t* dest_entry;
-        HASH_FIND(hh, nht, rt_entry->next_hop, ETH_ALEN, nht_entry);
+    // no free slot in reach: the shard has to grow its slots
+    return create ? free_slot : NULL;
+}
 
-        if(nht_entry != NULL) {
-            HASH_FIND(hh, nht_entry->dest_list, rt_entry->addr, ETH_ALEN, dest_entry);
+static aodv_rt_fib_t* rt_fib_create(uint32_t slots) {
+    aodv_rt_fib_t* fib = calloc(1, sizeof(aodv_rt_fib_t) + slots * sizeof(aodv_rt_fib_slot_t));
+
+    if(fib == NULL) {
+        dessert_warn("calloc returned NULL");
+        return NULL;
+    }
+
+    uint32_t i;
+    for(i = 0; i < slots; ++i) {
+        fib->slots[i].key = RT_FIB_EMPTY;
+    }
+
+    fib->mask = slots - 1;
+    return fib;
+}
 
-            if(dest_entry != NULL) {
-                HASH_DEL(nht_entry->dest_list, dest_entry);
-                free(dest_entry);
+static void rt_fib_write(aodv_rt_fib_slot_t* slot, uint64_t key, aodv_rt_fwd_t* fwd) {
+    uint32_t seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if(slot->key != key) {
+        __atomic_store_n(&slot->last_used, 0, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&slot->key, key, __ATOMIC_RELAXED);
+
+    if(fwd != NULL) {
+        __atomic_store_n(&slot->flags, fwd->flags, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->next_hop, hf_mac_addr_to_uint64(fwd->next_hop), __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->output_iface, fwd->output_iface, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/** double the forwarding slots of shard; the shard must be write locked */
+static int rt_fib_grow(aodv_rt_t* shard) {
+    aodv_rt_fib_t* old_fib = shard->fib;
+    uint32_t slots = (old_fib->mask + 1) * 2;
+    aodv_rt_fib_t* fib;
+    uint32_t i;
+
+    // the larger array is private until it is published, so its slots are written directly
+    while(true) {
+        if(slots > (1 << 24)) {
+            return false; // rt_fib_index has no more bits
+        }
+
+        fib = rt_fib_create(slots);
+
+        if(fib == NULL) {
+            return false;
+        }
+
+        for(i = 0; i <= old_fib->mask; ++i) {
+            aodv_rt_fib_slot_t* old_slot = &old_fib->slots[i];
+
+            if(old_slot->key == RT_FIB_EMPTY) {
+                continue;
             }
 
-            if(nht_entry->dest_list == NULL) {
-                HASH_DEL(nht, nht_entry);
-                free(nht_entry);
+            aodv_rt_fib_slot_t* slot = rt_fib_find(fib, old_slot->key, true);
+
+            if(slot == NULL) {
+                break;
             }
+
+            slot->key = old_slot->key;
+            slot->flags = old_slot->flags;
+            slot->next_hop = old_slot->next_hop;
+            slot->output_iface = old_slot->output_iface;
+            slot->last_used = __atomic_load_n(&old_slot->last_used, __ATOMIC_RELAXED);
+            fib->count++;
         }
+
+        if(i > old_fib->mask) {
+            break;
+        }
+
+        free(fib);
+        slots *= 2;
+    }
+
+    fib->retired = old_fib;
+    __atomic_store_n(&shard->fib, fib, __ATOMIC_RELEASE);
+
+    // readers still on the old array fall back to the lock from now on, keep the uses they recorded
+    for(i = 0; i <= old_fib->mask; ++i) {
+        aodv_rt_fib_slot_t* old_slot = &old_fib->slots[i];
+
+        if(old_slot->key == RT_FIB_EMPTY) {
+            continue;
+        }
+
+        aodv_rt_fib_slot_t* slot = rt_fib_find(fib, old_slot->key, false);
+        uint64_t last_used = __atomic_load_n(&old_slot->last_used, __ATOMIC_RELAXED);
+        rt_fib_write(old_slot, RT_FIB_EMPTY, NULL);
+
+        if(__atomic_load_n(&slot->last_used, __ATOMIC_RELAXED) < last_used) {
+            __atomic_store_n(&slot->last_used, last_used, __ATOMIC_RELAXED);
+        }
+    }
+
+    dessert_debug("routing table shard grew to %" PRIu32 " forwarding slots", slots);
+    return true;
+}
+
+uint64_t aodv_db_rt_generation() {
+    return __atomic_load_n(&rt_generation, __ATOMIC_ACQUIRE);
+}
+
+/** publish the forwarding state of rt_entry to the lock-free readers; the shard must be write locked */
+static void rt_fib_sync(aodv_rt_t* shard, aodv_rt_entry_t* rt_entry) {
+    aodv_rt_fwd_t* fwd = &shard->fwd[rt_entry->fwd];
+    uint64_t key = hf_mac_addr_to_uint64(rt_entry->addr);
+    int routable = !(fwd->flags & (AODV_FLAGS_NEXT_HOP_UNKNOWN | AODV_FLAGS_ROUTE_INVALID));
+
+    // every change of a route goes through here, so this invalidates all per-thread caches
+    __atomic_add_fetch(&rt_generation, 1, __ATOMIC_RELEASE);
+
+    if(routable) {
+        aodv_rt_fib_slot_t* slot = rt_fib_find(shard->fib, key, true);
+
+        // keep the slots at most half full so the probes mostly hit the first slot
+        if(slot == NULL || (slot->key != key && (shard->fib->count + 1) * 2 > shard->fib->mask + 1)) {
+            if(rt_fib_grow(shard)) {
+                slot = rt_fib_find(shard->fib, key, true);
+            }
+        }
+
+        if(slot == NULL) {
+            return; // out of memory: the route is served by the locked lookup only
+        }
+
+        if(slot->key != key) {
+            shard->fib->count++;
+        }
+
+        rt_fib_write(slot, key, fwd);
+        return;
+    }
+
+    aodv_rt_fib_slot_t* slot = rt_fib_find(shard->fib, key, false);
+
+    if(slot == NULL) {
+        return;
+    }
+
+    // keep the usage recorded by the readers for the expiry of the entry
+    uint64_t last_used = __atomic_load_n(&slot->last_used, __ATOMIC_RELAXED);
+    fwd->last_used = max(fwd->last_used, last_used);
+    rt_fib_write(slot, RT_FIB_EMPTY, NULL);
+    shard->fib->count--;
+}
+
+/** last time rt_entry was used by a lock-free reader, 0 if never */
+static uint64_t rt_fib_last_used(aodv_rt_t* shard, aodv_rt_entry_t* rt_entry) {
+    aodv_rt_fib_slot_t* slot = rt_fib_find(shard->fib, hf_mac_addr_to_uint64(rt_entry->addr), false);
+    uint64_t last_used = __atomic_load_n(&shard->fwd[rt_entry->fwd].last_used, __ATOMIC_RELAXED);
+
+    if(slot != NULL) {
+        last_used = max(last_used, __atomic_load_n(&slot->last_used, __ATOMIC_RELAXED));
+    }
+
+    return last_used;
+}
+
+/** index + 1 of destination_host in the arrays of shard, 0 if it is unknown */
+static inline uint32_t rt_index(aodv_rt_t* shard, mac_addr destination_host) {
+    return (uint32_t)(uintptr_t) hashmap_find(&shard->entries, hf_mac_addr_to_uint64(destination_host));
+}
+
+static inline aodv_rt_entry_t* rt_find(aodv_rt_t* shard, mac_addr destination_host) {
+    uint32_t idx = rt_index(shard, destination_host);
+    return idx ? shard->ctl[idx - 1] : NULL;
+}
+
+static inline aodv_rt_fwd_t* rt_fwd(aodv_rt_t* shard, aodv_rt_entry_t* rt_entry) {
+    return &shard->fwd[rt_entry->fwd];
+}
+
+/** remove rt_entry from the arrays of shard, the last entry fills the gap */
+static void rt_unlink(aodv_rt_t* shard, aodv_rt_entry_t* rt_entry) {
+    uint32_t idx = rt_entry->fwd;
+    uint32_t last = --shard->size;
+
+    hashmap_del(&shard->entries, hf_mac_addr_to_uint64(rt_entry->addr));
+
+    if(idx == last) {
+        return;
     }
 
+    aodv_rt_entry_t* moved = shard->ctl[last];
+    shard->fwd[idx] = shard->fwd[last];
+    shard->ctl[idx] = moved;
+    moved->fwd = idx;
+    hashmap_add(&shard->entries, hf_mac_addr_to_uint64(moved->addr), (void*)(uintptr_t)(idx + 1)); // replaces, never allocates
+}
+
+/** delete the mapping from the next hop of rt_entry to rt_entry */
+static void rt_nht_remove(aodv_rt_t* shard, aodv_rt_entry_t* rt_entry) {
+    nht_entry_t* nht_entry = rt_entry->nht;
+
+    if(nht_entry == NULL) {
+        return;
+    }
+
+    if(rt_entry->nht_prev) {
+        rt_entry->nht_prev->nht_next = rt_entry->nht_next;
+    }
+    else {
+        nht_entry->dest_list = rt_entry->nht_next;
+    }
+
+    if(rt_entry->nht_next) {
+        rt_entry->nht_next->nht_prev = rt_entry->nht_prev;
+    }
+
+    rt_entry->nht = NULL;
+    rt_entry->nht_prev = NULL;
+    rt_entry->nht_next = NULL;
+
+    if(--nht_entry->dest_count == 0) {
+        hashmap_del(&shard->nht, hf_mac_addr_to_uint64(nht_entry->destination_host_next_hop));
+        free(nht_entry);
+    }
+}
+
+/** add the mapping from nht_entry to rt_entry; rt_entry must not be listed elsewhere */
+static void rt_nht_add(nht_entry_t* nht_entry, aodv_rt_entry_t* rt_entry) {
+    rt_entry->nht = nht_entry;
+    rt_entry->nht_prev = NULL;
+    rt_entry->nht_next = nht_entry->dest_list;
+
+    if(nht_entry->dest_list) {
+        nht_entry->dest_list->nht_prev = rt_entry;
+    }
+
+    nht_entry->dest_list = rt_entry;
+    nht_entry->dest_count++;
+}
+
+void purge_rt_entry(struct timeval* timestamp, void* src_object, void* del_object) {
+    aodv_rt_t* shard = src_object;
+    aodv_rt_entry_t* rt_entry = del_object;
+
+    // lookups served without lock do not refresh the lifetime, so check for them lazily
+    uint64_t last_used = rt_fib_last_used(shard, rt_entry);
+
+    if(last_used + MY_ROUTE_TIMEOUT > hf_tv_to_ms(timestamp)) {
+        struct timeval used;
+        used.tv_sec = last_used / 1000;
+        used.tv_usec = (last_used % 1000) * 1000;
+        timeslot_addnode(shard->ts, &used, &rt_entry->ts_node);
+        return;
+    }
+
+    rt_fwd(shard, rt_entry)->flags |= AODV_FLAGS_ROUTE_INVALID;
+    rt_fib_sync(shard, rt_entry);
+
+    // delete precursor list from routing entry
+    aodv_rt_precursor_list_entry_t* precursor;
+    uint32_t pos = 0;
+
+    while(hashmap_next(&rt_entry->precursor_list, &pos, NULL, (void**) &precursor)) {
+        free(precursor);
+    }
+
+    hashmap_destroy(&rt_entry->precursor_list);
+
+    // delete mapping from next hop to this entry
+    rt_nht_remove(shard, rt_entry);
+
     // delete routing entry
     dessert_debug("delete route to " MAC, EXPLODE_ARRAY6(rt_entry->addr));
-    HASH_DEL(rt.entries, rt_entry);
+    rt_unlink(shard, rt_entry);
     free(rt_entry);
 }
 
 int aodv_db_rt_init() {
-    rt.entries = NULL;
-
     struct timeval	mrt; // my route timeout
     mrt.tv_sec = MY_ROUTE_TIMEOUT / 1000;
     mrt.tv_usec = (MY_ROUTE_TIMEOUT % 1000) * 1000;
-    return timeslot_create(&rt.ts, &mrt, &rt, purge_rt_entry);
+
+    uint32_t i;
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        hashmap_init(&rt[i].entries);
+        hashmap_init(&rt[i].nht);
+        rt[i].fwd = NULL;
+        rt[i].ctl = NULL;
+        rt[i].size = 0;
+        rt[i].capacity = 0;
+
+        rt[i].fib = rt_fib_create(RT_FIB_SLOTS);
+
+        if(rt[i].fib == NULL) {
+            return false;
+        }
+
+        if(!timeslot_create(&rt[i].ts, &mrt, &rt[i], purge_rt_entry)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** make room for one more destination in the arrays of shard */
+static int rt_reserve(aodv_rt_t* shard) {
+    if(shard->size < shard->capacity) {
+        return true;
+    }
+
+    uint32_t capacity = shard->capacity ? 2 * shard->capacity : 64;
+    aodv_rt_fwd_t* fwd = realloc(shard->fwd, capacity * sizeof(aodv_rt_fwd_t));
+
+    if(fwd == NULL) {
+        return false;
+    }
+
+    shard->fwd = fwd;
+    aodv_rt_entry_t** ctl = realloc(shard->ctl, capacity * sizeof(aodv_rt_entry_t*));
+
+    if(ctl == NULL) {
+        return false;
+    }
+
+    shard->ctl = ctl;
+    shard->capacity = capacity;
+    return true;
 }
 
+/** create a routing entry and add it to its shard */
 int rt_entry_create(aodv_rt_entry_t** rreqt_entry_out, mac_addr destination_host, struct timeval* timestamp) {
 
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(destination_host)];
+
+    if(!rt_reserve(shard)) {
+        return false;
+    }
+
     aodv_rt_entry_t* rt_entry = malloc(sizeof(aodv_rt_entry_t));
 
     if(rt_entry == NULL) {
         return false;
     }
 
+    uint32_t idx = shard->size;
+
+    if(!hashmap_add(&shard->entries, hf_mac_addr_to_uint64(destination_host), (void*)(uintptr_t)(idx + 1))) {
+        free(rt_entry);
+        return false;
+    }
+
+    aodv_rt_fwd_t* fwd = &shard->fwd[idx];
+    memset(fwd, 0x0, sizeof(aodv_rt_fwd_t));
+    fwd->flags = AODV_FLAGS_NEXT_HOP_UNKNOWN | AODV_FLAGS_ROUTE_INVALID;
+
     memset(rt_entry, 0x0, sizeof(aodv_rt_entry_t));
     mac_copy(rt_entry->addr, destination_host);
-    rt_entry->flags = AODV_FLAGS_NEXT_HOP_UNKNOWN | AODV_FLAGS_ROUTE_INVALID;
-    rt_entry->precursor_list = NULL;
+    rt_entry->fwd = idx;
+    hashmap_init(&rt_entry->precursor_list);
     rt_entry->sequence_number = 0; //we know nothing about the destination
     rt_entry->metric = AODV_MAX_METRIC; //initial
     rt_entry->hop_count = UINT8_MAX; //initial
 
-    timeslot_addobject(rt.ts, timestamp, rt_entry);
+    shard->ctl[idx] = rt_entry;
+    shard->size++;
+
+    timeslot_node_init(&rt_entry->ts_node, rt_entry);
+    timeslot_addnode(shard->ts, timestamp, &rt_entry->ts_node);
 
     *rreqt_entry_out = rt_entry;
     return true;
 }
 
-int nht_destlist_entry_create(nht_destlist_entry_t** entry_out, mac_addr destination_host, aodv_rt_entry_t* rt_entry) {
-    nht_destlist_entry_t* entry = malloc(sizeof(nht_destlist_entry_t));
+/** create a next hop entry and add it to the next hop table of shard */
+int nht_entry_create(aodv_rt_t* shard, nht_entry_t** entry_out, mac_addr destination_host_next_hop) {
+    nht_entry_t* entry = malloc(sizeof(nht_entry_t));
 
     if(entry == NULL) {
         return false;
     }
 
-    memset(entry, 0x0, sizeof(nht_destlist_entry_t));
-    mac_copy(entry->destination_host, destination_host);
-    entry->rt_entry = rt_entry;
-
-    *entry_out = entry;
-    return true;
-}
-
-int nht_entry_create(nht_entry_t** entry_out, mac_addr destination_host_next_hop) {
-    nht_entry_t* entry = malloc(sizeof(nht_entry_t));
-
-    if(entry == NULL) {
+    if(!hashmap_add(&shard->nht, hf_mac_addr_to_uint64(destination_host_next_hop), entry)) {
+        free(entry);
         return false;
     }
 
     memset(entry, 0x0, sizeof(nht_entry_t));
     mac_copy(entry->destination_host_next_hop, destination_host_next_hop);
-    entry->dest_list = NULL;
 
     *entry_out = entry;
     return true;
@@ -139,31 +467,29 @@ int aodv_db_rt_capt_rreq(mac_addr destination_host,
                          struct timeval* timestamp,
                          aodv_capt_rreq_result_t* result_out) {
 
+    aodv_rt_t* dest_shard = &rt[aodv_db_rt_shard(destination_host)];
+    aodv_rt_t* orig_shard = &rt[aodv_db_rt_shard(originator_host)];
     aodv_rt_entry_t* dest_entry;
     aodv_rt_entry_t* orig_entry;
 
     // find rt_entry with dhost_ether address
-    HASH_FIND(hh, rt.entries, destination_host, ETH_ALEN, dest_entry);
+    dest_entry = rt_find(dest_shard, destination_host);
 
     if(!dest_entry) {
         // if not found -> create routing entry
         if(!rt_entry_create(&dest_entry, destination_host, timestamp)) {
             return false;
         }
-
-        HASH_ADD_KEYPTR(hh, rt.entries, dest_entry->addr, ETH_ALEN, dest_entry);
     }
 
     // find rt_entry with shost_ether address
-    HASH_FIND(hh, rt.entries, originator_host, ETH_ALEN, orig_entry);
+    orig_entry = rt_find(orig_shard, originator_host);
 
     if(!orig_entry) {
         // if not found -> create routing entry
         if(!rt_entry_create(&orig_entry, originator_host, timestamp)) {
             return false;
         }
-
-        HASH_ADD_KEYPTR(hh, rt.entries, orig_entry->addr, ETH_ALEN, orig_entry);
     }
 
     int seq_num_cmp = hf_comp_u32(orig_entry->sequence_number, originator_sequence_number);
@@ -180,12 +506,14 @@ int aodv_db_rt_capt_rreq(mac_addr destination_host,
             *result_out = AODV_CAPT_RREQ_NEW;
         }
 
-        mac_copy(orig_entry->next_hop, prev_hop);
-        orig_entry->output_iface = iface;
+        aodv_rt_fwd_t* orig_fwd = rt_fwd(orig_shard, orig_entry);
+        mac_copy(orig_fwd->next_hop, prev_hop);
+        orig_fwd->output_iface = iface;
         orig_entry->sequence_number = originator_sequence_number;
         orig_entry->metric = metric;
         orig_entry->hop_count = hop_count;
-        orig_entry->flags &= ~AODV_FLAGS_ROUTE_NEW;
+        orig_fwd->flags &= ~AODV_FLAGS_ROUTE_NEW;
+        rt_fib_sync(orig_shard, orig_entry);
     }
     else {
         *result_out = AODV_CAPT_RREQ_OLD;
@@ -204,123 +532,167 @@ int aodv_db_rt_capt_rrep(mac_addr destination_host,
                          uint8_t hop_count,
                          struct timeval* timestamp) {
 
-    aodv_rt_entry_t* rt_entry;
-    HASH_FIND(hh, rt.entries, destination_host, ETH_ALEN, rt_entry);
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(destination_host)];
+    aodv_rt_entry_t* rt_entry = rt_find(shard, destination_host);
 
     if(rt_entry == NULL) {
         // if not found -> create routing entry
         if(!rt_entry_create(&rt_entry, destination_host, timestamp)) {
             return false;
         }
-        HASH_ADD_KEYPTR(hh, rt.entries, rt_entry->addr, ETH_ALEN, rt_entry);
     }
 #ifndef ANDROID
     if(signal_strength_threshold > 0) {
         /* preemptive rreq is turned on */
         //this is a routing update, so reset the max rssi val of the next hop
-        db_nt_reset_rssi(destination_host_next_hop, output_iface, timestamp);
+        aodv_db_reset_rssi(destination_host_next_hop, output_iface, timestamp);
     }
 #endif
 
-    int next_hop_known = !(rt_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN);
+    aodv_rt_fwd_t* fwd = rt_fwd(shard, rt_entry);
+    int next_hop_known = !(fwd->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN);
     bool old = hf_comp_u32(rt_entry->sequence_number, destination_sequence_number) > 0;
 
     if(next_hop_known && old) {
         return false;
     }
 
-    nht_entry_t* nht_entry;
-    nht_destlist_entry_t* destlist_entry;
-
     // remove old next_hop_entry if found
-    if(next_hop_known) {
-        HASH_FIND(hh, nht, rt_entry->next_hop, ETH_ALEN, nht_entry);
-
-        if(nht_entry != NULL) {
-            HASH_FIND(hh, nht_entry->dest_list, rt_entry->addr, ETH_ALEN, destlist_entry);
-
-            if(destlist_entry != NULL) {
-                HASH_DEL(nht_entry->dest_list, destlist_entry);
-                free(destlist_entry);
-            }
-
-            if(nht_entry->dest_list == NULL) {
-                HASH_DEL(nht, nht_entry);
-                free(nht_entry);
-            }
-        }
-    }
+    rt_nht_remove(shard, rt_entry);
 
     // set next hop and etc. towards this destination
-    mac_copy(rt_entry->next_hop, destination_host_next_hop);
-    rt_entry->output_iface = output_iface;
+    mac_copy(fwd->next_hop, destination_host_next_hop);
+    fwd->output_iface = output_iface;
     rt_entry->sequence_number = destination_sequence_number;
     rt_entry->metric = metric;
     rt_entry->hop_count = hop_count;
-    rt_entry->flags &= ~AODV_FLAGS_NEXT_HOP_UNKNOWN;
-    rt_entry->flags &= ~AODV_FLAGS_ROUTE_INVALID;
-    rt_entry->flags &= ~AODV_FLAGS_ROUTE_WARN;
+    fwd->flags &= ~AODV_FLAGS_NEXT_HOP_UNKNOWN;
+    fwd->flags &= ~AODV_FLAGS_ROUTE_INVALID;
+    fwd->flags &= ~AODV_FLAGS_ROUTE_WARN;
 
     // insert this routing entry in the next hop destlist
-    HASH_FIND(hh, nht, destination_host_next_hop, ETH_ALEN, nht_entry);
+    nht_entry_t* nht_entry = hashmap_find(&shard->nht, hf_mac_addr_to_uint64(destination_host_next_hop));
 
     if(nht_entry == NULL) {
-        int success = nht_entry_create(&nht_entry, destination_host_next_hop);
+        int success = nht_entry_create(shard, &nht_entry, destination_host_next_hop);
         assert(success);
-        HASH_ADD_KEYPTR(hh, nht, nht_entry->destination_host_next_hop, ETH_ALEN, nht_entry);
     }
 
-    HASH_FIND(hh, nht_entry->dest_list, destination_host, ETH_ALEN, destlist_entry);
+    rt_nht_add(nht_entry, rt_entry);
 
-    if(destlist_entry == NULL) {
-        int success = nht_destlist_entry_create(&destlist_entry, destination_host, rt_entry);
-        assert(success);
-
-        HASH_ADD_KEYPTR(hh, nht_entry->dest_list, destlist_entry->destination_host, ETH_ALEN, destlist_entry);
-    }
-
-    destlist_entry->rt_entry = rt_entry;
+    rt_fib_sync(shard, rt_entry);
 
     return true;
 }
 
 int aodv_db_rt_getroute2dest(mac_addr destination_host, mac_addr destination_host_next_hop_out,
                              dessert_meshif_t** output_iface_out, struct timeval* timestamp, uint8_t flags) {
-    aodv_rt_entry_t* rt_entry;
-    HASH_FIND(hh, rt.entries, destination_host, ETH_ALEN, rt_entry);
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(destination_host)];
+    uint32_t idx = rt_index(shard, destination_host);
 
-    if(rt_entry == NULL || rt_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN || rt_entry->flags & AODV_FLAGS_ROUTE_INVALID) {
+    // only the forwarding state is touched, purge_rt_entry picks up last_used
+    aodv_rt_fwd_t* fwd = idx ? &shard->fwd[idx - 1] : NULL;
+    uint8_t fwd_flags = fwd ? __atomic_load_n(&fwd->flags, __ATOMIC_RELAXED) : 0;
+
+    if(fwd == NULL || fwd_flags & AODV_FLAGS_NEXT_HOP_UNKNOWN || fwd_flags & AODV_FLAGS_ROUTE_INVALID) {
         dessert_debug("route to " MAC " is invalid", EXPLODE_ARRAY6(destination_host));
         return false;
     }
 
-    rt_entry->flags |= flags;
+    // the shard is only read locked, so other lookups may add flags at the same time
+    if((fwd_flags & flags) != flags) {
+        __atomic_fetch_or(&fwd->flags, flags, __ATOMIC_RELAXED);
+
+        // flags are only ever added here, so the slot stays consistent without a seqlock write
+        aodv_rt_fib_slot_t* slot = rt_fib_find(shard->fib, hf_mac_addr_to_uint64(destination_host), false);
+
+        if(slot != NULL) {
+            __atomic_fetch_or(&slot->flags, flags, __ATOMIC_RELAXED);
+        }
+    }
+
+    mac_copy(destination_host_next_hop_out, fwd->next_hop);
+    *output_iface_out = fwd->output_iface;
+
+    uint64_t now = hf_tv_to_ms(timestamp);
+    uint64_t last_used = __atomic_load_n(&fwd->last_used, __ATOMIC_RELAXED);
+
+    while(last_used < now) {
+        if(__atomic_compare_exchange_n(&fwd->last_used, &last_used, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
 
-    mac_copy(destination_host_next_hop_out, rt_entry->next_hop);
-    *output_iface_out = rt_entry->output_iface;
-    timeslot_addobject(rt.ts, timestamp, rt_entry);
     return true;
 }
 
+int aodv_db_rt_fib_getroute2dest(mac_addr destination_host, mac_addr destination_host_next_hop_out,
+                                 dessert_meshif_t** output_iface_out, struct timeval* timestamp, uint8_t flags) {
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(destination_host)];
+    aodv_rt_fib_t* fib = __atomic_load_n(&shard->fib, __ATOMIC_ACQUIRE);
+    uint64_t key = hf_mac_addr_to_uint64(destination_host);
+    uint32_t idx = rt_fib_index(fib, key);
+    uint32_t i;
+
+    for(i = 0; i < RT_FIB_PROBES; ++i) {
+        aodv_rt_fib_slot_t* slot = &fib->slots[(idx + i) & fib->mask];
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if(seq & 1) {
+            return false; // slot is being written
+        }
+
+        if(__atomic_load_n(&slot->key, __ATOMIC_RELAXED) != key) {
+            continue;
+        }
+
+        uint8_t slot_flags = __atomic_load_n(&slot->flags, __ATOMIC_RELAXED);
+        uint64_t next_hop = __atomic_load_n(&slot->next_hop, __ATOMIC_RELAXED);
+        dessert_meshif_t* output_iface = __atomic_load_n(&slot->output_iface, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if(__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+            return false;
+        }
+
+        if((slot_flags & flags) != flags) {
+            return false; // flags are added by the locked lookup
+        }
+
+        // avoid dirtying the cache line more than once per millisecond
+        uint64_t now = hf_tv_to_ms(timestamp);
+
+        if(__atomic_load_n(&slot->last_used, __ATOMIC_RELAXED) < now) {
+            __atomic_store_n(&slot->last_used, now, __ATOMIC_RELAXED);
+        }
+
+        hf_uint64_to_mac_addr(next_hop, destination_host_next_hop_out);
+        *output_iface_out = output_iface;
+        return true;
+    }
+
+    return false;
+}
+
 int aodv_db_rt_getnexthop(mac_addr destination_host, mac_addr destination_host_next_hop_out) {
-    aodv_rt_entry_t* rt_entry;
-    HASH_FIND(hh, rt.entries, destination_host, ETH_ALEN, rt_entry);
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(destination_host)];
+    uint32_t idx = rt_index(shard, destination_host);
 
-    if(rt_entry == NULL || rt_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
+    if(idx == 0 || shard->fwd[idx - 1].flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
         return false;
     }
 
-    mac_copy(destination_host_next_hop_out, rt_entry->next_hop);
+    mac_copy(destination_host_next_hop_out, shard->fwd[idx - 1].next_hop);
     return true;
 }
 
 // returns true if dest is known
 //         false if des is unknown
 int aodv_db_rt_get_destination_sequence_number(mac_addr dhost_ether, uint32_t* destination_sequence_number_out) {
-    aodv_rt_entry_t* rt_entry;
-    HASH_FIND(hh, rt.entries, dhost_ether, ETH_ALEN, rt_entry);
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(dhost_ether)];
+    aodv_rt_entry_t* rt_entry = rt_find(shard, dhost_ether);
 
-    if(rt_entry == NULL || rt_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
+    if(rt_entry == NULL || rt_fwd(shard, rt_entry)->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
         *destination_sequence_number_out = 0;
         return false;
     }
@@ -330,10 +702,10 @@ int aodv_db_rt_get_destination_sequence_number(mac_addr dhost_ether, uint32_t* d
 }
 
 int aodv_db_rt_get_hopcount(mac_addr destination_host, uint8_t* hop_count_out) {
-    aodv_rt_entry_t* rt_entry;
-    HASH_FIND(hh, rt.entries, destination_host, ETH_ALEN, rt_entry);
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(destination_host)];
+    aodv_rt_entry_t* rt_entry = rt_find(shard, destination_host);
 
-    if(rt_entry == NULL || rt_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
+    if(rt_entry == NULL || rt_fwd(shard, rt_entry)->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
         *hop_count_out = UINT8_MAX;
         return false;
     }
@@ -342,10 +714,10 @@ int aodv_db_rt_get_hopcount(mac_addr destination_host, uint8_t* hop_count_out) {
 }
 
 int aodv_db_rt_get_metric(mac_addr destination_host, metric_t* last_metric_out) {
-    aodv_rt_entry_t* rt_entry;
-    HASH_FIND(hh, rt.entries, destination_host, ETH_ALEN, rt_entry);
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(destination_host)];
+    aodv_rt_entry_t* rt_entry = rt_find(shard, destination_host);
 
-    if(rt_entry == NULL || rt_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
+    if(rt_entry == NULL || rt_fwd(shard, rt_entry)->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
         *last_metric_out = AODV_MAX_METRIC;
         return false;
     }
@@ -354,8 +726,8 @@ int aodv_db_rt_get_metric(mac_addr destination_host, metric_t* last_metric_out)
 }
 
 int aodv_db_rt_markrouteinv(mac_addr destination_host, uint32_t destination_sequence_number) {
-    aodv_rt_entry_t* destination;
-    HASH_FIND(hh, rt.entries, destination_host, ETH_ALEN, destination);
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(destination_host)];
+    aodv_rt_entry_t* destination = rt_find(shard, destination_host);
 
     if(!destination) {
         return false;
@@ -367,70 +739,90 @@ int aodv_db_rt_markrouteinv(mac_addr destination_host, uint32_t destination_sequ
     }
 
     dessert_debug("route to " MAC " seq=%" PRIu32 ":%" PRIu32 " marked as invalid", EXPLODE_ARRAY6(destination_host), destination->sequence_number, destination_sequence_number);
-    destination->flags |= AODV_FLAGS_ROUTE_INVALID;
+    rt_fwd(shard, destination)->flags |= AODV_FLAGS_ROUTE_INVALID;
+    rt_fib_sync(shard, destination);
     return true;
 }
 
 int aodv_db_rt_get_destlist(mac_addr dhost_next_hop, aodv_link_break_element_t** destlist) {
-    // find appropriate routing entry
-    nht_entry_t* nht_entry;
-    HASH_FIND(hh, nht, dhost_next_hop, ETH_ALEN, nht_entry);
+    int found = false;
+    uint32_t i;
 
-    if(nht_entry == NULL) {
-        return false;
-    }
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        // find appropriate routing entry
+        nht_entry_t* nht_entry = hashmap_find(&rt[i].nht, hf_mac_addr_to_uint64(dhost_next_hop));
+
+        if(nht_entry == NULL) {
+            continue;
+        }
 
-    struct nht_destlist_entry* dest, *tmp;
+        found = true;
+        aodv_rt_entry_t* dest;
 
-    HASH_ITER(hh, nht_entry->dest_list, dest, tmp) {
-        aodv_link_break_element_t* el = malloc(sizeof(aodv_link_break_element_t));
-        mac_copy(el->host, dest->rt_entry->addr);
-        el->sequence_number = dest->rt_entry->sequence_number;
-        dessert_trace("create ERR: " MAC " seq=%" PRIu32 "", EXPLODE_ARRAY6(el->host), el->sequence_number);
-        DL_APPEND(*destlist, el);
+        for(dest = nht_entry->dest_list; dest; dest = dest->nht_next) {
+            aodv_link_break_element_t* el = malloc(sizeof(aodv_link_break_element_t));
+            mac_copy(el->host, dest->addr);
+            el->sequence_number = dest->sequence_number;
+            dessert_trace("create ERR: " MAC " seq=%" PRIu32 "", EXPLODE_ARRAY6(el->host), el->sequence_number);
+            DL_APPEND(*destlist, el);
+        }
     }
-    return true;
+    return found;
 }
 
 int aodv_db_rt_add_precursor(mac_addr destination_addr, mac_addr precursor_addr, dessert_meshif_t *iface) {
-    aodv_rt_entry_t* destination;
-    HASH_FIND(hh, rt.entries, destination_addr, ETH_ALEN, destination);
+    aodv_rt_entry_t* destination = rt_find(&rt[aodv_db_rt_shard(destination_addr)], destination_addr);
 
     if(!destination) {
         return false;
     }
 
-    aodv_rt_precursor_list_entry_t *precursor;
-    HASH_FIND(hh, destination->precursor_list, precursor_addr, ETH_ALEN, precursor);
+    uint64_t key = hf_mac_addr_to_uint64(precursor_addr);
+    aodv_rt_precursor_list_entry_t *precursor = hashmap_find(&destination->precursor_list, key);
 
     if(precursor) {
         return false;
     }
 
     precursor = malloc(sizeof(*precursor));
+
+    if(precursor == NULL) {
+        return false;
+    }
+
     mac_copy(precursor->addr, precursor_addr);
     precursor->iface = iface;
 
-    HASH_ADD_KEYPTR(hh, destination->precursor_list, precursor_addr, ETH_ALEN, precursor);
+    if(!hashmap_add(&destination->precursor_list, key, precursor)) {
+        free(precursor);
+        return false;
+    }
+
     return true;
 }
 
 int aodv_db_rt_inv_over_nexthop(mac_addr next_hop) {
-    // mark route as invalid and give this destination address back
-    nht_entry_t* nht_entry;
-    HASH_FIND(hh, nht, next_hop, ETH_ALEN, nht_entry);
+    int found = false;
+    uint32_t i;
 
-    if(nht_entry == NULL) {
-        return false;
-    }
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        // mark route as invalid and give this destination address back
+        nht_entry_t* nht_entry = hashmap_find(&rt[i].nht, hf_mac_addr_to_uint64(next_hop));
 
-    struct nht_destlist_entry* dest, *tmp;
+        if(nht_entry == NULL) {
+            continue;
+        }
+
+        found = true;
+        aodv_rt_entry_t* dest;
 
-    HASH_ITER(hh, nht_entry->dest_list, dest, tmp) {
-        dest->rt_entry->flags |= AODV_FLAGS_ROUTE_INVALID;
+        for(dest = nht_entry->dest_list; dest; dest = dest->nht_next) {
+            rt_fwd(&rt[i], dest)->flags |= AODV_FLAGS_ROUTE_INVALID;
+            rt_fib_sync(&rt[i], dest);
+        }
     }
 
-    return true;
+    return found;
 }
 
 /*
@@ -438,80 +830,96 @@ int aodv_db_rt_inv_over_nexthop(mac_addr next_hop) {
  * returns true on success
  */
 int aodv_db_rt_remove_nexthop(mac_addr next_hop) {
+    int found = false;
+    uint32_t i;
 
-    nht_entry_t* nht_entry;
-    HASH_FIND(hh, nht, next_hop, ETH_ALEN, nht_entry);
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        uint64_t key = hf_mac_addr_to_uint64(next_hop);
+        nht_entry_t* nht_entry = hashmap_find(&rt[i].nht, key);
 
-    if(nht_entry == NULL) {
-        return false;
-    }
+        if(nht_entry == NULL) {
+            continue;
+        }
 
-    struct nht_destlist_entry* dest, *tmp;
+        found = true;
 
-    HASH_ITER(hh, nht_entry->dest_list, dest, tmp) {
-        HASH_DEL(nht_entry->dest_list, dest);
-        free(dest);
-    }
+        // unlink all routes, rt_nht_remove frees nht_entry with the last one
+        while(nht_entry->dest_count > 1) {
+            rt_nht_remove(&rt[i], nht_entry->dest_list);
+        }
 
-    HASH_DEL(nht, nht_entry);
-    free(nht_entry);
-    return true;
+        rt_nht_remove(&rt[i], nht_entry->dest_list);
+    }
+    return found;
 }
 
 //get all routes over one neighbor
 int aodv_db_rt_get_warn_endpoints_from_neighbor_and_set_warn(mac_addr neighbor, aodv_link_break_element_t** head) {
-    // find appropriate routing entry
-    nht_entry_t* nht_entry;
-    HASH_FIND(hh, nht, neighbor, ETH_ALEN, nht_entry);
-
-    if((nht_entry == NULL) || (nht_entry->dest_list == NULL)) {
-        return false;
-    }
+    int found = false;
+    uint32_t i;
 
     *head = NULL;
-    struct nht_destlist_entry* dest, *tmp;
 
-    HASH_ITER(hh, nht_entry->dest_list, dest, tmp) {
-        if(dest->rt_entry->flags & AODV_FLAGS_ROUTE_WARN) {
-            continue;
-        }
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        // find appropriate routing entry
+        nht_entry_t* nht_entry = hashmap_find(&rt[i].nht, hf_mac_addr_to_uint64(neighbor));
 
-        if(!(dest->rt_entry->flags & AODV_FLAGS_ROUTE_LOCAL_USED)) {
+        if((nht_entry == NULL) || (nht_entry->dest_list == NULL)) {
             continue;
         }
 
-        dessert_debug("dest->rt_entry->flags = %" PRIu8 "->%p", dest->rt_entry->flags, dest->rt_entry);
-        aodv_link_break_element_t* curr_el = malloc(sizeof(aodv_link_break_element_t));
-        mac_copy(curr_el->host, dest->rt_entry->addr);
-        curr_el->sequence_number = dest->rt_entry->sequence_number;
-        DL_APPEND(*head, curr_el);
-        dest->rt_entry->flags |= AODV_FLAGS_ROUTE_WARN;
+        found = true;
+        aodv_rt_entry_t* dest;
+
+        for(dest = nht_entry->dest_list; dest; dest = dest->nht_next) {
+            aodv_rt_fwd_t* fwd = rt_fwd(&rt[i], dest);
+
+            if(fwd->flags & AODV_FLAGS_ROUTE_WARN) {
+                continue;
+            }
+
+            if(!(fwd->flags & AODV_FLAGS_ROUTE_LOCAL_USED)) {
+                continue;
+            }
+
+            dessert_debug("fwd->flags = %" PRIu8 "->%p", fwd->flags, dest);
+            aodv_link_break_element_t* curr_el = malloc(sizeof(aodv_link_break_element_t));
+            mac_copy(curr_el->host, dest->addr);
+            curr_el->sequence_number = dest->sequence_number;
+            DL_APPEND(*head, curr_el);
+            fwd->flags |= AODV_FLAGS_ROUTE_WARN;
+        }
     }
-    return true;
+    return found;
 }
 
 int aodv_db_rt_get_warn_status(mac_addr dhost_ether) {
-    aodv_rt_entry_t* rt_entry;
-    HASH_FIND(hh, rt.entries, dhost_ether, ETH_ALEN, rt_entry);
+    aodv_rt_t* shard = &rt[aodv_db_rt_shard(dhost_ether)];
+    aodv_rt_entry_t* rt_entry = rt_find(shard, dhost_ether);
 
-    if(rt_entry == NULL || rt_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
+    if(rt_entry == NULL || rt_fwd(shard, rt_entry)->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
         return false;
     }
 
-    dessert_debug("rt_entry->flags = %" PRIu8 "->%p", rt_entry->flags, rt_entry);
-    return ((rt_entry->flags & AODV_FLAGS_ROUTE_WARN) ? true : false);
+    uint8_t flags = rt_fwd(shard, rt_entry)->flags;
+    dessert_debug("rt_entry->flags = %" PRIu8 "->%p", flags, rt_entry);
+    return ((flags & AODV_FLAGS_ROUTE_WARN) ? true : false);
 }
 
 int aodv_db_rt_get_active_routes(aodv_link_break_element_t** head) {
     *head = NULL;
-    aodv_rt_entry_t* dest, *tmp;
+    uint32_t i;
 
-    HASH_ITER(hh, rt.entries, dest, tmp) {
-        if(dest->flags & AODV_FLAGS_ROUTE_LOCAL_USED) {
-            aodv_link_break_element_t* curr_el = malloc(sizeof(aodv_link_break_element_t));
-            memset(curr_el, 0x0, sizeof(aodv_link_break_element_t));
-            mac_copy(curr_el->host, dest->addr);
-            DL_APPEND(*head, curr_el);
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        uint32_t j;
+
+        for(j = 0; j < rt[i].size; ++j) {
+            if(rt[i].fwd[j].flags & AODV_FLAGS_ROUTE_LOCAL_USED) {
+                aodv_link_break_element_t* curr_el = malloc(sizeof(aodv_link_break_element_t));
+                memset(curr_el, 0x0, sizeof(aodv_link_break_element_t));
+                mac_copy(curr_el->host, rt[i].ctl[j]->addr);
+                DL_APPEND(*head, curr_el);
+            }
         }
     }
     return true;
@@ -521,64 +929,69 @@ int aodv_db_rt_routing_reset(uint32_t* count_out) {
 
     *count_out = 0;
 
-    aodv_rt_entry_t* dest = NULL;
-    aodv_rt_entry_t* tmp = NULL;
-    HASH_ITER(hh, rt.entries, dest, tmp) {
-        dest->flags |= AODV_FLAGS_ROUTE_INVALID;
-        dessert_debug("routing table reset: " MAC " is now invalid!", EXPLODE_ARRAY6(dest->addr));
-        (*count_out)++;
+    uint32_t i;
+
+    for(i = 0; i < RT_SHARD_COUNT; ++i) {
+        uint32_t j;
+
+        for(j = 0; j < rt[i].size; ++j) {
+            aodv_rt_entry_t* dest = rt[i].ctl[j];
+            rt[i].fwd[j].flags |= AODV_FLAGS_ROUTE_INVALID;
+            rt_fib_sync(&rt[i], dest);
+            dessert_debug("routing table reset: " MAC " is now invalid!", EXPLODE_ARRAY6(dest->addr));
+            (*count_out)++;
+        }
     }
     return true;
 }
 
-int aodv_db_rt_cleanup(struct timeval* timestamp) {
-    return timeslot_purgeobjects(rt.ts, timestamp);
+int aodv_db_rt_cleanup(uint32_t shard, struct timeval* timestamp) {
+    return timeslot_purgeobjects(rt[shard].ts, timestamp);
 }
 
-int aodv_db_rt_report(char** str_out) {
-    aodv_rt_entry_t* current_entry = rt.entries;
-    char* output;
-    char entry_str[REPORT_RT_STR_LEN  + 1];
+int aodv_db_rt_next_expiry(uint32_t shard, struct timeval* next_out) {
+    return timeslot_next_expiry(rt[shard].ts, next_out);
+}
 
-    uint32_t len = 0;
+int aodv_db_rt_snapshot(uint32_t shard, aodv_rt_snapshot_entry_t** entries, uint32_t* count, uint32_t* capacity) {
+    aodv_rt_t* table = &rt[shard];
 
-    while(current_entry != NULL) {
-        len += REPORT_RT_STR_LEN * 2;
-        current_entry = current_entry->hh.next;
-    }
+    if(*count + table->size > *capacity) {
+        uint32_t new_capacity = *capacity ? *capacity : 64;
+
+        while(*count + table->size > new_capacity) {
+            new_capacity *= 2;
+        }
 
-    current_entry = rt.entries;
-    output = malloc(sizeof(char) * REPORT_RT_STR_LEN * (4 + len) + 1);
+        aodv_rt_snapshot_entry_t* new_entries = realloc(*entries, new_capacity * sizeof(aodv_rt_snapshot_entry_t));
 
-    if(output == NULL) {
-        return false;
+        if(new_entries == NULL) {
+            return false;
+        }
+
+        *entries = new_entries;
+        *capacity = new_capacity;
     }
 
-    // initialize first byte to \0 to mark output as empty
-    output[0] = '\0';
-    strcat(output, "+-------------------+-------------------+-------------------+-------------+---------------+\n"
-           "|    destination    |      next hop     |  out iface addr   |  route inv  | next hop unkn |\n"
-           "+-------------------+-------------------+-------------------+-------------+---------------+\n");
+    uint32_t j;
 
-    while(current_entry != NULL) {		// first line for best output interface
-        if(current_entry->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN) {
-            snprintf(entry_str, REPORT_RT_STR_LEN, "| " MAC " |                   |                   |   %5s     |     true      |\n",
-                     EXPLODE_ARRAY6(current_entry->addr),
-                     (current_entry->flags & AODV_FLAGS_ROUTE_INVALID) ? "true" : "false");
-        }
-        else {
-            snprintf(entry_str, REPORT_RT_STR_LEN, "| " MAC " | " MAC " | " MAC " |    %5s    |     false     |\n",
-                     EXPLODE_ARRAY6(current_entry->addr),
-                     EXPLODE_ARRAY6(current_entry->next_hop),
-                     EXPLODE_ARRAY6(current_entry->output_iface->hwaddr),
-                     (current_entry->flags & AODV_FLAGS_ROUTE_INVALID) ? "true" : "false");
-        }
+    for(j = 0; j < table->size; ++j) {
+        aodv_rt_entry_t* current_entry = table->ctl[j];
+        aodv_rt_fwd_t* fwd = &table->fwd[j];
+        aodv_rt_snapshot_entry_t* el = &(*entries)[(*count)++];
 
-        strcat(output, entry_str);
-        strcat(output, "+-------------------+-------------------+-------------------+-------------+---------------+\n");
-        current_entry = current_entry->hh.next;
+        memset(el, 0x0, sizeof(*el));
+        mac_copy(el->addr, current_entry->addr);
+        el->flags = fwd->flags;
+        el->sequence_number = current_entry->sequence_number;
+        el->metric = current_entry->metric;
+        el->hop_count = current_entry->hop_count;
+
+        if(!(fwd->flags & AODV_FLAGS_NEXT_HOP_UNKNOWN)) {
+            mac_copy(el->next_hop, fwd->next_hop);
+            mac_copy(el->output_iface, fwd->output_iface->hwaddr);
+        }
     }
 
-    *str_out = output;
     return true;
 }
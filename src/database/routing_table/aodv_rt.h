@@ -26,9 +26,9 @@ For further information and questions please use the web site
 
 #include <dessert.h>
 #include <utlist.h>
-#include <uthash.h>
 #include "../../pipeline/aodv_pipeline.h"
 #include "../timeslot.h"
+#include "../hashmap.h"
 #include "../aodv_database.h"
 #include "../../config.h"
 #include "../../helper.h"
@@ -40,47 +40,118 @@ For further information and questions please use the web site
 typedef struct aodv_rt_precursor_list_entry {
     mac_addr            addr; // ID
     dessert_meshif_t*   iface;
-    UT_hash_handle      hh;
 } aodv_rt_precursor_list_entry_t;
 
-typedef struct aodv_rt_entry {
-    mac_addr            addr; // ID
+/**
+ * Forwarding state of one destination, everything the data plane needs.
+ * The forwarding states of a shard are kept densely in one array (24 bytes
+ * per destination on 64 bit hosts) so that the locked lookup and the walks
+ * over all routes stay in cache; the control plane state lives in
+ * aodv_rt_entry_t. This array is the authoritative copy and is only used
+ * under the shard lock: it is reallocated and compacted as routes come and
+ * go, so lock-free readers use the copy in aodv_rt_fib_slot_t instead,
+ * which rt_fib_sync keeps up to date.
+ */
+typedef struct aodv_rt_fwd {
     mac_addr            next_hop;
-    dessert_meshif_t*	output_iface;
-    uint32_t            sequence_number;
-    metric_t			metric;
-    uint8_t				hop_count;
     /**
      * flags format: 0 0 0 0 0 0 U I
      * I - Invalid flag; route is invalid due of link breakage
      * U - next hop Unknown flag;
      */
     uint8_t				flags;
-    aodv_rt_precursor_list_entry_t* precursor_list;
-    UT_hash_handle		hh;
+    dessert_meshif_t*	output_iface;
+    uint64_t			last_used; // ms, lookups record their use here instead of refreshing the lifetime
+} aodv_rt_fwd_t;
+
+struct nht_entry;
+
+/** Control plane state of one destination */
+typedef struct aodv_rt_entry {
+    mac_addr            addr; // ID
+    uint32_t			fwd; // index of the forwarding state in the shard
+    uint32_t            sequence_number;
+    metric_t			metric;
+    uint8_t				hop_count;
+    timeslot_node_t		ts_node;
+    hashmap_t			precursor_list; // addr -> aodv_rt_precursor_list_entry_t
+    struct nht_entry*	nht; // next hop this route is listed at, NULL if none
+    struct aodv_rt_entry* nht_prev; // membership in nht->dest_list
+    struct aodv_rt_entry* nht_next;
 } aodv_rt_entry_t;
 
+#define RT_FIB_EMPTY		UINT64_MAX
 
-typedef struct aodv_rt {
-    aodv_rt_entry_t*	entries;
-    timeslot_t*			ts;
-} aodv_rt_t;
+/**
+ * Copy of the forwarding state of one valid route, readable without any lock.
+ * Writers hold the write lock of the shard and keep seq odd while they modify
+ * the slot. Readers copy the slot and only use the copy if seq was even and
+ * did not change in between; otherwise they fall back to the locked lookup.
+ * The locked lookup holds the shard only for reading and adds flags with an
+ * atomic or, outside of seq. last_used is written by readers only and
+ * consulted lazily on expiry.
+ */
+typedef struct aodv_rt_fib_slot {
+    uint32_t			seq;
+    uint8_t				flags;
+    uint64_t			key; // destination as returned by hf_mac_addr_to_uint64
+    uint64_t			next_hop;
+    dessert_meshif_t*	output_iface;
+    uint64_t			last_used; // ms
+} aodv_rt_fib_slot_t;
 
 /**
- * Mapping next_hop -> destination list
+ * Forwarding slots of one shard. When a valid route finds no free slot or
+ * would fill more than half of them, the shard doubles them under its write lock and empties the old slots, so readers
+ * still on the old array fall back to the locked lookup. Old arrays are kept
+ * because readers may still hold them. Since every array is twice the size of
+ * the one before, all old arrays together are smaller than the current one.
  */
-typedef struct nht_destlist_entry {
-    uint8_t				destination_host[ETH_ALEN];
-    aodv_rt_entry_t*	rt_entry;
-    UT_hash_handle		hh;
-} nht_destlist_entry_t;
+typedef struct aodv_rt_fib {
+    uint32_t			mask; // slot count - 1
+    uint32_t			count; // slots holding a route
+    struct aodv_rt_fib*	retired;
+    aodv_rt_fib_slot_t	slots[];
+} aodv_rt_fib_t;
 
+
+/**
+ * Mapping next_hop -> destination list
+ *
+ * The list is threaded through the routing entries themselves (nht_prev and
+ * nht_next), so moving a route to another next hop or walking all routes over
+ * a neighbor never allocates.
+ */
 typedef struct nht_entry {
     uint8_t				destination_host_next_hop[ETH_ALEN];
-    nht_destlist_entry_t*		dest_list;
-    UT_hash_handle			hh;
+    aodv_rt_entry_t*	dest_list;
+    uint32_t			dest_count;
 } nht_entry_t;
 
+/**
+ * One shard of the routing table. Every destination lives in exactly one
+ * shard (see aodv_db_rt_shard), together with its lifetime and its entry in
+ * the next hop table. Shards are locked independently by the database facade.
+ */
+typedef struct aodv_rt {
+    hashmap_t			entries; // destination -> index + 1 into fwd and ctl
+    aodv_rt_fwd_t*		fwd;
+    aodv_rt_entry_t**	ctl; // ctl[i] is the control plane state of fwd[i]
+    uint32_t			size;
+    uint32_t			capacity;
+    timeslot_t*			ts;
+    hashmap_t			nht; // next hop -> nht_entry_t
+    aodv_rt_fib_t*		fib; // replaced under the write lock, read without lock
+} aodv_rt_t;
+
+/** Returns the index of the shard responsible for destination_host */
+static inline uint32_t aodv_db_rt_shard(mac_addr destination_host) __attribute__ ((__unused__));
+static inline uint32_t aodv_db_rt_shard(mac_addr destination_host) {
+    // the vendor part of the address is often the same for all nodes, so mix in all bytes
+    uint64_t key = hf_mac_addr_to_uint64(destination_host) * UINT64_C(0x9E3779B97F4A7C15);
+    return (uint32_t)(key >> 32) % RT_SHARD_COUNT;
+}
+
 int aodv_db_rt_init();
 
 int aodv_db_rt_capt_rreq(mac_addr destination_host,
@@ -101,9 +172,24 @@ int aodv_db_rt_capt_rrep(mac_addr destination_host,
                          uint8_t hop_count,
                          struct timeval* timestamp);
 
+/** the shard only needs to be read locked, flags and last_used are updated atomically */
 int aodv_db_rt_getroute2dest(mac_addr destination_host, mac_addr destination_host_next_hop_out,
                              dessert_meshif_t** output_iface_out, struct timeval* timestamp, uint8_t flags);
 
+/**
+ * Lock-free variant of aodv_db_rt_getroute2dest. Only answers for valid routes
+ * that already carry all requested flags; returns false whenever the caller has
+ * to take the shard lock and use aodv_db_rt_getroute2dest instead.
+ */
+int aodv_db_rt_fib_getroute2dest(mac_addr destination_host, mac_addr destination_host_next_hop_out,
+                                 dessert_meshif_t** output_iface_out, struct timeval* timestamp, uint8_t flags);
+
+/**
+ * Route generation, changes whenever the forwarding state of any route
+ * changes. Readers may keep copies of routes as long as it stays the same.
+ */
+uint64_t aodv_db_rt_generation();
+
 int aodv_db_rt_getnexthop(mac_addr destination_host, mac_addr destination_host_next_hop_out);
 
 int aodv_db_rt_getprevhop(mac_addr destination_host, mac_addr originator_host,
@@ -126,9 +212,12 @@ int aodv_db_rt_get_warn_status(mac_addr dhost_ether);
 
 int aodv_db_rt_get_active_routes(aodv_link_break_element_t** head);
 
-int aodv_db_rt_cleanup(struct timeval* timestamp);
+int aodv_db_rt_cleanup(uint32_t shard, struct timeval* timestamp);
+
+int aodv_db_rt_next_expiry(uint32_t shard, struct timeval* next_out);
 int aodv_db_rt_routing_reset(uint32_t* count_out);
 
-int aodv_db_rt_report(char** str_out);
+/** append copies of all routes of shard to *entries, which grows as needed */
+int aodv_db_rt_snapshot(uint32_t shard, aodv_rt_snapshot_entry_t** entries, uint32_t* count, uint32_t* capacity);
 
 #endif
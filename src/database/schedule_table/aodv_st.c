@@ -22,26 +22,117 @@ For further information and questions please use the web site
 *******************************************************************************/
 
 #include <string.h>
-#include <uthash.h>
 #include "../../config.h"
 #include "../../helper.h"
+#include "../hashmap.h"
 #include "aodv_st.h"
 
 typedef struct schedule {
     struct timeval      execute_ts;
-    struct __attribute__((__packed__)) {
-        uint8_t         ether_addr[ETH_ALEN];
-        uint8_t         schedule_id;
-    };
+    uint8_t             ether_addr[ETH_ALEN];
+    uint8_t             schedule_id;
     void*               schedule_param;
-    struct schedule*    next;
-    struct schedule*    prev;
-    UT_hash_handle      hh;
+    uint32_t            heap_index;
 } schedule_t;
 
-schedule_t* first_schedule = NULL;
+/**
+ * Binary min-heap ordered by execute_ts; the hash table finds a schedule by
+ * (ether_addr, schedule_id) and heap_index locates it in the heap.
+ */
+schedule_t** heap = NULL;
+uint32_t heap_size = 0;
+uint32_t heap_capacity = 0;
 
-schedule_t* hash_table = NULL;
+hashmap_t hash_table = {NULL, NULL, 0, 0, 0};
+
+/** the schedule type is packed above the 48 bits of the address */
+static inline uint64_t sc_key(mac_addr ether_addr, uint8_t type) {
+    return hf_mac_addr_to_uint64(ether_addr) | ((uint64_t) type << 48);
+}
+
+static inline void heap_set(uint32_t index, schedule_t* s) {
+    heap[index] = s;
+    s->heap_index = index;
+}
+
+static void heap_sift_up(uint32_t index) {
+    schedule_t* s = heap[index];
+
+    while(index > 0) {
+        uint32_t parent = (index - 1) / 2;
+
+        if(dessert_timevalcmp(&heap[parent]->execute_ts, &s->execute_ts) <= 0) {
+            break;
+        }
+
+        heap_set(index, heap[parent]);
+        index = parent;
+    }
+
+    heap_set(index, s);
+}
+
+static void heap_sift_down(uint32_t index) {
+    schedule_t* s = heap[index];
+
+    while(true) {
+        uint32_t child = 2 * index + 1;
+
+        if(child >= heap_size) {
+            break;
+        }
+
+        if(child + 1 < heap_size && dessert_timevalcmp(&heap[child + 1]->execute_ts, &heap[child]->execute_ts) < 0) {
+            child++;
+        }
+
+        if(dessert_timevalcmp(&s->execute_ts, &heap[child]->execute_ts) <= 0) {
+            break;
+        }
+
+        heap_set(index, heap[child]);
+        index = child;
+    }
+
+    heap_set(index, s);
+}
+
+static int heap_push(schedule_t* s) {
+    if(heap_size == heap_capacity) {
+        uint32_t new_capacity = heap_capacity ? 2 * heap_capacity : 64;
+        schedule_t** new_heap = realloc(heap, new_capacity * sizeof(schedule_t*));
+
+        if(new_heap == NULL) {
+            return false;
+        }
+
+        heap = new_heap;
+        heap_capacity = new_capacity;
+    }
+
+    heap_set(heap_size++, s);
+    heap_sift_up(s->heap_index);
+    return true;
+}
+
+static void heap_remove(schedule_t* s) {
+    uint32_t index = s->heap_index;
+    heap_size--;
+
+    if(index == heap_size) {
+        return;
+    }
+
+    // move the last schedule into the gap and restore the heap order in either direction
+    heap_set(index, heap[heap_size]);
+
+    if(index > 0 && dessert_timevalcmp(&heap[index]->execute_ts, &heap[(index - 1) / 2]->execute_ts) < 0) {
+        heap_sift_up(index);
+    }
+    else {
+        heap_sift_down(index);
+    }
+}
 
 schedule_t* create_schedule(struct timeval* execute_ts, mac_addr ether_addr, uint8_t type, void* param) {
     schedule_t* s = malloc(sizeof(schedule_t));
@@ -54,72 +145,43 @@ schedule_t* create_schedule(struct timeval* execute_ts, mac_addr ether_addr, uin
     mac_copy(s->ether_addr, ether_addr);
     s->schedule_id = type;
     s->schedule_param = param;
-    s->next = s->prev = NULL;
+    s->heap_index = 0;
     return s;
 }
 
 int aodv_db_sc_addschedule(struct timeval* execute_ts, mac_addr ether_addr, uint8_t type, void* param) {
     aodv_db_sc_dropschedule(ether_addr, type);
 
-    schedule_t* next_el = first_schedule;
     schedule_t* el = create_schedule(execute_ts, ether_addr, type, param);
 
     if(el == NULL) {
         return false;
     }
 
-    HASH_ADD_KEYPTR(hh, hash_table, el->ether_addr, ETH_ALEN + sizeof(uint8_t), el);
-
-    // search for appropriate place to insert new element
-    while(next_el != NULL && next_el->next != NULL && dessert_timevalcmp(execute_ts, &next_el->execute_ts) > 0) {
-        if(next_el->next != NULL) {
-            next_el = next_el->next;
-        }
+    if(!hashmap_add(&hash_table, sc_key(ether_addr, type), el)) {
+        free(el);
+        return false;
     }
 
-    if(next_el == NULL) {
-        first_schedule = el;
-    }
-    else {
-        if(dessert_timevalcmp(&next_el->execute_ts, execute_ts) > 0) {
-            if(next_el->prev != NULL) {
-                next_el->prev->next = el;
-                el->prev = next_el->prev;
-            }
-            else {
-                first_schedule = el;
-            }
-
-            next_el->prev = el;
-            el->next = next_el;
-        }
-        else {
-            if(next_el->next != NULL) {
-                next_el->next->prev = el;
-                el->next = next_el->next;
-            }
-
-            next_el->next = el;
-            el->prev = next_el;
-        }
+    if(!heap_push(el)) {
+        hashmap_del(&hash_table, sc_key(ether_addr, type));
+        free(el);
+        return false;
     }
 
     return true;
 }
 
-int aodv_db_sc_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, uint8_t* type, void** param) {
-    if(first_schedule != NULL && dessert_timevalcmp(&first_schedule->execute_ts, timestamp) <= 0) {
-        schedule_t* sc = first_schedule;
-        first_schedule = first_schedule->next;
-
-        if(first_schedule != NULL) {
-            first_schedule->prev = NULL;
-        }
+int aodv_db_sc_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, uint8_t* type, void** param, struct timeval* execute_ts_out) {
+    if(heap_size > 0 && dessert_timevalcmp(&heap[0]->execute_ts, timestamp) <= 0) {
+        schedule_t* sc = heap[0];
+        heap_remove(sc);
 
         mac_copy(ether_addr_out, sc->ether_addr);
         *type = sc->schedule_id;
         *param = sc->schedule_param;
-        HASH_DEL(hash_table, sc);
+        *execute_ts_out = sc->execute_ts;
+        hashmap_del(&hash_table, sc_key(sc->ether_addr, sc->schedule_id));
         free(sc);
         return true;
     }
@@ -127,12 +189,17 @@ int aodv_db_sc_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, u
     return false;
 }
 
+int aodv_db_sc_next_schedule(struct timeval* execute_ts_out) {
+    if(heap_size == 0) {
+        return false;
+    }
+
+    *execute_ts_out = heap[0]->execute_ts;
+    return true;
+}
+
 int aodv_db_sc_schedule_exists(mac_addr ether_addr, uint8_t type) {
-    schedule_t* schedule;
-    uint8_t key[ETH_ALEN + sizeof(uint8_t)];
-    mac_copy(key, ether_addr);
-    memcpy(key + ETH_ALEN, &type, sizeof(uint8_t));
-    HASH_FIND(hh, hash_table, key, ETH_ALEN + sizeof(uint8_t), schedule);
+    schedule_t* schedule = hashmap_find(&hash_table, sc_key(ether_addr, type));
 
     if(schedule == NULL) {
         return false;
@@ -143,28 +210,14 @@ int aodv_db_sc_schedule_exists(mac_addr ether_addr, uint8_t type) {
 }
 
 int aodv_db_sc_dropschedule(mac_addr ether_addr, uint8_t type) {
-    schedule_t* schedule;
-    uint8_t key[ETH_ALEN + sizeof(uint8_t)];
-    mac_copy(key, ether_addr);
-    memcpy(key + ETH_ALEN, &type, sizeof(uint8_t));
-    HASH_FIND(hh, hash_table, key, ETH_ALEN + sizeof(uint8_t), schedule);
+    schedule_t* schedule = hashmap_find(&hash_table, sc_key(ether_addr, type));
 
     if(schedule == NULL) {
         return false;
     }
 
-    if(schedule->prev != NULL) {
-        schedule->prev->next = schedule->next;
-    }
-    else {
-        first_schedule = schedule->next;
-    }
-
-    if(schedule->next != NULL) {
-        schedule->next->prev = schedule->prev;
-    }
-
-    HASH_DEL(hash_table, schedule);
+    heap_remove(schedule);
+    hashmap_del(&hash_table, sc_key(ether_addr, type));
     free(schedule);
     return true;
 }
@@ -29,7 +29,11 @@ For further information and questions please use the web site
 
 int aodv_db_sc_addschedule(struct timeval* execute_ts, mac_addr ether_addr, uint8_t type, void* param);
 
-int aodv_db_sc_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, uint8_t* type, void** param);
+/** pop the earliest schedule if it is due at timestamp; execute_ts_out receives its planned execution time */
+int aodv_db_sc_popschedule(struct timeval* timestamp, mac_addr ether_addr_out, uint8_t* type, void** param, struct timeval* execute_ts_out);
+
+/** planned execution time of the earliest schedule; false if there is none */
+int aodv_db_sc_next_schedule(struct timeval* execute_ts_out);
 
 int aodv_db_sc_schedule_exists(mac_addr ether_addr, uint8_t type);
 
@@ -22,300 +22,465 @@ For further information and questions please use the web site
 *******************************************************************************/
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <time.h>
+#include <utlist.h>
 #include "timeslot.h"
 #include "../config.h"
 #include "../helper.h"
 
-int create_new_ts_element(timeslot_element_t** ts_el_out, struct timeval* timestamp, void* object) {
-    timeslot_element_t* new_el;
+#define TIMESLOT_WHEEL_MASK		(TIMESLOT_WHEEL_SLOTS - 1)
+#define TIMESLOT_WHEEL_RANGE	(TIMESLOT_WHEEL_BITS * TIMESLOT_WHEEL_LEVELS)
 
-    new_el = malloc(sizeof(timeslot_element_t));
+timeslot_wakeup_t* timeslot_wakeup = NULL;
 
-    if(new_el == NULL) {
-        return false;
+/** put node into the wheel slot matching its expiry relative to ts->now */
+static void timeslot_link(timeslot_t* ts, timeslot_node_t* node) {
+    uint64_t expires = (node->expires < ts->now) ? ts->now : node->expires;
+    // the level is given by the highest group of bits in which expires and now differ
+    uint64_t diff = expires ^ ts->now;
+    uint8_t level;
+
+    for(level = 0; level < TIMESLOT_WHEEL_LEVELS; ++level) {
+        if((diff >> (TIMESLOT_WHEEL_BITS * (level + 1))) == 0) {
+            break;
+        }
     }
 
-    new_el->next = NULL;
-    new_el->prev = NULL;
+    node->level = level;
+
+    if(level == TIMESLOT_WHEEL_LEVELS) {
+        DL_APPEND(ts->overflow, node);
+        return;
+    }
 
-    struct timeval* purge_time = malloc(sizeof(struct timeval));
-    purge_time->tv_sec = timestamp->tv_sec;
-    purge_time->tv_usec = timestamp->tv_usec;
-    new_el->purge_time = purge_time;
+    node->slot = (expires >> (TIMESLOT_WHEEL_BITS * level)) & TIMESLOT_WHEEL_MASK;
+    DL_APPEND(ts->wheel[level][node->slot], node);
+    ts->occupied[level] |= UINT64_C(1) << node->slot;
+}
 
-    new_el->object = object;
-    *ts_el_out = new_el;
-    return true;
+static void timeslot_unlink(timeslot_t* ts, timeslot_node_t* node) {
+    if(node->level == TIMESLOT_WHEEL_LEVELS) {
+        DL_DELETE(ts->overflow, node);
+        return;
+    }
+
+    DL_DELETE(ts->wheel[node->level][node->slot], node);
+
+    if(ts->wheel[node->level][node->slot] == NULL) {
+        ts->occupied[node->level] &= ~(UINT64_C(1) << node->slot);
+    }
+}
+
+/** move all nodes of list to the slots matching the current tick */
+static void timeslot_relink_all(timeslot_t* ts, timeslot_node_t* list) {
+    while(list != NULL) {
+        timeslot_node_t* node = list;
+        DL_DELETE(list, node);
+        timeslot_link(ts, node);
+    }
+}
+
+/** ts->now entered new slots on higher levels, distribute their nodes to the lower levels */
+static void timeslot_cascade(timeslot_t* ts) {
+    int level;
+
+    if((ts->now & ((UINT64_C(1) << TIMESLOT_WHEEL_RANGE) - 1)) == 0 && ts->overflow != NULL) {
+        timeslot_node_t* list = ts->overflow;
+        ts->overflow = NULL;
+        timeslot_relink_all(ts, list);
+    }
+
+    for(level = TIMESLOT_WHEEL_LEVELS - 1; level > 0; --level) {
+        if(ts->now & ((UINT64_C(1) << (TIMESLOT_WHEEL_BITS * level)) - 1)) {
+            continue;
+        }
+
+        uint8_t slot = (ts->now >> (TIMESLOT_WHEEL_BITS * level)) & TIMESLOT_WHEEL_MASK;
+        timeslot_node_t* list = ts->wheel[level][slot];
+
+        if(list != NULL) {
+            ts->wheel[level][slot] = NULL;
+            ts->occupied[level] &= ~(UINT64_C(1) << slot);
+            timeslot_relink_all(ts, list);
+        }
+    }
+}
+
+/** first tick after ts->now at which a non-empty slot is entered, UINT64_MAX if there is none */
+static uint64_t timeslot_next_tick(timeslot_t* ts) {
+    uint64_t next = UINT64_MAX;
+    int level;
+
+    for(level = 0; level < TIMESLOT_WHEEL_LEVELS; ++level) {
+        int shift = TIMESLOT_WHEEL_BITS * level;
+        uint8_t idx = (ts->now >> shift) & TIMESLOT_WHEEL_MASK;
+
+        if(idx == TIMESLOT_WHEEL_MASK) {
+            continue;
+        }
+
+        uint64_t later = ts->occupied[level] & (~UINT64_C(0) << (idx + 1));
+
+        if(later != 0) {
+            uint64_t block = (ts->now >> (shift + TIMESLOT_WHEEL_BITS)) << (shift + TIMESLOT_WHEEL_BITS);
+            next = min(next, block | ((uint64_t) __builtin_ctzll(later) << shift));
+        }
+    }
+
+    if(ts->overflow != NULL) {
+        next = min(next, ((ts->now >> TIMESLOT_WHEEL_RANGE) + 1) << TIMESLOT_WHEEL_RANGE);
+    }
+
+    return next;
+}
+
+/** purge all nodes of the current level 0 slot that are due at curr_time; returns number of purged nodes */
+static uint32_t timeslot_expire_slot(timeslot_t* ts, struct timeval* curr_time) {
+    uint8_t slot = ts->now & TIMESLOT_WHEEL_MASK;
+    timeslot_node_t* list = ts->wheel[0][slot];
+    uint32_t count = 0;
+
+    if(list == NULL) {
+        return 0;
+    }
+
+    ts->wheel[0][slot] = NULL;
+    ts->occupied[0] &= ~(UINT64_C(1) << slot);
+
+    while(list != NULL) {
+        timeslot_node_t* node = list;
+        DL_DELETE(list, node);
+
+        if(dessert_timevalcmp(&node->purge_time, curr_time) > 0) {
+            // same tick, but not yet due
+            timeslot_link(ts, node);
+            continue;
+        }
+
+        // unlinked before calling the purger so that it may add the object again
+        node->linked = false;
+        ts->size--;
+        count++;
+
+        if(node->owned) {
+            hashmap_del(&ts->elements_hash, (uintptr_t) node->object);
+
+            if(ts->object_purger != NULL) {
+                ts->object_purger(&node->purge_time, ts->src_object, node->object);
+            }
+
+            free(node);
+        }
+        else if(ts->object_purger != NULL) {
+            // the purger usually frees the record containing the node
+            ts->object_purger(&node->purge_time, ts->src_object, node->object);
+        }
+    }
+
+    return count;
 }
 
 int timeslot_create(timeslot_t** ts_out, struct timeval* purge_timeout, void* src_object, object_purger_t* object_purger) {
     timeslot_t* ts;
-    ts = malloc(sizeof(timeslot_t));
+    ts = calloc(1, sizeof(timeslot_t));
 
     if(ts == NULL) {
         return false;
     }
 
-    ts->head = NULL;
-    ts->tail = NULL;
+    struct timeval curr_time;
+    gettimeofday(&curr_time, NULL);
+
+    ts->now = hf_tv_to_ms(&curr_time);
     ts->size = 0;
     ts->object_purger = object_purger;
-    ts->purge_timeout = malloc(sizeof(struct timeval));
-    ts->purge_timeout->tv_sec = purge_timeout->tv_sec;
-    ts->purge_timeout->tv_usec = purge_timeout->tv_usec;
+    ts->purge_timeout = *purge_timeout;
     ts->src_object = src_object;
-    ts->elements_hash = NULL;
+    ts->overflow = NULL;
+    hashmap_init(&ts->elements_hash);
+    ts->purging = false;
+    ts->purge_on_add = true;
+    ts->armed = UINT64_MAX;
     *ts_out = ts;
     return true;
 }
 
+void timeslot_set_purge_on_add(timeslot_t* ts, int purge_on_add) {
+    ts->purge_on_add = purge_on_add;
+}
+
 int timeslot_destroy(timeslot_t* ts) {
-    timeslot_element_t* search_el = ts->elements_hash;
+    // embedded nodes belong to their records, only the allocated elements are freed
+    timeslot_node_t* node;
+    uint32_t pos = 0;
 
-    while(search_el != NULL) {
-        HASH_DEL(ts->elements_hash, search_el);
-        free(search_el);
-        search_el = ts->elements_hash;
+    while(hashmap_next(&ts->elements_hash, &pos, NULL, (void**) &node)) {
+        free(node);
     }
 
+    hashmap_destroy(&ts->elements_hash);
     free(ts);
     return true;
 }
 
+/** record the earliest tick at which an object may expire, after a purge moved the wheel on */
+static void timeslot_rearm(timeslot_t* ts) {
+    uint64_t next;
+
+    if(ts->size == 0) {
+        next = UINT64_MAX;
+    }
+    else if(ts->wheel[0][ts->now & TIMESLOT_WHEEL_MASK] != NULL) {
+        // objects of the current tick that were not yet due or were added late
+        next = ts->now + 1;
+    }
+    else {
+        next = timeslot_next_tick(ts);
+    }
+
+    __atomic_store_n(&ts->armed, next, __ATOMIC_RELAXED);
+}
+
 int timeslot_purgeobjects(timeslot_t* ts, struct timeval* curr_time) {
-    timeslot_element_t* search_el = ts->tail;
+    // a purger may add its object again; the purge already running takes care of it
+    if(ts->purging) {
+        return true;
+    }
 
-    while(search_el != NULL && dessert_timevalcmp(search_el->purge_time, curr_time) <= 0) {
-        HASH_DEL(ts->elements_hash, search_el);
+    ts->purging = true;
+    uint64_t target = hf_tv_to_ms(curr_time);
 
-        if(search_el == ts->head) {
-            ts->tail = ts->head = NULL;
-        }
-        else {
-            ts->tail = search_el->next;
+    while(true) {
+        while(timeslot_expire_slot(ts, curr_time) > 0);
 
-            if(ts->tail != NULL) {
-                ts->tail->prev = NULL;
-            }
+        if(ts->now >= target) {
+            break;
         }
 
-        ts->size--;
-        timeslot_element_t* new_tail = ts->tail;
+        // skip empty slots
+        uint64_t next = timeslot_next_tick(ts);
 
-        if(ts->object_purger != NULL) {
-            ts->object_purger(search_el->purge_time, ts->src_object, search_el->object);
+        if(next > target) {
+            ts->now = target;
+            break;
         }
 
-        free(search_el);
-        search_el = new_tail;
+        ts->now = next;
+        timeslot_cascade(ts);
     }
 
+    ts->purging = false;
+    timeslot_rearm(ts);
     return true;
 }
 
-int timeslot_addobject(timeslot_t* ts, struct timeval* timestamp, void* object) {
-    timeslot_element_t* new_el;
-    struct timeval purge_time;
-    dessert_timevaladd2(&purge_time, ts->purge_timeout, timestamp);
+void timeslot_node_init(timeslot_node_t* node, void* object) {
+    node->prev = NULL;
+    node->next = NULL;
+    node->object = object;
+    node->linked = false;
+    node->owned = false;
+}
 
-    if(create_new_ts_element(&new_el, &purge_time, object) == false) {
-        return false;
+int timeslot_addnode_varpurge(timeslot_t* ts, struct timeval* timestamp, timeslot_node_t* node, struct timeval* lifetime) {
+    if(node->linked) {
+        // refresh: just move the node to its new slot
+        timeslot_unlink(ts, node);
+    }
+    else {
+        node->linked = true;
+        ts->size++;
     }
 
-    // first find element with *object pointer and delete this element
-    timeslot_deleteobject(ts, object);
+    dessert_timevaladd2(&node->purge_time, lifetime, timestamp);
+    node->expires = hf_tv_to_ms(&node->purge_time);
+    timeslot_link(ts, node);
 
-    HASH_ADD_KEYPTR(hh, ts->elements_hash, &new_el->object, sizeof(void*), new_el);
+    if(node->expires < ts->armed) {
+        __atomic_store_n(&ts->armed, node->expires, __ATOMIC_RELAXED);
 
-    // if this is a first element -> set tail and head
-    if(ts->size == 0) {
-        ts->head = ts->tail = new_el;
-        ts->size = 1;
-        return true;
+        if(timeslot_wakeup != NULL) {
+            timeslot_wakeup(&node->purge_time);
+        }
     }
 
-    // insert new element into appropriate place
-    timeslot_element_t* search_el = ts->head;
-
-    while(search_el->prev != NULL && (dessert_timevalcmp(&purge_time, search_el->purge_time) < 0)) {
-        // we search for an smaller element
-        search_el = search_el->prev;
+    if(ts->purge_on_add) {
+        timeslot_purgeobjects(ts, timestamp);
     }
 
-    if(dessert_timevalcmp(&purge_time, search_el->purge_time) >= 0) {
-        // insert new element after search element
-        new_el->prev = search_el;
-        new_el->next = search_el->next;
-        search_el->next = new_el;
+    return true;
+}
 
-        if(new_el->next != NULL) {
-            new_el->next->prev = new_el;
-        }
+int timeslot_addnode(timeslot_t* ts, struct timeval* timestamp, timeslot_node_t* node) {
+    return timeslot_addnode_varpurge(ts, timestamp, node, &ts->purge_timeout);
+}
 
-        if(ts->head == search_el) {
-            ts->head = new_el;
-        }
+int timeslot_deletenode(timeslot_t* ts, timeslot_node_t* node) {
+    if(!node->linked) {
+        return false;
     }
-    else {
-        // insert new element before search element
-        new_el->prev = search_el->prev;
-        new_el->next = search_el;
-        search_el->prev = new_el;
 
-        if(new_el->prev != NULL) {
-            new_el->prev->next = new_el;
+    timeslot_unlink(ts, node);
+    node->linked = false;
+    ts->size--;
+    return true;
+}
+
+int timeslot_addobject_varpurge(timeslot_t* ts, struct timeval* timestamp, void* object, struct timeval* not_def_lifetime) {
+    timeslot_node_t* node = hashmap_find(&ts->elements_hash, (uintptr_t) object);
+
+    if(node == NULL) {
+        node = malloc(sizeof(timeslot_node_t));
+
+        if(node == NULL) {
+            return false;
         }
 
-        if(ts->tail == search_el) {
-            ts->tail = new_el;
+        timeslot_node_init(node, object);
+        node->owned = true;
+
+        if(!hashmap_add(&ts->elements_hash, (uintptr_t) object, node)) {
+            free(node);
+            return false;
         }
     }
 
-    ts->size++;
+    return timeslot_addnode_varpurge(ts, timestamp, node, not_def_lifetime);
+}
 
-    struct timeval curr_time;
-    gettimeofday(&curr_time, NULL);
-    timeslot_purgeobjects(ts, &curr_time);
-    return true;
+int timeslot_addobject(timeslot_t* ts, struct timeval* timestamp, void* object) {
+    return timeslot_addobject_varpurge(ts, timestamp, object, &ts->purge_timeout);
 }
 
-int timeslot_addobject_varpurge(timeslot_t* ts, struct timeval* timestamp, void* object, struct timeval* not_def_lifetime) {
-    timeslot_element_t* new_el;
-    struct timeval purge_time;
-    dessert_timevaladd2(&purge_time, not_def_lifetime, timestamp);
+int timeslot_deleteobject(timeslot_t* ts, void* object) {
+    // first find element with *object pointer
+    timeslot_node_t* old_node = hashmap_find(&ts->elements_hash, (uintptr_t) object);
 
-    if(create_new_ts_element(&new_el, &purge_time, object) == false) {
-        return false;
+    // then delete if found
+    if(old_node != NULL) {
+        timeslot_deletenode(ts, old_node);
+        hashmap_del(&ts->elements_hash, (uintptr_t) object);
+        free(old_node);
+        return true;
     }
 
-    // first find element with *object pointer and delete this element
-    timeslot_deleteobject(ts, object);
+    return false;
+}
 
-    HASH_ADD_KEYPTR(hh, ts->elements_hash, &new_el->object, sizeof(void*), new_el);
+int timeslot_next_expiry(timeslot_t* ts, struct timeval* next_out) {
+    uint64_t armed = __atomic_load_n(&ts->armed, __ATOMIC_RELAXED);
 
-    // if this is a first element -> set tail and head
-    if(ts->size == 0) {
-        ts->head = ts->tail = new_el;
-        ts->size = 1;
-        return true;
+    if(armed == UINT64_MAX) {
+        return false;
     }
 
-    // insert new element into appropriate place
-    timeslot_element_t* search_el = ts->head;
-
-    while(search_el->prev != NULL && (dessert_timevalcmp(&purge_time, search_el->purge_time) < 0)) {
-        // we search for an smaller element
-        search_el = search_el->prev;
-    }
+    hf_uint64_to_tv(armed, next_out);
+    return true;
+}
 
-    if(dessert_timevalcmp(&purge_time, search_el->purge_time) >= 0) {
-        // insert new element after search element
-        new_el->prev = search_el;
-        new_el->next = search_el->next;
-        search_el->next = new_el;
+typedef struct timeslot_report_buf {
+    char* str;
+    size_t len;
+    size_t capacity;
+} timeslot_report_buf_t;
 
-        if(new_el->next != NULL) {
-            new_el->next->prev = new_el;
-        }
+/** append to the report, doubling the buffer when it is full */
+static void timeslot_report_printf(timeslot_report_buf_t* buf, const char* fmt, ...) __attribute__ ((format (printf, 2, 3)));
+static void timeslot_report_printf(timeslot_report_buf_t* buf, const char* fmt, ...) {
+    va_list args;
 
-        if(ts->head == search_el) {
-            ts->head = new_el;
-        }
+    if(buf->str == NULL) {
+        return; // out of memory before
     }
-    else {
-        // insert new element before search element
-        new_el->prev = search_el->prev;
-        new_el->next = search_el;
-        search_el->prev = new_el;
 
-        if(new_el->prev != NULL) {
-            new_el->prev->next = new_el;
-        }
+    va_start(args, fmt);
+    int n = vsnprintf(buf->str + buf->len, buf->capacity - buf->len, fmt, args);
+    va_end(args);
 
-        if(ts->tail == search_el) {
-            ts->tail = new_el;
-        }
+    if(n < 0) {
+        return;
     }
 
-    ts->size++;
+    if(buf->len + n >= buf->capacity) {
+        size_t capacity = buf->capacity;
 
-    struct timeval curr_time;
-    gettimeofday(&curr_time, NULL);
-    timeslot_purgeobjects(ts, &curr_time);
-    return true;
-}
-
-int timeslot_deleteobject(timeslot_t* ts, void* object) {
-    // first find element with *object pointer
-    timeslot_element_t* old_el;
-    HASH_FIND(hh, ts->elements_hash, &object, sizeof(void*), old_el);
-
-    // then delete if found
-    if(old_el != NULL) {
-        if(old_el->prev != NULL) {
-            old_el->prev->next = old_el->next;
+        while(buf->len + n >= capacity) {
+            capacity *= 2;
         }
 
-        if(old_el->next != NULL) {
-            old_el->next->prev = old_el->prev;
-        }
+        char* str = realloc(buf->str, capacity);
 
-        if(ts->tail == old_el) {
-            ts->tail = ts->tail->next;
+        if(str == NULL) {
+            return; // keep what fits
         }
 
-        if(ts->head == old_el) {
-            ts->head = ts->head->prev;
-        }
+        buf->str = str;
+        buf->capacity = capacity;
 
-        HASH_DEL(ts->elements_hash, old_el);
-        free(old_el);
-        ts->size--;
-        return true;
+        va_start(args, fmt);
+        vsnprintf(buf->str + buf->len, buf->capacity - buf->len, fmt, args);
+        va_end(args);
     }
 
-    return false;
+    buf->len += n;
 }
 
 void timeslot_report(timeslot_t* ts, char** str_out) {
-
-    char* output = calloc(1, 1024);
-    char entry[128];
+    timeslot_report_buf_t buf;
+    buf.capacity = 1024;
+    buf.len = 0;
+    buf.str = calloc(1, buf.capacity);
 
     if(ts == NULL) {
-        snprintf(entry, 128, "Time Slot: NULL\n");
-        strcat(output, entry);
-        *str_out = output;
+        timeslot_report_printf(&buf, "Time Slot: NULL\n");
+        *str_out = buf.str;
         return;
     }
 
-    if(ts->head == NULL) {
-        snprintf(entry, 128, "Time Slot: EMPTY\n");
-        strcat(output, entry);
-        *str_out = output;
+    if(ts->size == 0) {
+        timeslot_report_printf(&buf, "Time Slot: EMPTY\n");
+        *str_out = buf.str;
         return;
     }
 
-    snprintf(entry, 128, "---------- Time Slot  -------------\n");
-    strcat(output, entry);
+    timeslot_node_t* node;
+    struct timeval max_time = {0, 0};
+    int level, slot;
+
+    for(level = 0; level <= TIMESLOT_WHEEL_LEVELS; ++level) {
+        for(slot = 0; slot < TIMESLOT_WHEEL_SLOTS; ++slot) {
+            timeslot_node_t* list = (level == TIMESLOT_WHEEL_LEVELS) ? ts->overflow : ts->wheel[level][slot];
+
+            DL_FOREACH(list, node) {
+                if(dessert_timevalcmp(&node->purge_time, &max_time) > 0) {
+                    max_time = node->purge_time;
+                }
+            }
 
-    snprintf(entry, 128, "Timeslot size : %" PRIu32 "\n", ts->size);
-    strcat(output, entry);
+            if(level == TIMESLOT_WHEEL_LEVELS) {
+                break;
+            }
+        }
+    }
 
-    snprintf(entry, 128, "max timestamp : %ld.%.6ld\n", ts->head->purge_time->tv_sec, ts->head->purge_time->tv_usec);
-    strcat(output, entry);
+    timeslot_report_printf(&buf, "---------- Time Slot  -------------\n");
+    timeslot_report_printf(&buf, "Timeslot size : %" PRIu32 "\n", ts->size);
+    timeslot_report_printf(&buf, "max timestamp : %ld.%.6ld\n", max_time.tv_sec, max_time.tv_usec);
 
-    timeslot_element_t* search_el = ts->tail;
+    for(level = 0; level <= TIMESLOT_WHEEL_LEVELS; ++level) {
+        for(slot = 0; slot < TIMESLOT_WHEEL_SLOTS; ++slot) {
+            timeslot_node_t* list = (level == TIMESLOT_WHEEL_LEVELS) ? ts->overflow : ts->wheel[level][slot];
 
-    while(search_el != NULL && search_el->purge_time != NULL) {
-        snprintf(entry, 128, "element       : ");
-        strcat(output, entry);
-        snprintf(entry, 128, "%ld.%.6ld\n", search_el->purge_time->tv_sec, search_el->purge_time->tv_usec);
-        strcat(output, entry);
-        search_el = search_el->next;
+            DL_FOREACH(list, node) {
+                timeslot_report_printf(&buf, "element       : %ld.%.6ld\n", node->purge_time.tv_sec, node->purge_time.tv_usec);
+            }
+
+            if(level == TIMESLOT_WHEEL_LEVELS) {
+                break;
+            }
+        }
     }
 
-    *str_out = output;
+    *str_out = buf.str;
 }
-
@@ -25,37 +25,75 @@ For further information and questions please use the web site
 #define TIMESLOT
 
 #include <stdlib.h>
-#include <uthash.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "hashmap.h"
 
 typedef void object_purger_t(struct timeval* purge_time, void* src_object, void* object);
 
-typedef struct timeslot_element {
-    struct timeslot_element*	prev;
-    struct timeslot_element*	next;
-    struct timeval* 			purge_time;
-    void*						object; // key
-    UT_hash_handle 				hh;
-} timeslot_element_t;
+/** called with the new deadline whenever a time-slot gets an expiry earlier than the one last reported */
+typedef void timeslot_wakeup_t(struct timeval* deadline);
+
+extern timeslot_wakeup_t* timeslot_wakeup;
+
+/**
+ * Objects are kept in a hierarchical timing wheel with millisecond ticks.
+ * Level 0 has one slot per tick, every further level covers
+ * TIMESLOT_WHEEL_SLOTS slots of the level below. Objects further away than the
+ * whole wheel wait in an overflow list. Insert, refresh and delete are O(1),
+ * expiry is amortized O(1) per object.
+ */
+#define TIMESLOT_WHEEL_BITS		6
+#define TIMESLOT_WHEEL_SLOTS	(1 << TIMESLOT_WHEEL_BITS)
+#define TIMESLOT_WHEEL_LEVELS	4
+
+/**
+ * Timer node. Records embed one to refresh their lifetime with the *node
+ * functions without any allocation or hash lookup. A node must be removed with
+ * timeslot_deletenode before its record is freed outside of the purger.
+ */
+typedef struct timeslot_node {
+    struct timeslot_node*		prev;
+    struct timeslot_node*		next;
+    struct timeval				purge_time;
+    uint64_t					expires; // purge_time in ms
+    void*						object; // passed to the purger
+    uint8_t						level; // TIMESLOT_WHEEL_LEVELS means overflow list
+    uint8_t						slot;
+    uint8_t						linked;
+    uint8_t						owned; // allocated by timeslot_addobject
+} timeslot_node_t;
 
 typedef struct timeslot {
-    struct timeslot_element*	head;
-    struct timeslot_element*	tail;
+    struct timeslot_node*		wheel[TIMESLOT_WHEEL_LEVELS][TIMESLOT_WHEEL_SLOTS];
+    uint64_t					occupied[TIMESLOT_WHEEL_LEVELS]; // bitmap of non-empty slots per level
+    struct timeslot_node*		overflow;
+    uint64_t					now; // current tick in ms, all earlier ticks are processed
     uint32_t					size;
     object_purger_t*			object_purger;
-    struct timeval*				purge_timeout;
+    struct timeval				purge_timeout;
     void*						src_object;
-    struct timeslot_element*	elements_hash;
+    hashmap_t					elements_hash; // object pointer -> node allocated for objects without an embedded node
+    int							purging;
+    int							purge_on_add; // purge due objects whenever an object is added
+    uint64_t					armed; // ms, never later than the expiry of any object; read without lock
 } timeslot_t;
 
 /** Create time-slot */
 int timeslot_create(timeslot_t** ts_out, struct timeval* purge_timeout,
                     void* src_object, object_purger_t* object_purger);
 
+/**
+ * Purging on add is on by default. Tables whose expiry is left entirely to
+ * aodv_db_cleanup turn it off to keep adding O(1).
+ */
+void timeslot_set_purge_on_add(timeslot_t* ts, int purge_on_add);
+
 /** Remove all time-slot elements and destroy time-slot */
 int timeslot_destroy(timeslot_t* ts);
 
 /** Add object with timestamp number time-slot.
- * Pudges all objects older than timestamp - pudge_timeout from time-slot */
+ * Pudges all objects with purge time before timestamp from time-slot (see timeslot_set_purge_on_add) */
 int timeslot_addobject(timeslot_t* ts, struct timeval* timestamp, void* object);
 
 /**
@@ -67,9 +105,29 @@ int timeslot_addobject_varpurge(timeslot_t* ts, struct timeval* timestamp, void*
 /** delete an object from timeslot */
 int timeslot_deleteobject(timeslot_t* ts, void* object);
 
+/** Prepare an embedded node; object is handed to the purger on expiry */
+void timeslot_node_init(timeslot_node_t* node, void* object);
+
+/** Add or refresh node with the default purge timeout of the time-slot */
+int timeslot_addnode(timeslot_t* ts, struct timeval* timestamp, timeslot_node_t* node);
+
+/** Add or refresh node with the given lifetime */
+int timeslot_addnode_varpurge(timeslot_t* ts, struct timeval* timestamp, timeslot_node_t* node, struct timeval* lifetime);
+
+/** Remove node from time-slot; does nothing if it is not in there */
+int timeslot_deletenode(timeslot_t* ts, timeslot_node_t* node);
+
 /**Pudges all objects older with curr_time > purge_time from time-slot*/
 int timeslot_purgeobjects(timeslot_t* sw, struct timeval* curr_time);
 
+/**
+ * Get the time at which the next object may expire. The result is never later
+ * than the real expiry of the earliest object. Returns false if the time-slot
+ * is empty. Needs no lock: it reads what the last purge and all later adds
+ * recorded, so it may also be earlier than the real expiry.
+ */
+int timeslot_next_expiry(timeslot_t* ts, struct timeval* next_out);
+
 void timeslot_report(timeslot_t* ts, char** str_out);
 
 #endif
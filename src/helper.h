@@ -67,6 +67,26 @@ static inline uint64_t hf_mac_addr_to_uint64(const mac_addr addr) {
     return result;
 }
 
+static inline void hf_uint64_to_mac_addr(uint64_t key, mac_addr addr_out) __attribute__ ((__unused__));
+static inline void hf_uint64_to_mac_addr(uint64_t key, mac_addr addr_out) {
+    int i;
+    for(i = 0; i < ETH_ALEN; ++i) {
+        addr_out[i] = key & 0xff;
+        key >>= 8;
+    }
+}
+
+static inline uint64_t hf_tv_to_ms(const struct timeval* tv) __attribute__ ((__unused__));
+static inline uint64_t hf_tv_to_ms(const struct timeval* tv) {
+    return (uint64_t) tv->tv_sec * 1000 + tv->tv_usec / 1000;
+}
+
+static inline void hf_uint64_to_tv(uint64_t ms, struct timeval* tv_out) __attribute__ ((__unused__));
+static inline void hf_uint64_to_tv(uint64_t ms, struct timeval* tv_out) {
+    tv_out->tv_sec = ms / 1000;
+    tv_out->tv_usec = (ms % 1000) * 1000;
+}
+
 /******************************************************************************/
 
 /** Return value between 1 and 5 for rssi values */
@@ -0,0 +1,470 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <dessert.h>
+
+#include "aodv_discovery.h"
+#include "aodv_pipeline.h"
+#include "aodv_ratelimit.h"
+#include "../database/aodv_database.h"
+#include "../database/hashmap.h"
+#include "../config.h"
+#include "../helper.h"
+
+enum {
+    AODV_DISCOVERY_START,
+    AODV_DISCOVERY_FOUND,
+    AODV_DISCOVERY_RETRY
+};
+
+typedef struct aodv_discovery_cmd {
+    struct aodv_discovery_cmd* next;
+    uint8_t type;
+    mac_addr dest;
+    uintptr_t id; // AODV_DISCOVERY_RETRY only
+    uint64_t posted_us; // monotonic clock
+} aodv_discovery_cmd_t;
+
+/* a running series of RREQs to the destination of msg, owned by the engine thread */
+typedef struct aodv_discovery {
+    dessert_msg_t* msg;
+    int retries;
+    uintptr_t id; // tells retries of this series from stale ones of a stopped series
+    uint64_t started_us; // monotonic clock, when the start was posted
+    uint8_t sent; // RREQs sent so far
+    uint8_t sent_ttl; // TTL of the last RREQ sent
+    uint8_t exhausted; // the last RREQ was sent, waiting for its RREP
+} aodv_discovery_t;
+
+// producers push onto this stack, the engine takes all of it at once
+static aodv_discovery_cmd_t* cmd_head = NULL;
+// signaled whenever a producer finds the stack empty
+static int cmd_fd = -1;
+static pthread_t discovery_thread;
+
+// everything below is only touched by the engine thread, except running_hint
+static hashmap_t discoveries; // destination -> aodv_discovery_t
+static uintptr_t discovery_id = 0;
+
+/*
+ * destination of a running discovery per slot, written by the engine. Producers
+ * skip posting a start for a destination found here; a destination that is not
+ * found may still be running, the engine then drops the duplicate start.
+ */
+static uint64_t running_hint[DISCOVERY_HINT_SLOTS] = {
+    [0 ... DISCOVERY_HINT_SLOTS - 1] = UINT64_MAX
+};
+
+// results of finished discoveries, written by the engine and read by the cli
+static aodv_discovery_stats_t stats;
+static hashmap_t dest_stats; // destination -> aodv_discovery_dest_stats_t
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t aodv_discovery_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline uint64_t* aodv_discovery_hint(uint64_t key) {
+    return &running_hint[(uint32_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) % DISCOVERY_HINT_SLOTS];
+}
+
+static void aodv_discovery_post(uint8_t type, mac_addr dest, uintptr_t id) {
+    aodv_discovery_cmd_t* cmd = malloc(sizeof(*cmd));
+
+    if(cmd == NULL) {
+        dessert_warn("could not post discovery command for " MAC, EXPLODE_ARRAY6(dest));
+        return;
+    }
+
+    cmd->type = type;
+    mac_copy(cmd->dest, dest);
+    cmd->id = id;
+    cmd->posted_us = aodv_discovery_now_us();
+
+    aodv_discovery_cmd_t* head = __atomic_load_n(&cmd_head, __ATOMIC_RELAXED);
+
+    do {
+        cmd->next = head;
+    }
+    while(!__atomic_compare_exchange_n(&cmd_head, &head, cmd, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    // the engine drains the whole stack per signal, so only the first command needs one
+    int fd = __atomic_load_n(&cmd_fd, __ATOMIC_ACQUIRE);
+
+    if(head == NULL && fd >= 0) {
+        uint64_t one = 1;
+
+        if(write(fd, &one, sizeof(one)) < 0) {
+            dessert_warn("could not signal discovery engine: %s", strerror(errno));
+        }
+    }
+}
+
+void aodv_discovery_start(mac_addr dest) {
+    uint64_t key = hf_mac_addr_to_uint64(dest);
+
+    // every packet to an unknown destination ends up here
+    if(__atomic_load_n(aodv_discovery_hint(key), __ATOMIC_RELAXED) == key) {
+        dessert_trace("There is a rreq schedule to this dest. We dont start a new series.");
+        return;
+    }
+
+    aodv_discovery_post(AODV_DISCOVERY_START, dest, 0);
+}
+
+void aodv_discovery_found(mac_addr dest) {
+    aodv_discovery_post(AODV_DISCOVERY_FOUND, dest, 0);
+}
+
+void aodv_discovery_retry(mac_addr dest, uintptr_t id) {
+    aodv_discovery_post(AODV_DISCOVERY_RETRY, dest, id);
+}
+
+// ---------------------------- statistics -----------------------------------
+
+static void aodv_discovery_count(mac_addr dest, aodv_discovery_t* discovery, int found, uint64_t found_us) {
+    uint64_t latency_us = found_us - discovery->started_us;
+    uint8_t retries = discovery->sent ? discovery->sent - 1 : 0;
+
+    pthread_mutex_lock(&stats_mutex);
+    stats.retries[min(retries, RREQ_RETRIES)]++;
+
+    if(found) {
+        stats.succeeded++;
+        stats.ttl[discovery->sent_ttl]++;
+        aodv_hist_add(&stats.latency_us, latency_us);
+    }
+    else {
+        stats.failed++;
+    }
+
+    uint64_t key = hf_mac_addr_to_uint64(dest);
+    aodv_discovery_dest_stats_t* d = hashmap_find(&dest_stats, key);
+
+    if(!d && hashmap_count(&dest_stats) < DISCOVERY_STATS_DESTS) {
+        d = calloc(1, sizeof(*d));
+
+        if(d && !hashmap_add(&dest_stats, key, d)) {
+            free(d);
+            d = NULL;
+        }
+
+        if(d) {
+            mac_copy(d->dest, dest);
+        }
+    }
+
+    if(d) {
+        d->retries += retries;
+
+        if(found) {
+            d->succeeded++;
+            d->latency_sum_us += latency_us;
+            d->latency_last_us = latency_us;
+            d->ttl_last = discovery->sent_ttl;
+
+            if(d->succeeded == 1 || latency_us < d->latency_min_us) {
+                d->latency_min_us = latency_us;
+            }
+            if(latency_us > d->latency_max_us) {
+                d->latency_max_us = latency_us;
+            }
+        }
+        else {
+            d->failed++;
+        }
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void aodv_discovery_stats(aodv_discovery_stats_t* stats_out) {
+    pthread_mutex_lock(&stats_mutex);
+    *stats_out = stats;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+int aodv_discovery_dest_stats(aodv_discovery_dest_stats_t** entries_out, uint32_t* count_out) {
+    uint32_t pos = 0;
+    uint32_t i = 0;
+    void* value;
+
+    pthread_mutex_lock(&stats_mutex);
+    uint32_t count = hashmap_count(&dest_stats);
+    aodv_discovery_dest_stats_t* entries = malloc((count ? count : 1) * sizeof(*entries));
+
+    if(!entries) {
+        pthread_mutex_unlock(&stats_mutex);
+        return false;
+    }
+
+    while(hashmap_next(&dest_stats, &pos, NULL, &value)) {
+        entries[i++] = *(aodv_discovery_dest_stats_t*) value;
+    }
+    pthread_mutex_unlock(&stats_mutex);
+
+    *entries_out = entries;
+    *count_out = i;
+    return true;
+}
+
+void aodv_discovery_stats_reset() {
+    uint32_t pos = 0;
+    void* value;
+
+    pthread_mutex_lock(&stats_mutex);
+    while(hashmap_next(&dest_stats, &pos, NULL, &value)) {
+        free(value);
+    }
+    hashmap_destroy(&dest_stats);
+    hashmap_init(&dest_stats);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+// ---------------------------- engine ---------------------------------------
+
+static void aodv_discovery_stop(uint64_t key, aodv_discovery_t* discovery) {
+    uint64_t* hint = aodv_discovery_hint(key);
+
+    if(*hint == key) {
+        __atomic_store_n(hint, UINT64_MAX, __ATOMIC_RELAXED);
+    }
+
+    hashmap_del(&discoveries, key);
+    dessert_msg_destroy(discovery->msg);
+    free(discovery);
+}
+
+static void aodv_discovery_retry_at(struct timeval* when, mac_addr dest, aodv_discovery_t* discovery) {
+    if(!aodv_db_addschedule(when, dest, AODV_SC_REPEAT_RREQ, (void*) discovery->id)) {
+        dessert_warn("could not schedule RREQ retry to " MAC ", giving up", EXPLODE_ARRAY6(dest));
+        aodv_discovery_count(dest, discovery, false, 0);
+        aodv_discovery_stop(hf_mac_addr_to_uint64(dest), discovery);
+    }
+}
+
+static void aodv_discovery_send(mac_addr dest, aodv_discovery_t* discovery) {
+    struct timeval ts;
+    gettimeofday(&ts, NULL);
+    dessert_msg_t* msg = discovery->msg;
+
+    // if we sent too many RREQs in the last second, try again later
+    if(!aodv_ratelimit_msg(AODV_RATE_RREQ_ORIGINATE, msg, &ts)) {
+        dessert_trace("we have reached RREQ_RATELIMIT");
+        struct timeval postpone = hf_tv_add_ms(ts, 20);
+        aodv_discovery_retry_at(&postpone, dest, discovery);
+        return;
+    }
+
+    dessert_ext_t* ext;
+    dessert_msg_getext(msg, &ext, RREQ_EXT_TYPE, 0);
+    struct aodv_msg_rreq* rreq = (struct aodv_msg_rreq*) ext->data;
+    rreq->originator_sequence_number = aodv_pipeline_next_seq_num();
+
+    dessert_debug("sending RREQ to " MAC " ttl=%ju id=%ju", EXPLODE_ARRAY6(dest), (uintmax_t)msg->ttl, (uintmax_t)rreq->originator_sequence_number);
+    dessert_meshsend(msg, NULL);
+    gettimeofday(&ts, NULL);
+    discovery->sent++;
+    discovery->sent_ttl = msg->ttl;
+
+    /* RING_TRAVERSAL_TIME equals NET_TRAVERSAL_TIME if ring_search is off */
+    uintmax_t ring_traversal_time = 2 * NODE_TRAVERSAL_TIME * min(NET_DIAMETER, msg->ttl);
+    struct timeval repeat_time = hf_tv_add_ms(ts, ring_traversal_time);
+
+    if(discovery->retries >= RREQ_RETRIES) {
+        /* RREQ has been tried for the max. number of times -- give up once
+         * the last one had the time to come back */
+        discovery->exhausted = true;
+        aodv_discovery_retry_at(&repeat_time, dest, discovery);
+        return;
+    }
+    dessert_trace("add task to repeat RREQ");
+
+    discovery->retries++;
+    if(ring_search && msg->ttl <= TTL_THRESHOLD) {
+        msg->ttl += TTL_INCREMENT;
+        if(msg->ttl > TTL_THRESHOLD) {
+            msg->ttl = TTL_MAX;
+        }
+    }
+    aodv_discovery_retry_at(&repeat_time, dest, discovery);
+}
+
+static void aodv_discovery_handle_start(mac_addr dest, uint64_t posted_us) {
+    uint64_t key = hf_mac_addr_to_uint64(dest);
+
+    if(hashmap_find(&discoveries, key)) {
+        dessert_trace("There is a rreq schedule to this dest. We dont start a new series.");
+        return;
+    }
+
+    aodv_discovery_t* discovery = malloc(sizeof(*discovery));
+
+    if(discovery == NULL) {
+        return;
+    }
+
+    // RFC uses NET_DIAMETER as maximum ttl value, but we don't need ttl for loop detection
+    uint8_t ttl = ring_search ? TTL_START : TTL_MAX;
+    discovery->msg = _create_rreq(dest, ttl, metric_startvalue);
+    discovery->retries = 0;
+    discovery->id = ++discovery_id;
+    discovery->started_us = posted_us;
+    discovery->sent = 0;
+    discovery->sent_ttl = 0;
+    discovery->exhausted = false;
+
+    if(!hashmap_add(&discoveries, key, discovery)) {
+        dessert_msg_destroy(discovery->msg);
+        free(discovery);
+        return;
+    }
+
+    uint64_t* hint = aodv_discovery_hint(key);
+
+    if(*hint == UINT64_MAX) {
+        __atomic_store_n(hint, key, __ATOMIC_RELAXED);
+    }
+
+    aodv_discovery_send(dest, discovery);
+}
+
+static void aodv_discovery_handle(aodv_discovery_cmd_t* cmd) {
+    aodv_discovery_t* discovery;
+
+    switch(cmd->type) {
+        case AODV_DISCOVERY_START: {
+            aodv_discovery_handle_start(cmd->dest, cmd->posted_us);
+            break;
+        }
+        case AODV_DISCOVERY_FOUND: {
+            // drop RREQ schedule, since we already know the route to destination
+            discovery = hashmap_find(&discoveries, hf_mac_addr_to_uint64(cmd->dest));
+
+            if(discovery) {
+                aodv_db_dropschedule(cmd->dest, AODV_SC_REPEAT_RREQ);
+                aodv_discovery_count(cmd->dest, discovery, true, cmd->posted_us);
+                aodv_discovery_stop(hf_mac_addr_to_uint64(cmd->dest), discovery);
+            }
+            break;
+        }
+        case AODV_DISCOVERY_RETRY: {
+            discovery = hashmap_find(&discoveries, hf_mac_addr_to_uint64(cmd->dest));
+
+            if(discovery && discovery->id == cmd->id) {
+                if(discovery->exhausted) {
+                    aodv_discovery_count(cmd->dest, discovery, false, 0);
+                    aodv_discovery_stop(hf_mac_addr_to_uint64(cmd->dest), discovery);
+                }
+                else {
+                    aodv_discovery_send(cmd->dest, discovery);
+                }
+            }
+            break;
+        }
+        default: {
+            dessert_crit("unknown discovery command=%" PRIu8 "", cmd->type);
+        }
+    }
+}
+
+void aodv_discovery_run_pending() {
+    aodv_discovery_cmd_t* cmds = __atomic_exchange_n(&cmd_head, NULL, __ATOMIC_ACQUIRE);
+    aodv_discovery_cmd_t* fifo = NULL;
+
+    // the stack holds the newest command first
+    while(cmds) {
+        aodv_discovery_cmd_t* cmd = cmds;
+        cmds = cmd->next;
+        cmd->next = fifo;
+        fifo = cmd;
+    }
+
+    while(fifo) {
+        aodv_discovery_cmd_t* cmd = fifo;
+        fifo = cmd->next;
+        aodv_discovery_handle(cmd);
+        free(cmd);
+    }
+}
+
+static void* aodv_discovery_loop(void* arg __attribute__((unused))) {
+    while(true) {
+        uint64_t signals;
+
+        if(read(cmd_fd, &signals, sizeof(signals)) < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            dessert_crit("discovery engine stopped: %s", strerror(errno));
+            break;
+        }
+
+        aodv_discovery_run_pending();
+    }
+
+    return NULL;
+}
+
+void aodv_discovery_init_external() {
+    hashmap_init(&discoveries);
+    hashmap_init(&dest_stats);
+}
+
+int aodv_discovery_init() {
+    aodv_discovery_init_external();
+
+    int fd = eventfd(0, EFD_CLOEXEC);
+
+    if(fd < 0) {
+        dessert_crit("could not create eventfd: %s", strerror(errno));
+        return false;
+    }
+
+    // process commands posted before the engine was up
+    uint64_t one = 1;
+
+    if(write(fd, &one, sizeof(one)) < 0) {
+        dessert_warn("could not signal discovery engine: %s", strerror(errno));
+    }
+
+    __atomic_store_n(&cmd_fd, fd, __ATOMIC_RELEASE);
+
+    if(pthread_create(&discovery_thread, NULL, aodv_discovery_loop, NULL) != 0) {
+        dessert_crit("could not start discovery thread");
+        return false;
+    }
+
+    pthread_detach(discovery_thread);
+    return true;
+}
@@ -0,0 +1,94 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#ifndef AODV_DISCOVERY
+#define AODV_DISCOVERY
+
+#include <stdint.h>
+#include <dessert.h>
+#include "aodv_histogram.h"
+#include "../config.h"
+
+/**
+ * Route discovery engine. One thread owns every running series of RREQs:
+ * retries, ring search and rate limiting of originated RREQs happen only
+ * there. Other threads talk to it through a lock-free command queue, so
+ * posting a command never blocks on discovery state. Retries are planned in
+ * the schedule table, which hands them back as AODV_SC_REPEAT_RREQ.
+ */
+
+/** start the engine thread; commands posted before are processed then */
+int aodv_discovery_init();
+
+/**
+ * Set up the engine without its thread, e.g. for a simulation. Commands are
+ * only processed by aodv_discovery_run_pending then.
+ */
+void aodv_discovery_init_external();
+
+/** process all posted commands in the calling thread */
+void aodv_discovery_run_pending();
+
+/** discover a route to dest unless a discovery to dest is running already */
+void aodv_discovery_start(mac_addr dest);
+
+/** a route to dest was found, stop a running discovery */
+void aodv_discovery_found(mac_addr dest);
+
+/** the retry timer of discovery id to dest fired; ignored if it was stopped meanwhile */
+void aodv_discovery_retry(mac_addr dest, uintptr_t id);
+
+/**
+ * Results of finished discoveries. A discovery succeeds when a route to its
+ * destination is found and fails when the last RREQ stays unanswered; its
+ * latency runs from the first packet that asked for it to the route.
+ */
+typedef struct aodv_discovery_stats {
+    uint64_t succeeded;
+    uint64_t failed;
+    uint64_t retries[RREQ_RETRIES + 1]; // finished discoveries by retries
+    uint64_t ttl[UINT8_MAX + 1]; // successful discoveries by TTL of the last RREQ
+    aodv_hist_t latency_us; // successful discoveries only
+} aodv_discovery_stats_t;
+
+typedef struct aodv_discovery_dest_stats {
+    mac_addr dest;
+    uint32_t succeeded;
+    uint32_t failed;
+    uint32_t retries; // of all finished discoveries
+    uint8_t ttl_last; // of the last successful discovery
+    uint64_t latency_sum_us;
+    uint64_t latency_min_us;
+    uint64_t latency_max_us;
+    uint64_t latency_last_us;
+} aodv_discovery_dest_stats_t;
+
+void aodv_discovery_stats(aodv_discovery_stats_t* stats_out);
+
+/** copy of the results per destination (up to DISCOVERY_STATS_DESTS), entries_out must be freed */
+int aodv_discovery_dest_stats(aodv_discovery_dest_stats_t** entries_out, uint32_t* count_out);
+
+void aodv_discovery_stats_reset();
+
+#endif
@@ -26,37 +26,95 @@ For further information and questions please use the web site
 #include <utlist.h>
 #include "../database/aodv_database.h"
 #include "aodv_pipeline.h"
+#include "aodv_ratelimit.h"
+#include "aodv_discovery.h"
+#include "aodv_stats.h"
 #include "../config.h"
 #include "../helper.h"
 
-uint16_t data_seq_global = 0;
-pthread_rwlock_t data_seq_lock = PTHREAD_RWLOCK_INITIALIZER;
+uint16_t data_seq_global = 0; // only changed with atomic adds
+
+/**
+ * Per-thread direct mapped cache of recently used routes. An entry is valid
+ * as long as the route generation it was filled with is current, so hits
+ * take no lock and only read the shared generation counter. Hits do not
+ * record the use of the route, so entries are looked up in the database
+ * again after FWD_CACHE_REFRESH to keep the route alive.
+ */
+typedef struct aodv_fwd_cache_entry {
+    uint64_t            dhost; // as returned by hf_mac_addr_to_uint64
+    uint64_t            generation;
+    uint64_t            refreshed; // ms
+    mac_addr            next_hop;
+    uint8_t             flags; // flags the route is known to carry
+    dessert_meshif_t*   output_iface;
+} aodv_fwd_cache_entry_t;
+
+static __thread aodv_fwd_cache_entry_t fwd_cache[FWD_CACHE_SLOTS];
+
+static int aodv_forward_getroute(mac_addr dhost_ether, mac_addr next_hop_out, dessert_meshif_t** output_iface_out, struct timeval* timestamp, uint8_t flags) {
+    uint64_t key = hf_mac_addr_to_uint64(dhost_ether);
+    aodv_fwd_cache_entry_t* entry = &fwd_cache[((key * UINT64_C(0x9E3779B97F4A7C15)) >> 48) & (FWD_CACHE_SLOTS - 1)];
+    uint64_t now = hf_tv_to_ms(timestamp);
+
+    // read before the lookup: a route changing in between leaves the entry stale right away
+    uint64_t generation = aodv_db_route_generation();
+
+    if(entry->dhost == key && entry->generation == generation
+       && (entry->flags & flags) == flags && now < entry->refreshed + FWD_CACHE_REFRESH) {
+        mac_copy(next_hop_out, entry->next_hop);
+        *output_iface_out = entry->output_iface;
+        return true;
+    }
+
+    if(!aodv_db_getroute2dest(dhost_ether, next_hop_out, output_iface_out, timestamp, flags)) {
+        entry->generation = 0;
+        return false;
+    }
+
+    entry->dhost = key;
+    entry->generation = generation;
+    entry->refreshed = now;
+    entry->flags = flags;
+    mac_copy(entry->next_hop, next_hop_out);
+    entry->output_iface = *output_iface_out;
+    return true;
+}
 
 void aodv_send_packets_from_buffer(mac_addr ether_dhost, mac_addr next_hop, dessert_meshif_t* iface) {
     // drop RREQ schedule, since we already know the route to destination
-    aodv_pipeline_delete_series_ether(ether_dhost);
+    aodv_discovery_found(ether_dhost);
 
     dessert_debug("new route to " MAC " over " MAC " found -> send out packet from buffer", EXPLODE_ARRAY6(ether_dhost), EXPLODE_ARRAY6(next_hop));
 
     // send out packets from buffer
-    dessert_msg_t* buffered_msg;
+    aodv_pb_batch_t batch;
 
-    while((buffered_msg = aodv_db_pop_packet(ether_dhost)) != NULL) {
+    if(!aodv_db_pop_packets(ether_dhost, &batch)) {
+        return;
+    }
+
+    // reserve the sequence numbers of the whole batch at once
+    uint16_t data_seq_first = __atomic_fetch_add(&data_seq_global, (uint16_t) batch.count, __ATOMIC_RELAXED) + 1;
+    uint32_t i;
+
+    for(i = 0; i < batch.count; ++i) {
+        dessert_msg_t* buffered_msg = batch.msgs[(batch.head + i) % batch.capacity];
         struct ether_header* l25h = dessert_msg_getl25ether(buffered_msg);
-        uint16_t data_seq_copy = 0;
-        pthread_rwlock_wrlock(&data_seq_lock);
-        data_seq_copy = ++data_seq_global;
-        pthread_rwlock_unlock(&data_seq_lock);
+        uint16_t data_seq_copy = data_seq_first + i;
         buffered_msg->u16 = data_seq_copy;
 
         /*  no need to search for next hop. Next hop is the last_hop that send RREP */
         mac_copy(buffered_msg->l2h.ether_dhost, next_hop);
         dessert_meshsend(buffered_msg, iface);
+        aodv_stats_data(AODV_DATA_ORIGINATED);
 
         dessert_trace("data packet - id=%" PRIu16 " - to mesh - to " MAC " route is known - send over " MAC, data_seq_copy, EXPLODE_ARRAY6(l25h->ether_dhost), EXPLODE_ARRAY6(next_hop));
 
         dessert_msg_destroy(buffered_msg);
     }
+
+    free(batch.msgs);
 }
 
 int aodv_forward_broadcast(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_meshif_t* iface, dessert_frameid_t id) {
@@ -65,6 +123,7 @@ int aodv_forward_broadcast(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t*
 
         if(msg->ttl <= 0) {
             dessert_trace("got data from " MAC " but TTL is <= 0", EXPLODE_ARRAY6(l25h->ether_dhost));
+            aodv_stats_drop(AODV_DROP_TTL);
             return DESSERT_MSG_DROP;
         }
 
@@ -77,12 +136,14 @@ int aodv_forward_broadcast(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t*
 
         if(false == aodv_db_capt_data_seq(l25h->ether_shost, msg->u16, msg->u8, &timestamp)) {
             dessert_trace("data packet is known -> DUP");
+            aodv_stats_drop(AODV_DROP_DUPLICATE);
             return DESSERT_MSG_DROP;
         }
 
         dessert_trace("got BROADCAST from " MAC " over " MAC, EXPLODE_ARRAY6(l25h->ether_shost), EXPLODE_ARRAY6(msg->l2h.ether_shost));
         dessert_meshsend(msg, NULL); //forward to mesh
         dessert_syssend_msg(msg); //forward to sys
+        aodv_stats_data(AODV_DATA_BROADCAST);
         return DESSERT_MSG_DROP;
     }
 
@@ -93,6 +154,7 @@ int aodv_forward_multicast(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t*
     if(proc->lflags & DESSERT_RX_FLAG_L25_MULTICAST) {
         // dessert_meshsend(msg, NULL); //forward to mesh
         // dessert_syssend_msg(msg); //forward to sys
+        aodv_stats_drop(AODV_DROP_MULTICAST);
         return DESSERT_MSG_DROP;
     }
 
@@ -115,6 +177,7 @@ int aodv_forward(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, des
 
     if(msg->ttl <= 0) {
         dessert_trace("got data from " MAC " but TTL is <= 0", EXPLODE_ARRAY6(l25h->ether_dhost));
+        aodv_stats_drop(AODV_DROP_TTL);
         return DESSERT_MSG_DROP;
     }
 
@@ -123,16 +186,18 @@ int aodv_forward(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, des
 
     if(false == aodv_db_capt_data_seq(l25h->ether_shost, msg->u16, msg->u8, &timestamp)) {
         dessert_trace("data packet is known -> DUP");
+        aodv_stats_drop(AODV_DROP_DUPLICATE);
         return DESSERT_MSG_DROP;
     }
 
     dessert_meshif_t* output_iface;
     mac_addr next_hop;
 
-    if(aodv_db_getroute2dest(l25h->ether_dhost, next_hop, &output_iface, &timestamp, AODV_FLAGS_UNUSED)) {
+    if(aodv_forward_getroute(l25h->ether_dhost, next_hop, &output_iface, &timestamp, AODV_FLAGS_UNUSED)) {
         mac_copy(msg->l2h.ether_dhost, next_hop);
 
         dessert_meshsend(msg, output_iface);
+        aodv_stats_data(AODV_DATA_FORWARDED);
         dessert_trace(MAC " over " MAC " ----ME----> " MAC " to " MAC,
                       EXPLODE_ARRAY6(l25h->ether_shost),
                       EXPLODE_ARRAY6(msg->l2h.ether_shost),
@@ -140,14 +205,8 @@ int aodv_forward(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, des
                       EXPLODE_ARRAY6(l25h->ether_dhost));
     }
     else {
-        uint32_t rerr_count;
-        aodv_db_getrerrcount(&timestamp, &rerr_count);
-
-        if(rerr_count >= RERR_RATELIMIT) {
-            return DESSERT_MSG_DROP;
-        }
-
         // route unknown -> send rerr towards source
+        aodv_stats_drop(AODV_DROP_NO_ROUTE);
         aodv_link_break_element_t* head = NULL;
         aodv_link_break_element_t* entry = malloc(sizeof(aodv_link_break_element_t));
         memset(entry, 0x0, sizeof(aodv_link_break_element_t));
@@ -157,9 +216,10 @@ int aodv_forward(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, des
         dessert_msg_t* rerr_msg = aodv_create_rerr(&head);
 
         if(rerr_msg != NULL) {
-            dessert_meshsend(rerr_msg, NULL);
+            if(aodv_ratelimit_msg(AODV_RATE_RERR, rerr_msg, &timestamp)) {
+                dessert_meshsend(rerr_msg, NULL);
+            }
             dessert_msg_destroy(rerr_msg);
-            aodv_db_putrerr(&timestamp);
         }
 
         dessert_trace(MAC " over " MAC " ----XXX----> " MAC " to " MAC,
@@ -190,6 +250,7 @@ int aodv_sys_drop_multicast(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t
 
     if(proc->lflags & DESSERT_RX_FLAG_L25_MULTICAST) {
         dessert_debug("dropped Multicast packet in Ethernet frame");
+        aodv_stats_drop(AODV_DROP_MULTICAST);
         return DESSERT_MSG_DROP;
     }
 
@@ -203,32 +264,31 @@ int aodv_sys2rp(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dess
     msg->u8 = 0; /*hop count */
 
     if(mac_equal(l25h->ether_dhost, ether_broadcast)) {
-        pthread_rwlock_wrlock(&data_seq_lock);
-        msg->u16 = ++data_seq_global;
-        pthread_rwlock_unlock(&data_seq_lock);
+        msg->u16 = __atomic_add_fetch(&data_seq_global, 1, __ATOMIC_RELAXED);
 
         dessert_meshsend(msg, NULL);
+        aodv_stats_data(AODV_DATA_ORIGINATED);
     }
     else {
         mac_addr dhost_next_hop;
         dessert_meshif_t* output_iface;
         struct timeval ts;
         gettimeofday(&ts, NULL);
-        int a = aodv_db_getroute2dest(l25h->ether_dhost, dhost_next_hop, &output_iface, &ts, AODV_FLAGS_ROUTE_LOCAL_USED);
+        int a = aodv_forward_getroute(l25h->ether_dhost, dhost_next_hop, &output_iface, &ts, AODV_FLAGS_ROUTE_LOCAL_USED);
 
         if(a == true) {
-            pthread_rwlock_wrlock(&data_seq_lock);
-            msg->u16 = ++data_seq_global;
-            pthread_rwlock_unlock(&data_seq_lock);
+            msg->u16 = __atomic_add_fetch(&data_seq_global, 1, __ATOMIC_RELAXED);
 
             mac_copy(msg->l2h.ether_dhost, dhost_next_hop);
             dessert_meshsend(msg, output_iface);
+            aodv_stats_data(AODV_DATA_ORIGINATED);
 
             dessert_trace("send data packet to mesh - to " MAC " over " MAC " id=%" PRIu16 " route is known", EXPLODE_ARRAY6(l25h->ether_dhost), EXPLODE_ARRAY6(dhost_next_hop), msg->u16);
         }
         else {
             aodv_db_push_packet(l25h->ether_dhost, msg, &ts);
-            aodv_send_rreq(l25h->ether_dhost, &ts); // create and send RREQ - without initial metric
+            aodv_stats_data(AODV_DATA_BUFFERED);
+            aodv_discovery_start(l25h->ether_dhost); // create and send RREQ - without initial metric
             dessert_trace("try to send data packet to mesh - to " MAC ", but route is unknown -> push packet to FIFO and send RREQ", EXPLODE_ARRAY6(l25h->ether_dhost));
         }
     }
@@ -250,6 +310,7 @@ int aodv_local_unicast(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* pro
 
         if(msg->ttl <= 0) {
             dessert_trace("got data from " MAC " but TTL is <= 0", EXPLODE_ARRAY6(l25h->ether_dhost));
+            aodv_stats_drop(AODV_DROP_TTL);
             return DESSERT_MSG_DROP;
         }
 
@@ -258,11 +319,13 @@ int aodv_local_unicast(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* pro
 
         if(false == aodv_db_capt_data_seq(l25h->ether_shost, msg->u16, msg->u8, &timestamp)) {
             dessert_trace("data packet is known -> DUP");
+            aodv_stats_drop(AODV_DROP_DUPLICATE);
             return DESSERT_MSG_DROP;
         }
 
         dessert_debug("got UNICAST from " MAC " over " MAC " hop_count=% " PRIu8 "", EXPLODE_ARRAY6(l25h->ether_shost), EXPLODE_ARRAY6(msg->l2h.ether_shost), msg->u8);
         dessert_syssend_msg(msg);
+        aodv_stats_data(AODV_DATA_DELIVERED);
     }
 
     return DESSERT_MSG_DROP;
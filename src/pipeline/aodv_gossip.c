@@ -24,77 +24,137 @@ For further information and questions please use the web site
 #include "../config.h"
 #include "../helper.h"
 #include "aodv_pipeline.h"
+#include "aodv_timer.h"
+#include "aodv_ratelimit.h"
+#include "../database/hashmap.h"
+#include "../database/lockstat.h"
 
 #include <dessert.h>
 #include <pthread.h>
 #include <utlist.h>
 
+/*
+ * RREQs held back by GOSSIP_3, one per (originator, destination). The entries
+ * are found through hold_queue_map and expire in the order of hold_queue:
+ * every entry is held for the same time and keeps its timeout when it is
+ * replaced, so the list stays sorted by timeout and its head is due first.
+ */
 typedef struct hold_queue {
     struct timeval timeout;
     dessert_msg_t *msg;
+    mac_addr shost;
+    mac_addr dhost;
     struct hold_queue *prev, *next;
+    struct hold_queue *chain; // other entries with the same key in hold_queue_map
     int quantity;
 } hold_queue_t;
 
 typedef struct hold_queue hold_queue_elem_t;
 
 static pthread_mutex_t hold_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
-static dessert_periodic_t *hold_queue_periodic = NULL;
 static hold_queue_t *hold_queue = NULL;
+static hashmap_t hold_queue_map; // hold_queue_key -> hold_queue_elem_t, zeroed map is empty
 
 int aodv_gossip_0(){
     return (random() < (((long double) gossip_p)*((long double) RAND_MAX)));
 }
 
-dessert_per_result_t aodv_gossip_3(void *data __attribute__((unused)),
-                                   struct timeval *scheduled,
-                                   struct timeval *interval __attribute__((unused))) {
-     pthread_mutex_lock(&hold_queue_mutex);
+static uint64_t hold_queue_key(mac_addr shost, mac_addr dhost) {
+    uint64_t key = hf_mac_addr_to_uint64(shost) * UINT64_C(0x9E3779B97F4A7C15) ^ hf_mac_addr_to_uint64(dhost);
+    return key >> 1; // never one of the reserved keys of the map
+}
+
+//hold_queue_mutex must be locked
+static hold_queue_elem_t *aodv_gossip_hold_queue_search(dessert_msg_t *msg) {
+    struct ether_header* l25h = dessert_msg_getl25ether(msg);
+    hold_queue_elem_t *elem = hashmap_find(&hold_queue_map, hold_queue_key(l25h->ether_shost, l25h->ether_dhost));
+
+    while(elem) {
+        if(mac_equal(l25h->ether_shost, elem->shost) && mac_equal(l25h->ether_dhost, elem->dhost)) {
+            return elem;
+        }
+        elem = elem->chain;
+    }
+    return NULL;
+}
+
+//hold_queue_mutex must be locked; the caller owns el afterwards
+static void aodv_gossip_hold_queue_unlink(hold_queue_elem_t *el) {
+    uint64_t key = hold_queue_key(el->shost, el->dhost);
+    hold_queue_elem_t *head = hashmap_find(&hold_queue_map, key);
+
+    if(head == el) {
+        if(el->chain) {
+            hashmap_add(&hold_queue_map, key, el->chain); // replaces, never allocates
+        }
+        else {
+            hashmap_del(&hold_queue_map, key);
+        }
+    }
+    else {
+        while(head->chain != el) {
+            head = head->chain;
+        }
+        head->chain = el->chain;
+    }
+
+    DL_DELETE(hold_queue, el);
+}
+
+//hold_queue_mutex must be locked
+static void aodv_gossip_hold_queue_remove(hold_queue_elem_t *el) {
+    aodv_gossip_hold_queue_unlink(el);
+    dessert_msg_destroy(el->msg);
+    free(el);
+}
+
+void aodv_gossip_hold_queue_flush(struct timeval *scheduled) {
+     lockstat_mutex_lock(&hold_queue_mutex, "hold_queue_mutex");
      while(hold_queue) {
         hold_queue_elem_t *head = hold_queue;
         if(dessert_timevalcmp(&head->timeout, scheduled) > 0) {
             break;
         }
 
-        DL_DELETE(hold_queue, head);
+        // neighbors have forwarded this RREQ often enough already
         if(head->quantity >= 2) {
+            aodv_gossip_hold_queue_remove(head);
             continue;
         }
 
+        aodv_gossip_hold_queue_unlink(head);
+
         //temporarily unlock while sending packet
-        pthread_mutex_unlock(&hold_queue_mutex);
+        lockstat_mutex_unlock(&hold_queue_mutex);
         dessert_ext_t* rreq_ext;
         dessert_msg_getext(head->msg, &rreq_ext, RREQ_EXT_TYPE, 0);
         struct aodv_msg_rreq* rreq_msg = (struct aodv_msg_rreq*) rreq_ext->data;
         struct ether_header* l25h = dessert_msg_getl25ether(head->msg);
 
-        dessert_debug("incoming RREQ from " MAC " over " MAC " to " MAC " seq=%ju ttl=%ju | %s", EXPLODE_ARRAY6(l25h->ether_shost), EXPLODE_ARRAY6(head->msg->l2h.ether_shost), EXPLODE_ARRAY6(l25h->ether_dhost), (uintmax_t)rreq_msg->originator_sequence_number, (uintmax_t)head->msg->ttl, "send finally (GOSSIP_3)");
-        dessert_meshsend(head->msg, NULL);
-        pthread_mutex_lock(&hold_queue_mutex);
-    }
+        int allowed = aodv_ratelimit_msg(AODV_RATE_RREQ_FORWARD, head->msg, scheduled);
 
-    if(!hold_queue) {
-        //returning DESSERT_PER_UNREGISTER would delete the periodic _after_ unlocking the mutex
-        dessert_periodic_del(hold_queue_periodic);
-        hold_queue_periodic = NULL;
+        dessert_debug("incoming RREQ from " MAC " over " MAC " to " MAC " seq=%ju ttl=%ju | %s", EXPLODE_ARRAY6(l25h->ether_shost), EXPLODE_ARRAY6(head->msg->l2h.ether_shost), EXPLODE_ARRAY6(l25h->ether_dhost), (uintmax_t)rreq_msg->originator_sequence_number, (uintmax_t)head->msg->ttl, allowed ? "send finally (GOSSIP_3)" : "dropped (rate limit)");
+        if(allowed) {
+            dessert_meshsend(head->msg, NULL);
+        }
+        dessert_msg_destroy(head->msg);
+        free(head);
+        lockstat_mutex_lock(&hold_queue_mutex, "hold_queue_mutex");
     }
 
-    pthread_mutex_unlock(&hold_queue_mutex);
-    return DESSERT_PER_KEEP;
+    lockstat_mutex_unlock(&hold_queue_mutex);
 }
 
-//hold_queue_mutex must be locked
-static hold_queue_elem_t *aodv_gossip_hold_queue_search(dessert_msg_t *msg) {
-    struct ether_header* search_l25h = dessert_msg_getl25ether(msg);
-    hold_queue_elem_t *elem;
-    DL_FOREACH(hold_queue, elem) {
-        struct ether_header* l25h = dessert_msg_getl25ether(elem->msg);
-        bool same = mac_equal(search_l25h->ether_shost, l25h->ether_shost) && mac_equal(search_l25h->ether_dhost, l25h->ether_dhost);
-        if(same) {
-            return elem;
-        }
+int aodv_gossip_hold_queue_next(struct timeval *next_out) {
+    lockstat_mutex_lock(&hold_queue_mutex, "hold_queue_mutex");
+    int result = (hold_queue != NULL);
+
+    if(result) {
+        *next_out = hold_queue->timeout;
     }
-    return NULL;
+
+    lockstat_mutex_unlock(&hold_queue_mutex);
+    return result;
 }
 
 //hold_queue_mutex must be locked
@@ -102,39 +162,55 @@ static void aodv_gossip_hold_queue_add(dessert_msg_t *msg) {
     hold_queue_elem_t *el = aodv_gossip_hold_queue_search(msg);
 
     if(!el) {
-        hold_queue_elem_t *el = malloc(sizeof(*el));
+        el = malloc(sizeof(*el));
+
+        if(el == NULL) {
+            return;
+        }
+
+        struct ether_header* l25h = dessert_msg_getl25ether(msg);
+        mac_copy(el->shost, l25h->ether_shost);
+        mac_copy(el->dhost, l25h->ether_dhost);
+        uint64_t key = hold_queue_key(el->shost, el->dhost);
+        el->chain = hashmap_find(&hold_queue_map, key);
+
+        if(!hashmap_add(&hold_queue_map, key, el)) {
+            free(el);
+            return;
+        }
+
         gettimeofday(&el->timeout, NULL);
         struct timeval hold_queue_duration;
         dessert_ms2timeval(3 * NODE_TRAVERSAL_TIME, &hold_queue_duration);
         dessert_timevaladd2(&el->timeout, &el->timeout, &hold_queue_duration);
-        DL_APPEND(hold_queue, el);
         el->quantity = 1;
+
+        // only a new head is earlier than the deadline the timer engine already knows
+        bool first = (hold_queue == NULL);
+        DL_APPEND(hold_queue, el);
+        if(first) {
+            aodv_timer_wakeup(&el->timeout);
+        }
     }
     else {
         dessert_msg_destroy(el->msg);
     }
     dessert_msg_clone(&el->msg, msg, false);
-    if(!hold_queue_periodic) {
-        struct timeval hold_queue_poll_interval;
-        dessert_ms2timeval(NODE_TRAVERSAL_TIME, &hold_queue_poll_interval);
-        dessert_periodic_add(aodv_gossip_3, NULL, NULL, &hold_queue_poll_interval);
-    }
 }
 
 //hold_queue_mutex must be locked
 static void aodv_gossip_hold_queue_drop(dessert_msg_t *msg) {
     hold_queue_elem_t *el = aodv_gossip_hold_queue_search(msg);
     if(el) {
-        DL_DELETE(hold_queue, el);
-        dessert_msg_destroy(el->msg);
+        aodv_gossip_hold_queue_remove(el);
     }
 }
 
 void aodv_gossip_capt_rreq(dessert_msg_t *msg) {
-    pthread_mutex_lock(&hold_queue_mutex);
+    lockstat_mutex_lock(&hold_queue_mutex, "hold_queue_mutex");
     hold_queue_elem_t *el = aodv_gossip_hold_queue_search(msg);
     if(!el) {
-        pthread_mutex_unlock(&hold_queue_mutex);
+        lockstat_mutex_unlock(&hold_queue_mutex);
         return;
     }
 
@@ -147,14 +223,13 @@ void aodv_gossip_capt_rreq(dessert_msg_t *msg) {
     int cmp_result = hf_comp_u32(held_rreq->originator_sequence_number, capt_rreq->originator_sequence_number);
     if(cmp_result > 0) {
         //captured request is newer, delete this held msg
-        DL_DELETE(hold_queue, el);
-        dessert_msg_destroy(el->msg);
+        aodv_gossip_hold_queue_remove(el);
     }
     else if(cmp_result == 0) {
         el->quantity += 1;
     }
 
-    pthread_mutex_unlock(&hold_queue_mutex);
+    lockstat_mutex_unlock(&hold_queue_mutex);
 }
 
 int aodv_gossip(dessert_msg_t* msg){
@@ -168,15 +243,15 @@ int aodv_gossip(dessert_msg_t* msg){
             return (msg->u8 <= 1) || aodv_gossip_0();
         case GOSSIP_3: {
             if(aodv_gossip_0()) {
-                pthread_mutex_lock(&hold_queue_mutex);
+                lockstat_mutex_lock(&hold_queue_mutex, "hold_queue_mutex");
                 aodv_gossip_hold_queue_drop(msg);
-                pthread_mutex_unlock(&hold_queue_mutex);
+                lockstat_mutex_unlock(&hold_queue_mutex);
                 return true;
             }
             else {
-                pthread_mutex_lock(&hold_queue_mutex);
+                lockstat_mutex_lock(&hold_queue_mutex, "hold_queue_mutex");
                 aodv_gossip_hold_queue_add(msg);
-                pthread_mutex_unlock(&hold_queue_mutex);
+                lockstat_mutex_unlock(&hold_queue_mutex);
                 return false;
             }
         }
@@ -0,0 +1,102 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include <string.h>
+#include "aodv_histogram.h"
+
+void aodv_hist_read(aodv_hist_t* hist, aodv_hist_t* copy_out) {
+    uint32_t i;
+
+    copy_out->count = 0;
+    for(i = 0; i < AODV_HIST_BUCKETS; ++i) {
+        copy_out->buckets[i] = __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        // count the buckets, so that percentiles stay consistent with them
+        copy_out->count += copy_out->buckets[i];
+    }
+
+    copy_out->sum = __atomic_load_n(&hist->sum, __ATOMIC_RELAXED);
+    copy_out->max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+}
+
+void aodv_hist_clear(aodv_hist_t* hist) {
+    uint32_t i;
+
+    for(i = 0; i < AODV_HIST_BUCKETS; ++i) {
+        __atomic_store_n(&hist->buckets[i], 0, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&hist->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->sum, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->max, 0, __ATOMIC_RELAXED);
+}
+
+void aodv_hist_merge(aodv_hist_t* hist, const aodv_hist_t* other) {
+    uint32_t i;
+
+    for(i = 0; i < AODV_HIST_BUCKETS; ++i) {
+        hist->buckets[i] += other->buckets[i];
+    }
+
+    hist->count += other->count;
+    hist->sum += other->sum;
+    if(other->max > hist->max) {
+        hist->max = other->max;
+    }
+}
+
+static uint64_t aodv_hist_bucket_upper(uint32_t bucket) {
+    if(bucket < AODV_HIST_SUB) {
+        return bucket;
+    }
+
+    uint32_t shift = bucket / AODV_HIST_SUB - 1;
+    uint64_t lower = (uint64_t) (AODV_HIST_SUB + bucket % AODV_HIST_SUB) << shift;
+    return lower + ((uint64_t) 1 << shift) - 1;
+}
+
+uint64_t aodv_hist_percentile(const aodv_hist_t* hist, double q) {
+    if(hist->count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t) (q * hist->count + 0.999999);
+    uint64_t seen = 0;
+    uint32_t i;
+
+    if(rank == 0) {
+        rank = 1;
+    }
+
+    for(i = 0; i < AODV_HIST_BUCKETS; ++i) {
+        seen += hist->buckets[i];
+
+        if(seen >= rank) {
+            uint64_t upper = aodv_hist_bucket_upper(i);
+            // no value was above max, do not report the width of its bucket
+            return (hist->max && upper > hist->max) ? hist->max : upper;
+        }
+    }
+
+    return hist->max;
+}
@@ -0,0 +1,84 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#ifndef AODV_HISTOGRAM
+#define AODV_HISTOGRAM
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Log-linear histogram: values below 2^AODV_HIST_SUB_BITS get a bucket each,
+ * every larger power of two is split into 2^AODV_HIST_SUB_BITS equally wide
+ * buckets. The relative error of a reported value is below 1/2^AODV_HIST_SUB_BITS
+ * over the whole uint64_t range. Adding is lock-free, several threads may add
+ * to the same histogram.
+ */
+#define AODV_HIST_SUB_BITS 3
+#define AODV_HIST_SUB (1 << AODV_HIST_SUB_BITS)
+#define AODV_HIST_BUCKETS ((64 - AODV_HIST_SUB_BITS + 1) * AODV_HIST_SUB)
+
+typedef struct aodv_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[AODV_HIST_BUCKETS];
+} aodv_hist_t;
+
+static inline uint32_t aodv_hist_bucket(uint64_t value) __attribute__ ((__unused__));
+static inline uint32_t aodv_hist_bucket(uint64_t value) {
+    if(value < AODV_HIST_SUB) {
+        return value;
+    }
+
+    uint32_t msb = 63 - __builtin_clzll(value);
+    uint32_t shift = msb - AODV_HIST_SUB_BITS;
+    return (shift + 1) * AODV_HIST_SUB + ((value >> shift) & (AODV_HIST_SUB - 1));
+}
+
+static inline void aodv_hist_add(aodv_hist_t* hist, uint64_t value) __attribute__ ((__unused__));
+static inline void aodv_hist_add(aodv_hist_t* hist, uint64_t value) {
+    __atomic_fetch_add(&hist->buckets[aodv_hist_bucket(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->sum, value, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+    while(value > max && !__atomic_compare_exchange_n(&hist->max, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/** copy a histogram other threads may be adding to */
+void aodv_hist_read(aodv_hist_t* hist, aodv_hist_t* copy_out);
+
+void aodv_hist_clear(aodv_hist_t* hist);
+
+/** add all values of other to hist, hist must not be in use by other threads */
+void aodv_hist_merge(aodv_hist_t* hist, const aodv_hist_t* other);
+
+/**
+ * value below which the fraction q (0..1) of all values lies, reported as the
+ * upper bound of the bucket; 0 for an empty histogram
+ */
+uint64_t aodv_hist_percentile(const aodv_hist_t* hist, double q);
+
+#endif
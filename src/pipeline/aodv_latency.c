@@ -0,0 +1,85 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include <pthread.h>
+#include "aodv_latency.h"
+#include "aodv_stats.h"
+
+bool aodv_latency_enabled = false;
+aodv_hist_t aodv_latency_cb[AODV_CB_COUNT];
+
+// cycle counter and monotonic clock when profiling was first switched on
+static uint64_t calibrated_cycles = 0;
+static uint64_t calibrated_ns = 0;
+static pthread_mutex_t latency_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t aodv_latency_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void aodv_latency_calibrate() {
+    pthread_mutex_lock(&latency_mutex);
+    if(calibrated_ns == 0) {
+        calibrated_ns = aodv_latency_ns();
+        calibrated_cycles = aodv_latency_cycles();
+    }
+    pthread_mutex_unlock(&latency_mutex);
+}
+
+void aodv_latency_enable(bool enable) {
+    uint32_t i;
+
+    if(enable) {
+        aodv_latency_calibrate();
+
+        for(i = 0; i < AODV_CB_COUNT; ++i) {
+            aodv_hist_clear(&aodv_latency_cb[i]);
+        }
+    }
+    __atomic_store_n(&aodv_latency_enabled, enable, __ATOMIC_RELAXED);
+}
+
+double aodv_latency_cycles_per_ns() {
+#if defined(__x86_64__) || defined(__i386__)
+    pthread_mutex_lock(&latency_mutex);
+    uint64_t since_ns = calibrated_ns;
+    uint64_t ns = aodv_latency_ns() - calibrated_ns;
+    uint64_t cycles = aodv_latency_cycles() - calibrated_cycles;
+    pthread_mutex_unlock(&latency_mutex);
+
+    // never switched on or no time passed, nothing to calibrate with
+    if(since_ns == 0 || ns == 0) {
+        return 1.0;
+    }
+    return (double) cycles / ns;
+#else
+    return 1.0;
+#endif
+}
+
+void aodv_latency_get(uint32_t cb, aodv_hist_t* hist_out) {
+    aodv_hist_read(&aodv_latency_cb[cb], hist_out);
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#ifndef AODV_LATENCY
+#define AODV_LATENCY
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "aodv_histogram.h"
+
+/**
+ * Optional latency profiling of the callbacks registered in aodv.c. The
+ * wrappers in aodv_stats.h test aodv_latency_enabled once per packet; only
+ * when it is set they read the cycle counter around the callback and add the
+ * difference to the histogram of the callback (indexed by aodv_stats_cb_t).
+ */
+
+extern bool aodv_latency_enabled;
+extern aodv_hist_t aodv_latency_cb[];
+
+/** time stamp counter on x86, nanoseconds of the monotonic clock elsewhere */
+static inline uint64_t aodv_latency_cycles() __attribute__ ((__unused__));
+static inline uint64_t aodv_latency_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static inline void aodv_latency_add(uint32_t cb, uint64_t cycles) __attribute__ ((__unused__));
+static inline void aodv_latency_add(uint32_t cb, uint64_t cycles) {
+    aodv_hist_add(&aodv_latency_cb[cb], cycles);
+}
+
+/** switch profiling on or off, switching it on clears all histograms */
+void aodv_latency_enable(bool enable);
+
+/** start measuring the cycle rate, if that has not happened yet */
+void aodv_latency_calibrate();
+
+/** cycles per nanosecond, measured since the first calibration */
+double aodv_latency_cycles_per_ns();
+
+void aodv_latency_get(uint32_t cb, aodv_hist_t* hist_out);
+
+#endif
@@ -22,8 +22,12 @@ For further information and questions please use the web site
 *******************************************************************************/
 
 #include "../database/aodv_database.h"
+#include "../database/lockstat.h"
 #include "aodv_pipeline.h"
+#include "aodv_ratelimit.h"
+#include "aodv_discovery.h"
 #include "../config.h"
+#include "../helper.h"
 #include <string.h>
 #include <pthread.h>
 #include <utlist.h>
@@ -37,9 +41,9 @@ dessert_per_result_t aodv_periodic_send_hello(void* data, struct timeval* schedu
     dessert_msg_new(&msg);
     msg->ttl = 2;
 
-    pthread_rwlock_wrlock(&hello_rwlock);
+    lockstat_wrlock(&hello_rwlock, "hello_rwlock");
     msg->u16 = seq_num_hello++;
-    pthread_rwlock_unlock(&hello_rwlock);
+    lockstat_unlock(&hello_rwlock);
 
     dessert_ext_t* ext;
     dessert_msg_addext(msg, &ext, HELLO_EXT_TYPE, sizeof(struct aodv_msg_hello));
@@ -50,7 +54,13 @@ dessert_per_result_t aodv_periodic_send_hello(void* data, struct timeval* schedu
 
     dessert_msg_dummy_payload(msg, hello_size);
 
-    dessert_meshsend(msg, NULL);
+    struct timeval timestamp;
+    gettimeofday(&timestamp, NULL);
+
+    if(aodv_ratelimit_msg(AODV_RATE_HELLO, msg, &timestamp)) {
+        dessert_meshsend(msg, NULL);
+    }
+
     dessert_msg_destroy(msg);
     return DESSERT_PER_KEEP;
 }
@@ -70,24 +80,12 @@ dessert_per_result_t aodv_periodic_send_rreq(void* data, struct timeval* schedul
     aodv_link_break_element_t* dest, *tmp;
     DL_FOREACH_SAFE(head, dest, tmp) {
         dessert_debug("periodic send rreq to: " MAC " - interval=%" PRIu16 " ms", EXPLODE_ARRAY6(dest->host), rreq_interval);
-        aodv_send_rreq(dest->host, &timestamp);
+        aodv_discovery_start(dest->host);
         free(dest);
     }
     return DESSERT_PER_KEEP;
 }
 
-dessert_per_result_t aodv_periodic_cleanup_database(void* data, struct timeval* scheduled, struct timeval* interval) {
-    struct timeval timestamp;
-    gettimeofday(&timestamp, NULL);
-
-    if(aodv_db_cleanup(&timestamp)) {
-        return DESSERT_PER_KEEP;
-    }
-    else {
-        return DESSERT_PER_UNREGISTER;
-    }
-}
-
 dessert_msg_t* aodv_create_rerr(aodv_link_break_element_t** destlist) {
     if(*destlist == NULL) {
         return NULL;
@@ -155,39 +153,50 @@ dessert_msg_t* aodv_create_rerr(aodv_link_break_element_t** destlist) {
     return msg;
 }
 
-dessert_per_result_t aodv_periodic_scexecute(void* data, struct timeval* scheduled, struct timeval* interval) {
-    uint8_t schedule_type;
-    void* schedule_param = NULL;
-    mac_addr ether_addr;
-    struct timeval timestamp;
-    gettimeofday(&timestamp, NULL);
+aodv_sc_lateness_t sc_lateness = {0, 0, 0, 0};
+
+static void aodv_sc_lateness_add(struct timeval* execute_ts, struct timeval* timestamp) {
+    uint64_t late_us = 0;
 
-    if(aodv_db_popschedule(&timestamp, ether_addr, &schedule_type, &schedule_param) == false) {
-        //nothing to do come back later
-        return DESSERT_PER_KEEP;
+    if(dessert_timevalcmp(timestamp, execute_ts) > 0) {
+        late_us = (uint64_t)(timestamp->tv_sec - execute_ts->tv_sec) * 1000000 + timestamp->tv_usec - execute_ts->tv_usec;
     }
 
+    // only the timer engine writes, the cli reads
+    __atomic_store_n(&sc_lateness.executed, sc_lateness.executed + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&sc_lateness.total_us, sc_lateness.total_us + late_us, __ATOMIC_RELAXED);
+
+    if(late_us > (uint64_t) SCHEDULE_LATE_THRESHOLD * 1000) {
+        __atomic_store_n(&sc_lateness.late, sc_lateness.late + 1, __ATOMIC_RELAXED);
+    }
+
+    if(late_us > sc_lateness.max_us) {
+        __atomic_store_n(&sc_lateness.max_us, late_us, __ATOMIC_RELAXED);
+    }
+}
+
+void aodv_periodic_sc_lateness(aodv_sc_lateness_t* lateness_out) {
+    lateness_out->executed = __atomic_load_n(&sc_lateness.executed, __ATOMIC_RELAXED);
+    lateness_out->late = __atomic_load_n(&sc_lateness.late, __ATOMIC_RELAXED);
+    lateness_out->total_us = __atomic_load_n(&sc_lateness.total_us, __ATOMIC_RELAXED);
+    lateness_out->max_us = __atomic_load_n(&sc_lateness.max_us, __ATOMIC_RELAXED);
+}
+
+static void aodv_sc_execute(mac_addr ether_addr, uint8_t schedule_type, void* schedule_param, struct timeval* timestamp) {
     switch(schedule_type) {
         case AODV_SC_REPEAT_RREQ: {
-            aodv_send_rreq_repeat(&timestamp, (aodv_rreq_series_t*)schedule_param);
+            aodv_discovery_retry(ether_addr, (uintptr_t) schedule_param);
             break;
         }
         case AODV_SC_SEND_OUT_RERR: {
-            uint32_t rerr_count;
-            aodv_db_getrerrcount(&timestamp, &rerr_count);
-
-            if(rerr_count >= RERR_RATELIMIT) {
-                return DESSERT_PER_KEEP;
-            }
-
             if(!aodv_db_inv_over_nexthop(ether_addr)) {
-                return 0; //nexthop not in nht
+                break; //nexthop not in nht
             }
 
             aodv_link_break_element_t* destlist = NULL;
 
             if(!aodv_db_get_destlist(ether_addr, &destlist)) {
-                return 0; //nexthop not in nht
+                break; //nexthop not in nht
             }
 
             while(true) {
@@ -197,9 +206,10 @@ dessert_per_result_t aodv_periodic_scexecute(void* data, struct timeval* schedul
                     break;
                 }
 
-                dessert_meshsend(rerr_msg, NULL);
+                if(aodv_ratelimit_msg(AODV_RATE_RERR, rerr_msg, timestamp)) {
+                    dessert_meshsend(rerr_msg, NULL);
+                }
                 dessert_msg_destroy(rerr_msg);
-                aodv_db_putrerr(&timestamp);
             }
 
             break;
@@ -213,19 +223,20 @@ dessert_per_result_t aodv_periodic_scexecute(void* data, struct timeval* schedul
                 dessert_debug("AODV_SC_SEND_OUT_RWARN: " MAC " -> " MAC,
                               EXPLODE_ARRAY6(ether_addr),
                               EXPLODE_ARRAY6(dest->host));
-                aodv_send_rreq(dest->host, &timestamp);
+                aodv_discovery_start(dest->host);
+                free(dest);
             }
             break;
         }
 #ifndef ANDROID
         case AODV_SC_UPDATE_RSSI: {
             dessert_meshif_t* iface = (dessert_meshif_t*)(schedule_param);
-            int8_t diff = aodv_db_update_rssi(ether_addr, iface, &timestamp);
+            int8_t diff = aodv_db_update_rssi(ether_addr, iface, timestamp);
 
             if(diff > signal_strength_threshold) {
                 //walking away -> we need to send a new warn
                 dessert_debug("%s <= W => " MAC, iface->if_name, EXPLODE_ARRAY6(ether_addr));
-                aodv_db_addschedule(&timestamp, ether_addr, AODV_SC_SEND_OUT_RWARN, 0);
+                aodv_db_addschedule(timestamp, ether_addr, AODV_SC_SEND_OUT_RWARN, 0);
             }
 
             break;
@@ -235,6 +246,23 @@ dessert_per_result_t aodv_periodic_scexecute(void* data, struct timeval* schedul
             dessert_crit("unknown schedule type=%" PRIu8 "", schedule_type);
         }
     }
+}
 
-    return DESSERT_PER_KEEP;
+void aodv_periodic_scexecute() {
+    uint8_t schedule_type;
+    void* schedule_param = NULL;
+    mac_addr ether_addr;
+    struct timeval timestamp;
+    struct timeval execute_ts;
+    gettimeofday(&timestamp, NULL);
+
+    // drain everything that is due, but leave the rest for the next run if we run out of time
+    struct timeval deadline = hf_tv_add_ms(timestamp, SCHEDULE_TIME_BUDGET);
+
+    while(dessert_timevalcmp(&timestamp, &deadline) < 0
+          && aodv_db_popschedule(&timestamp, ether_addr, &schedule_type, &schedule_param, &execute_ts)) {
+        aodv_sc_lateness_add(&execute_ts, &timestamp);
+        aodv_sc_execute(ether_addr, schedule_type, schedule_param, &timestamp);
+        gettimeofday(&timestamp, NULL);
+    }
 }
@@ -23,108 +23,26 @@ For further information and questions please use the web site
 
 #include <pthread.h>
 #include <string.h>
-#include <utlist.h>
 #include "../database/aodv_database.h"
 #include "aodv_pipeline.h"
+#include "aodv_ratelimit.h"
+#include "aodv_stats.h"
+#include "../database/lockstat.h"
 #include "../config.h"
 #include "../helper.h"
 
 static uint32_t seq_num_global = 0;
 static pthread_rwlock_t seq_num_lock = PTHREAD_RWLOCK_INITIALIZER;
 
-/* tracks a running series of RREQs to msg->dhost_ether */
-/* Nachbedingung: die Serie wird nicht mehr referenziert. Es kann sofort eine neue Serie zum ziel gestartet werden. */
-//Invariante: Es gibt nur zwei mögliche Zustände für eine Serie: geschedulet oder in Verarbeitung durch send_rreq, dass noch MINDESTENS EINMAL die markierung prüft
-//Invariante: a series is either owned by a invocation of send_rreq, delete_series, reschedule_series or of the schedule table
-//Invariante: a schedule is only added by a valid series and dropped or popped before the series is deleted
-struct aodv_rreq_series {
-    dessert_msg_t *msg;
-    int retries;
-    uint64_t key;
-    /* the series is not in the series_list anymore. Implies the series should be terminated at the next possibility */
-    bool stop;
-    struct aodv_rreq_series *prev, *next;
-};
-static aodv_rreq_series_t *series_list = NULL;
-/* synchronizes access to the attributes key, stop, prev and next in all elements of the list. *msg and retries can be changed by the owner of the respective series (except the destination address in *msg, which is cached in key and interacts with the schedule table) */
-static pthread_rwlock_t series_list_lock = PTHREAD_RWLOCK_INITIALIZER;
-
-static aodv_rreq_series_t *aodv_pipeline_find_series_unlocked(mac_addr addr) {
-    aodv_rreq_series_t *el;
-    uint64_t addr_as_uint = hf_mac_addr_to_uint64(addr);
-    DL_SEARCH_SCALAR(series_list, el, key, addr_as_uint);
-    return el;
-}
-
-/** creates a series if one is not already running
- *  takes ownership of msg
- *  @return the newly created series (destroy with aodv_pipeline_delete_series) or NULL if a series for the msg's destination is running already
- */
-static aodv_rreq_series_t *aodv_pipeline_new_series(dessert_msg_t *msg) {
-    struct ether_header* l25h = dessert_msg_getl25ether(msg);
-    pthread_rwlock_wrlock(&series_list_lock);
-    aodv_rreq_series_t *pre_existing = aodv_pipeline_find_series_unlocked(l25h->ether_dhost);
-    if(pre_existing) {
-        pthread_rwlock_unlock(&series_list_lock);
-        return NULL;
-    }
-    //we can safely start a new series
-    aodv_rreq_series_t *series = malloc(sizeof(*series));
-    series->msg = msg;
-    series->key = hf_mac_addr_to_uint64(l25h->ether_dhost);
-    series->retries = 0;
-    series->stop = false;
-    DL_APPEND(series_list, series);
-    pthread_rwlock_unlock(&series_list_lock);
-    return series;
-}
-
-// Don't call this directly, but one of the two (locking) versions below
-static void aodv_pipeline_delete_series_unlocked(aodv_rreq_series_t *series) {
-    if(!series->stop) {
-        DL_DELETE(series_list, series);
-        series->stop = true; //mark for deletion by the owner
-        struct ether_header* l25h = dessert_msg_getl25ether(series->msg);
-        bool dropped = aodv_db_dropschedule(l25h->ether_dhost, AODV_SC_REPEAT_RREQ);
-        if(dropped) {
-            // we took ownership of the series and can safely delete it
-            dessert_msg_destroy(series->msg);
-            free(series);
-        }
-    }
-}
-
-static inline void aodv_pipeline_delete_series(aodv_rreq_series_t *series) {
-    pthread_rwlock_wrlock(&series_list_lock);
-    aodv_pipeline_delete_series_unlocked(series);
-    pthread_rwlock_unlock(&series_list_lock);
-}
+// ---------------------------- help functions ---------------------------------------
 
-void aodv_pipeline_delete_series_ether(mac_addr addr) {
-    pthread_rwlock_wrlock(&series_list_lock);
-    aodv_rreq_series_t *series = aodv_pipeline_find_series_unlocked(addr);
-    if(series) {
-        aodv_pipeline_delete_series_unlocked(series);
-    }
-    pthread_rwlock_unlock(&series_list_lock);
+uint32_t aodv_pipeline_next_seq_num() {
+    lockstat_wrlock(&seq_num_lock, "seq_num_lock");
+    uint32_t seq_num = ++seq_num_global;
+    lockstat_unlock(&seq_num_lock);
+    return seq_num;
 }
 
-static void aodv_pipeline_reschedule_series(struct timeval when, aodv_rreq_series_t *series) {
-    pthread_rwlock_wrlock(&series_list_lock);
-    if(!series->stop) {
-        struct ether_header* l25h = dessert_msg_getl25ether(series->msg);
-        //pass ownership to the db
-        aodv_db_addschedule(&when, l25h->ether_dhost, AODV_SC_REPEAT_RREQ, series);
-    }
-    else {
-        dessert_msg_destroy(series->msg);
-        free(series);
-    }
-    pthread_rwlock_unlock(&series_list_lock);
-}
-
-// ---------------------------- help functions ---------------------------------------
-
 dessert_msg_t* _create_rreq(mac_addr dhost_ether, uint8_t ttl, metric_t initial_metric) {
     dessert_msg_t* msg;
     dessert_ext_t* ext;
@@ -196,83 +114,17 @@ dessert_msg_t* _create_rrep(mac_addr route_dest, mac_addr route_source, mac_addr
     return msg;
 }
 
-static void aodv_send_rreq_real(aodv_rreq_series_t *series) {
-    struct timeval ts;
-    gettimeofday(&ts, NULL);
-    // if we sent too many RREQs in the last second, try again later
-    uint32_t rreq_count;
-    aodv_db_getrreqcount(&ts, &rreq_count);
-
-    if(rreq_count > RREQ_RATELIMIT) {
-        dessert_trace("we have reached RREQ_RATELIMIT");
-        struct timeval postpone = hf_tv_add_ms(ts, 20);
-        aodv_pipeline_reschedule_series(postpone, series);
-        return;
-    }
-
-    dessert_msg_t *msg = series->msg;
-    dessert_ext_t* ext;
-    dessert_msg_getext(msg, &ext, RREQ_EXT_TYPE, 0);
-    struct aodv_msg_rreq* rreq = (struct aodv_msg_rreq*) ext->data;
-
-    pthread_rwlock_wrlock(&seq_num_lock);
-    rreq->originator_sequence_number = ++seq_num_global;
-    pthread_rwlock_unlock(&seq_num_lock);
-
-    struct ether_header* l25h = dessert_msg_getl25ether(series->msg);
-    dessert_debug("sending RREQ to " MAC " ttl=%ju id=%ju", EXPLODE_ARRAY6(l25h->ether_dhost), (uintmax_t)msg->ttl, (uintmax_t)rreq->originator_sequence_number);
-    dessert_meshsend(msg, NULL);
-    gettimeofday(&ts, NULL);
-    aodv_db_putrreq(&ts);
-
-    if(series->retries >= RREQ_RETRIES) {
-        /* RREQ has been tried for the max. number of times -- give up */
-        aodv_pipeline_delete_series(series);
-        return;
-    }
-    dessert_trace("add task to repeat RREQ");
-
-    /* RING_TRAVERSAL_TIME equals NET_TRAVERSAL_TIME if ring_search is off */
-    uintmax_t ring_traversal_time = 2 * NODE_TRAVERSAL_TIME * min(NET_DIAMETER, msg->ttl);
-    struct timeval repeat_time  = hf_tv_add_ms(ts, ring_traversal_time);
-
-    series->retries++;
-    if(ring_search && msg->ttl <= TTL_THRESHOLD) {
-        msg->ttl += TTL_INCREMENT;
-        if(msg->ttl > TTL_THRESHOLD) {
-            msg->ttl = TTL_MAX;
-        }
-    }
-    aodv_pipeline_reschedule_series(repeat_time, series);
-}
-
-void aodv_send_rreq(mac_addr dhost_ether, struct timeval* ts) {
-    // RFC uses NET_DIAMETER as maximum ttl value, but we don't need ttl for loop detection
-    uint8_t ttl = ring_search ? TTL_START : TTL_MAX;
-    dessert_msg_t* msg = _create_rreq(dhost_ether, ttl, metric_startvalue);
-
-    aodv_rreq_series_t* series = aodv_pipeline_new_series(msg);
-    if(!series) {
-        dessert_trace("There is a rreq schedule to this dest. We dont start a new series.");
-        return;
-    }
-    aodv_send_rreq_real(series);
-}
-
-void aodv_send_rreq_repeat(struct timeval* ts, aodv_rreq_series_t* series) {
-    assert(series);
-    aodv_send_rreq_real(series);
-}
-
 // ---------------------------- pipeline callbacks ---------------------------------------------
 
 int aodv_drop_errors(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_meshif_t* iface, dessert_frameid_t id) {
     // drop packets sent by myself.
     if(proc->lflags & DESSERT_RX_FLAG_L2_SRC) {
+        aodv_stats_drop(AODV_DROP_OWN);
         return DESSERT_MSG_DROP;
     }
 
     if(proc->lflags & DESSERT_RX_FLAG_L25_SRC) {
+        aodv_stats_drop(AODV_DROP_OWN);
         return DESSERT_MSG_DROP;
     }
 
@@ -290,6 +142,7 @@ int aodv_drop_errors(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
     if((dessert_msg_getext(msg, &ext, RREQ_EXT_TYPE, 0) != 0) || (dessert_msg_getext(msg, &ext, RREP_EXT_TYPE, 0) != 0)) {
         if(aodv_db_check2Dneigh(msg->l2h.ether_shost, iface, &ts) != true) {
             dessert_debug("DROP RREQ/RREP from " MAC " metric=%" AODV_PRI_METRIC " hop_count=%" PRIu8 " ttl=%" PRIu8 "-> neighbor is unidirectional!", EXPLODE_ARRAY6(msg->l2h.ether_shost), msg->u16, msg->u8, msg->ttl);
+            aodv_stats_drop(AODV_DROP_UNIDIRECTIONAL);
             return DESSERT_MSG_DROP;
         }
     }
@@ -304,6 +157,7 @@ int aodv_handle_hello(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc
         return DESSERT_MSG_KEEP;
     }
 
+    aodv_stats_ctrl_rx(AODV_CTRL_HELLO);
     struct aodv_msg_hello* hello_msg = (struct aodv_msg_hello*) hallo_ext->data;
 
     struct timeval ts;
@@ -320,7 +174,9 @@ int aodv_handle_hello(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc
         }
         hello_msg->hello_interval = hello_interval; 
         mac_copy(msg->l2h.ether_dhost, msg->l2h.ether_shost);
-        dessert_meshsend(msg, iface);
+        if(aodv_ratelimit_msg(AODV_RATE_HELLO, msg, &ts)) {
+            dessert_meshsend(msg, iface);
+        }
         // dessert_trace("got hello-req from " MAC, EXPLODE_ARRAY6(msg->l2h.ether_shost));
     }
     else {
@@ -342,6 +198,7 @@ int aodv_handle_rreq(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
         return DESSERT_MSG_KEEP;
     }
 
+    aodv_stats_ctrl_rx(AODV_CTRL_RREQ);
     struct aodv_msg_rreq* rreq_msg = (struct aodv_msg_rreq*) rreq_ext->data;
 
     if(msg->ttl) {
@@ -362,11 +219,14 @@ int aodv_handle_rreq(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
 
     if(capt_result == AODV_CAPT_RREQ_OLD) {
         comment = "discarded";
+        aodv_stats_drop(AODV_DROP_RREQ_OLD);
         goto drop;
     }
 
-    /* Process RREQ also as RREP */
-    int updated_route = aodv_db_capt_rrep(l25h->ether_shost, msg->l2h.ether_shost, iface, 0 /* force */, msg->u16, msg->u8, &ts);
+    /* Process RREQ also as RREP, with the originator sequence number: 0 would
+     * make the next copy of this RREQ look newer and turn the route to its
+     * sender, which loops RREPs between the two (RFC 6.5) */
+    int updated_route = aodv_db_capt_rrep(l25h->ether_shost, msg->l2h.ether_shost, iface, rreq_msg->originator_sequence_number, msg->u16, msg->u8, &ts);
     if(updated_route) {
         // no need to search for next hop. Next hop is RREQ.msg->l2h.ether_shost
         aodv_send_packets_from_buffer(l25h->ether_shost, msg->l2h.ether_shost, iface);
@@ -374,7 +234,7 @@ int aodv_handle_rreq(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
 
     uint16_t unknown_seq_num_flag = rreq_msg->flags & AODV_FLAGS_RREQ_U;
     if(proc->lflags & DESSERT_RX_FLAG_L25_DST) {
-        pthread_rwlock_wrlock(&seq_num_lock);
+        lockstat_wrlock(&seq_num_lock, "seq_num_lock");
         uint32_t rrep_seq_num;
         /* increase our sequence number on metric hit, so that the updated
          * RREP doesn't get discarded as old */
@@ -387,12 +247,18 @@ int aodv_handle_rreq(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
             seq_num_global = rreq_msg->destination_sequence_number;
         }
         rrep_seq_num = seq_num_global;
-        pthread_rwlock_unlock(&seq_num_lock);
+        lockstat_unlock(&seq_num_lock);
 
         dessert_msg_t* rrep_msg = _create_rrep(dessert_l25_defsrc, l25h->ether_shost, msg->l2h.ether_shost, rrep_seq_num, 0, 0, metric_startvalue);
-        dessert_meshsend(rrep_msg, iface);
+        if(aodv_ratelimit_msg(AODV_RATE_RREP, rrep_msg, &ts)) {
+            dessert_meshsend(rrep_msg, iface);
+            comment = "for me";
+        }
+        else {
+            comment = "for me, RREP rate limited";
+            aodv_stats_drop(AODV_DROP_RATE_LIMIT);
+        }
         dessert_msg_destroy(rrep_msg);
-        comment = "for me";
     }
     else {
         uint16_t dest_only_flag = rreq_msg->flags & AODV_FLAGS_RREQ_D;
@@ -415,21 +281,35 @@ int aodv_handle_rreq(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
             aodv_db_get_hopcount(l25h->ether_dhost, &dest_hop_count);
 
             dessert_msg_t* rrep_msg = _create_rrep(l25h->ether_dhost, l25h->ether_shost, msg->l2h.ether_shost, our_dest_seq_num, 0, dest_hop_count, dest_metric);
-            dessert_meshsend(rrep_msg, iface);
+            if(aodv_ratelimit_msg(AODV_RATE_RREP, rrep_msg, &ts)) {
+                dessert_meshsend(rrep_msg, iface);
+                comment = "locally repaired";
+            }
+            else {
+                comment = "locally repaired, RREP rate limited";
+                aodv_stats_drop(AODV_DROP_RATE_LIMIT);
+            }
             dessert_msg_destroy(rrep_msg);
-            comment = "locally repaired";
         }
         else {
             if(gossip_type == GOSSIP_NONE && msg->ttl == 0) {
                 comment = "dropped (TTL)";
+                aodv_stats_drop(AODV_DROP_TTL);
                 goto drop;
             }
             if(gossip_type == GOSSIP_NONE || aodv_gossip(msg)) {
-                dessert_meshsend(msg, NULL);
-                comment = "rebroadcasted";
+                if(aodv_ratelimit_msg(AODV_RATE_RREQ_FORWARD, msg, &ts)) {
+                    dessert_meshsend(msg, NULL);
+                    comment = "rebroadcasted";
+                }
+                else {
+                    comment = "dropped (rate limit)";
+                    aodv_stats_drop(AODV_DROP_RATE_LIMIT);
+                }
             }
             else {
                 comment = "dropped (gossip)";
+                aodv_stats_drop(AODV_DROP_GOSSIP);
             }
         }
     }
@@ -445,6 +325,7 @@ int aodv_handle_rerr(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
         return DESSERT_MSG_KEEP;
     }
 
+    aodv_stats_ctrl_rx(AODV_CTRL_RERR);
     struct aodv_msg_rerr* rerr_msg = (struct aodv_msg_rerr*) rerr_ext->data;
 
     int rerrdl_num = 0;
@@ -492,7 +373,15 @@ int aodv_handle_rerr(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
             rerr_msg->iface_addr_count++;
         }
 
-        dessert_meshsend(msg, NULL);
+        struct timeval ts;
+        gettimeofday(&ts, NULL);
+
+        if(aodv_ratelimit_msg(AODV_RATE_RERR, msg, &ts)) {
+            dessert_meshsend(msg, NULL);
+        }
+        else {
+            aodv_stats_drop(AODV_DROP_RATE_LIMIT);
+        }
     }
 
     return DESSERT_MSG_DROP;
@@ -505,7 +394,10 @@ int aodv_handle_rrep(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
         return DESSERT_MSG_KEEP;
     }
 
+    aodv_stats_ctrl_rx(AODV_CTRL_RREP);
+
     if(!(proc->lflags & DESSERT_RX_FLAG_L2_DST)) {
+        aodv_stats_drop(AODV_DROP_NOT_NEXT_HOP);
         return DESSERT_MSG_DROP;
     }
 
@@ -528,6 +420,7 @@ int aodv_handle_rrep(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
         // sequence number is greater then that in database OR
         // if seq_nums are equal and known metric is worse than RREP's
         comment = "discarded";
+        aodv_stats_drop(AODV_DROP_RREP_OLD);
         goto drop;
     }
 
@@ -541,11 +434,18 @@ int aodv_handle_rrep(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc,
         if(reverse_route_found) {
             aodv_db_add_precursor(l25h->ether_shost, next_hop, output_iface);
             mac_copy(msg->l2h.ether_dhost, next_hop);
-            dessert_meshsend(msg, output_iface);
-            comment = "forwarded";
+            if(aodv_ratelimit_msg(AODV_RATE_RREP, msg, &ts)) {
+                dessert_meshsend(msg, output_iface);
+                comment = "forwarded";
+            }
+            else {
+                comment = "dropped (rate limit)";
+                aodv_stats_drop(AODV_DROP_RATE_LIMIT);
+            }
         }
         else {
             comment = "dropped (no reverse route)";
+            aodv_stats_drop(AODV_DROP_NO_REVERSE_ROUTE);
         }
     }
     else {
@@ -109,8 +109,6 @@ struct aodv_msg_hello {
     uint16_t		hello_interval;
 } __attribute__((__packed__));
 
-typedef struct aodv_rreq_series aodv_rreq_series_t;
-
 // ------------- pipeline -----------------------------------------------------
 int aodv_handle_hello(dessert_msg_t* msg, uint32_t len,
                       dessert_msg_proc_t* proc, dessert_meshif_t* iface, dessert_frameid_t id);
@@ -157,12 +155,20 @@ void aodv_send_packets_from_buffer(mac_addr ether_dhost, mac_addr next_hop, dess
 dessert_per_result_t aodv_periodic_send_hello(void* data, struct timeval* scheduled, struct timeval* interval);
 dessert_per_result_t aodv_periodic_send_rreq(void* data, struct timeval* scheduled, struct timeval* interval);
 
-/** clean up database from old entries */
-dessert_per_result_t aodv_periodic_cleanup_database(void* data, struct timeval* scheduled, struct timeval* interval);
-
 dessert_msg_t* aodv_create_rerr(aodv_link_break_element_t** destlist);
 
-dessert_per_result_t aodv_periodic_scexecute(void* data, struct timeval* scheduled, struct timeval* interval);
+/** execute all due schedules, bounded by SCHEDULE_TIME_BUDGET per run; called by the timer engine */
+void aodv_periodic_scexecute();
+
+/** lateness of executed schedules relative to their planned execution time */
+typedef struct aodv_sc_lateness {
+    uint64_t executed;
+    uint64_t late; // more than SCHEDULE_LATE_THRESHOLD
+    uint64_t total_us;
+    uint64_t max_us;
+} aodv_sc_lateness_t;
+
+void aodv_periodic_sc_lateness(aodv_sc_lateness_t* lateness_out);
 
 // ------------------------------ metric ----------------------------------------------------
 
@@ -174,10 +180,17 @@ int aodv_gossip(dessert_msg_t* msg);
 int aodv_gossip_0();
 void aodv_gossip_capt_rreq(dessert_msg_t *msg);
 
+/** send all held RREQs whose hold time is over at timestamp */
+void aodv_gossip_hold_queue_flush(struct timeval *timestamp);
+
+/** timeout of the next held RREQ; false if the hold queue is empty */
+int aodv_gossip_hold_queue_next(struct timeval *next_out);
+
 // ------------------------------ helper ------------------------------------------------------
 
-void aodv_pipeline_delete_series_ether(mac_addr addr);
-void aodv_send_rreq(mac_addr dhost_ether, struct timeval* ts);
-void aodv_send_rreq_repeat(struct timeval* ts, aodv_rreq_series_t* series);
+dessert_msg_t* _create_rreq(mac_addr dhost_ether, uint8_t ttl, metric_t initial_metric);
+
+/** next originator sequence number of this node */
+uint32_t aodv_pipeline_next_seq_num();
 
 #endif
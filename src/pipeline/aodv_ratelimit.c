@@ -0,0 +1,136 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include <string.h>
+#include "aodv_ratelimit.h"
+#include "aodv_stats.h"
+#include "../config.h"
+
+typedef struct aodv_bucket {
+    uint64_t tat; // theoretical arrival time in us, the bucket is full at any time after it
+    uint32_t rate;
+    uint32_t burst;
+    uint64_t passed;
+    uint64_t limited;
+} aodv_bucket_t;
+
+static aodv_bucket_t buckets[AODV_RATE_COUNT] = {
+    [AODV_RATE_RREQ_ORIGINATE] = { 0, RREQ_RATELIMIT, RREQ_RATELIMIT, 0, 0 },
+    [AODV_RATE_RREQ_FORWARD] = { 0, RREQ_FORWARD_RATELIMIT, RREQ_FORWARD_RATELIMIT, 0, 0 },
+    [AODV_RATE_RERR] = { 0, RERR_RATELIMIT, RERR_RATELIMIT, 0, 0 },
+    [AODV_RATE_RREP] = { 0, RREP_RATELIMIT, RREP_RATELIMIT, 0, 0 },
+    [AODV_RATE_HELLO] = { 0, HELLO_RATELIMIT, HELLO_RATELIMIT, 0, 0 },
+    [AODV_RATE_BUDGET] = { 0, CONTROL_BYTE_BUDGET, CONTROL_BYTE_BUDGET, 0, 0 },
+};
+
+static const char* bucket_names[AODV_RATE_COUNT] = {
+    [AODV_RATE_RREQ_ORIGINATE] = "rreq_originate",
+    [AODV_RATE_RREQ_FORWARD] = "rreq_forward",
+    [AODV_RATE_RERR] = "rerr",
+    [AODV_RATE_RREP] = "rrep",
+    [AODV_RATE_HELLO] = "hello",
+    [AODV_RATE_BUDGET] = "control_budget",
+};
+
+/** take units tokens; returns the consumed time in us, or UINT64_MAX if the bucket is empty */
+static uint64_t aodv_bucket_take(aodv_bucket_t* bucket, uint32_t units, uint64_t now_us) {
+    uint32_t rate = __atomic_load_n(&bucket->rate, __ATOMIC_RELAXED);
+
+    if(rate == 0) {
+        return 0;
+    }
+
+    uint32_t burst = max(__atomic_load_n(&bucket->burst, __ATOMIC_RELAXED), units);
+    uint64_t cost = (uint64_t) units * 1000000 / rate;
+    uint64_t window = (uint64_t) burst * 1000000 / rate;
+    uint64_t tat = __atomic_load_n(&bucket->tat, __ATOMIC_RELAXED);
+    uint64_t new_tat;
+
+    do {
+        new_tat = max(tat, now_us) + cost;
+
+        if(new_tat - now_us > window) {
+            return UINT64_MAX;
+        }
+    }
+    while(!__atomic_compare_exchange_n(&bucket->tat, &tat, new_tat, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return cost;
+}
+
+int aodv_ratelimit_msg(aodv_rate_class_t rate_class, dessert_msg_t* msg, struct timeval* timestamp) {
+    uint64_t now_us = (uint64_t) timestamp->tv_sec * 1000000 + timestamp->tv_usec;
+    aodv_bucket_t* bucket = &buckets[rate_class];
+    aodv_bucket_t* budget = &buckets[AODV_RATE_BUDGET];
+
+    uint64_t cost = aodv_bucket_take(bucket, 1, now_us);
+
+    if(cost == UINT64_MAX) {
+        __atomic_fetch_add(&bucket->limited, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    if(aodv_bucket_take(budget, msg->hlen + msg->plen, now_us) == UINT64_MAX) {
+        // give the message token back, the message is not sent
+        __atomic_fetch_sub(&bucket->tat, cost, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&budget->limited, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    __atomic_fetch_add(&bucket->passed, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&budget->passed, 1, __ATOMIC_RELAXED);
+    aodv_stats_inc(ctrl_tx[rate_class]);
+    return true;
+}
+
+void aodv_ratelimit_set(aodv_rate_class_t rate_class, uint32_t rate, uint32_t burst) {
+    aodv_bucket_t* bucket = &buckets[rate_class];
+    __atomic_store_n(&bucket->burst, burst ? burst : rate, __ATOMIC_RELAXED);
+    __atomic_store_n(&bucket->rate, rate, __ATOMIC_RELAXED);
+}
+
+void aodv_ratelimit_get(aodv_rate_class_t rate_class, aodv_ratelimit_info_t* info_out) {
+    aodv_bucket_t* bucket = &buckets[rate_class];
+    info_out->rate = __atomic_load_n(&bucket->rate, __ATOMIC_RELAXED);
+    info_out->burst = __atomic_load_n(&bucket->burst, __ATOMIC_RELAXED);
+    info_out->passed = __atomic_load_n(&bucket->passed, __ATOMIC_RELAXED);
+    info_out->limited = __atomic_load_n(&bucket->limited, __ATOMIC_RELAXED);
+}
+
+const char* aodv_ratelimit_name(aodv_rate_class_t rate_class) {
+    return bucket_names[rate_class];
+}
+
+int aodv_ratelimit_parse(const char* name, aodv_rate_class_t* rate_class_out) {
+    int i;
+
+    for(i = 0; i < AODV_RATE_COUNT; ++i) {
+        if(strcmp(name, bucket_names[i]) == 0) {
+            *rate_class_out = i;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,67 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#ifndef AODV_RATELIMIT
+#define AODV_RATELIMIT
+
+#include <dessert.h>
+
+/**
+ * Token bucket rate limiting of control messages. Every class has its own
+ * bucket counting messages, all classes share one bucket counting bytes (the
+ * control overhead budget). A message is sent only if both buckets have
+ * tokens left. The buckets are lock-free (GCRA on one atomic word), so they can
+ * be checked on every send. A rate of 0 means unlimited.
+ */
+typedef enum aodv_rate_class {
+    AODV_RATE_RREQ_ORIGINATE = 0,
+    AODV_RATE_RREQ_FORWARD,
+    AODV_RATE_RERR,
+    AODV_RATE_RREP,
+    AODV_RATE_HELLO,
+    AODV_RATE_BUDGET, // bytes of all classes above
+    AODV_RATE_COUNT
+} aodv_rate_class_t;
+
+typedef struct aodv_ratelimit_info {
+    uint32_t rate; // per second, messages or bytes for AODV_RATE_BUDGET
+    uint32_t burst;
+    uint64_t passed;
+    uint64_t limited;
+} aodv_ratelimit_info_t;
+
+/** true if msg of the given class may be sent at timestamp; takes its tokens */
+int aodv_ratelimit_msg(aodv_rate_class_t rate_class, dessert_msg_t* msg, struct timeval* timestamp);
+
+/** set rate per second and burst size of a bucket; a burst of 0 allows one second worth of tokens */
+void aodv_ratelimit_set(aodv_rate_class_t rate_class, uint32_t rate, uint32_t burst);
+
+void aodv_ratelimit_get(aodv_rate_class_t rate_class, aodv_ratelimit_info_t* info_out);
+
+const char* aodv_ratelimit_name(aodv_rate_class_t rate_class);
+
+/** find class by name as returned by aodv_ratelimit_name */
+int aodv_ratelimit_parse(const char* name, aodv_rate_class_t* rate_class_out);
+
+#endif
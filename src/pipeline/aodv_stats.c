@@ -0,0 +1,138 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include <string.h>
+#include <pthread.h>
+#include "aodv_stats.h"
+
+aodv_stats_t aodv_stats_cpu[AODV_STATS_CPUS];
+
+// sums at the last reset, subtracted from every report
+static aodv_stats_t stats_base;
+static pthread_mutex_t stats_base_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* cb_names[AODV_CB_COUNT] = {
+    [AODV_CB_MSG_CHECK] = "dessert_msg_check_cb",
+    [AODV_CB_IFACEFLAGS] = "dessert_msg_ifaceflags_cb",
+    [AODV_CB_DROP_ERRORS] = "aodv_drop_errors",
+    [AODV_CB_HANDLE_HELLO] = "aodv_handle_hello",
+    [AODV_CB_HANDLE_RREQ] = "aodv_handle_rreq",
+    [AODV_CB_HANDLE_RERR] = "aodv_handle_rerr",
+    [AODV_CB_HANDLE_RREP] = "aodv_handle_rrep",
+    [AODV_CB_MESH_IPTTL] = "dessert_mesh_ipttl",
+    [AODV_CB_FORWARD_BROADCAST] = "aodv_forward_broadcast",
+    [AODV_CB_FORWARD_MULTICAST] = "aodv_forward_multicast",
+    [AODV_CB_FORWARD] = "aodv_forward",
+    [AODV_CB_LOCAL_UNICAST] = "aodv_local_unicast",
+    [AODV_CB_SYS_DROP_IPV6] = "dessert_sys_drop_ipv6",
+    [AODV_CB_SYS_DROP_MULTICAST] = "aodv_sys_drop_multicast",
+    [AODV_CB_SYS2RP] = "aodv_sys2rp",
+};
+
+static const char* drop_names[AODV_DROP_COUNT] = {
+    [AODV_DROP_OWN] = "own",
+    [AODV_DROP_UNIDIRECTIONAL] = "unidirectional",
+    [AODV_DROP_RREQ_OLD] = "rreq_old",
+    [AODV_DROP_RREP_OLD] = "rrep_old",
+    [AODV_DROP_NOT_NEXT_HOP] = "not_next_hop",
+    [AODV_DROP_TTL] = "ttl",
+    [AODV_DROP_RATE_LIMIT] = "rate_limit",
+    [AODV_DROP_GOSSIP] = "gossip",
+    [AODV_DROP_NO_REVERSE_ROUTE] = "no_reverse_route",
+    [AODV_DROP_DUPLICATE] = "duplicate",
+    [AODV_DROP_MULTICAST] = "multicast",
+    [AODV_DROP_NO_ROUTE] = "no_route",
+};
+
+static const char* ctrl_names[AODV_CTRL_COUNT] = {
+    [AODV_CTRL_HELLO] = "hello",
+    [AODV_CTRL_RREQ] = "rreq",
+    [AODV_CTRL_RREP] = "rrep",
+    [AODV_CTRL_RERR] = "rerr",
+};
+
+static const char* data_names[AODV_DATA_COUNT] = {
+    [AODV_DATA_ORIGINATED] = "originated",
+    [AODV_DATA_BUFFERED] = "buffered",
+    [AODV_DATA_FORWARDED] = "forwarded",
+    [AODV_DATA_DELIVERED] = "delivered",
+    [AODV_DATA_BROADCAST] = "broadcast",
+};
+
+// the struct is nothing but uint64_t counters
+#define STATS_WORDS (sizeof(aodv_stats_t) / sizeof(uint64_t))
+
+static void aodv_stats_sum(aodv_stats_t* sum_out) {
+    uint64_t* sum = (uint64_t*) sum_out;
+    uint32_t cpu, i;
+
+    memset(sum_out, 0, sizeof(aodv_stats_t));
+
+    for(cpu = 0; cpu < AODV_STATS_CPUS; ++cpu) {
+        uint64_t* counters = (uint64_t*) &aodv_stats_cpu[cpu];
+
+        for(i = 0; i < STATS_WORDS; ++i) {
+            sum[i] += __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void aodv_stats_get(aodv_stats_t* stats_out) {
+    uint64_t* stats = (uint64_t*) stats_out;
+    uint64_t* base = (uint64_t*) &stats_base;
+    uint32_t i;
+
+    aodv_stats_sum(stats_out);
+
+    pthread_mutex_lock(&stats_base_mutex);
+    for(i = 0; i < STATS_WORDS; ++i) {
+        stats[i] -= base[i];
+    }
+    pthread_mutex_unlock(&stats_base_mutex);
+}
+
+void aodv_stats_reset() {
+    aodv_stats_t sum;
+    aodv_stats_sum(&sum);
+
+    pthread_mutex_lock(&stats_base_mutex);
+    stats_base = sum;
+    pthread_mutex_unlock(&stats_base_mutex);
+}
+
+const char* aodv_stats_cb_name(aodv_stats_cb_t cb) {
+    return cb_names[cb];
+}
+
+const char* aodv_stats_drop_name(aodv_drop_reason_t reason) {
+    return drop_names[reason];
+}
+
+const char* aodv_stats_ctrl_name(aodv_stats_ctrl_t type) {
+    return ctrl_names[type];
+}
+
+const char* aodv_stats_data_name(aodv_stats_data_t what) {
+    return data_names[what];
+}
@@ -0,0 +1,187 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#ifndef AODV_STATS
+#define AODV_STATS
+
+#include <sched.h>
+#include <stdint.h>
+#include <dessert.h>
+#include "aodv_ratelimit.h"
+#include "aodv_latency.h"
+#include "../config.h"
+
+/**
+ * Packet statistics. Every counter exists once per CPU (see AODV_STATS_CPUS)
+ * in its own cache lines, so the pipelines count without sharing lines
+ * between cores. Readers add up all copies; a reset only remembers the
+ * current sums, the counters themselves never go back.
+ */
+
+/** callbacks registered in aodv.c, see AODV_STATS_MESH_CB and AODV_STATS_SYS_CB */
+typedef enum aodv_stats_cb {
+    AODV_CB_MSG_CHECK = 0,
+    AODV_CB_IFACEFLAGS,
+    AODV_CB_DROP_ERRORS,
+    AODV_CB_HANDLE_HELLO,
+    AODV_CB_HANDLE_RREQ,
+    AODV_CB_HANDLE_RERR,
+    AODV_CB_HANDLE_RREP,
+    AODV_CB_MESH_IPTTL,
+    AODV_CB_FORWARD_BROADCAST,
+    AODV_CB_FORWARD_MULTICAST,
+    AODV_CB_FORWARD,
+    AODV_CB_LOCAL_UNICAST,
+    AODV_CB_SYS_DROP_IPV6,
+    AODV_CB_SYS_DROP_MULTICAST,
+    AODV_CB_SYS2RP,
+    AODV_CB_COUNT
+} aodv_stats_cb_t;
+
+/** why a packet was discarded */
+typedef enum aodv_drop_reason {
+    AODV_DROP_OWN = 0, // sent by myself
+    AODV_DROP_UNIDIRECTIONAL, // RREQ or RREP over a link that is not bidirectional
+    AODV_DROP_RREQ_OLD,
+    AODV_DROP_RREP_OLD,
+    AODV_DROP_NOT_NEXT_HOP, // overheard RREP
+    AODV_DROP_TTL,
+    AODV_DROP_RATE_LIMIT,
+    AODV_DROP_GOSSIP,
+    AODV_DROP_NO_REVERSE_ROUTE,
+    AODV_DROP_DUPLICATE,
+    AODV_DROP_MULTICAST,
+    AODV_DROP_NO_ROUTE,
+    AODV_DROP_COUNT
+} aodv_drop_reason_t;
+
+/** received control messages by type */
+typedef enum aodv_stats_ctrl {
+    AODV_CTRL_HELLO = 0,
+    AODV_CTRL_RREQ,
+    AODV_CTRL_RREP,
+    AODV_CTRL_RERR,
+    AODV_CTRL_COUNT
+} aodv_stats_ctrl_t;
+
+/** data packets by what happened to them */
+typedef enum aodv_stats_data {
+    AODV_DATA_ORIGINATED = 0, // from the sys interface to the mesh
+    AODV_DATA_BUFFERED, // from the sys interface, waiting for a route
+    AODV_DATA_FORWARDED,
+    AODV_DATA_DELIVERED, // to the sys interface
+    AODV_DATA_BROADCAST,
+    AODV_DATA_COUNT
+} aodv_stats_data_t;
+
+typedef struct aodv_stats {
+    uint64_t cb_in[AODV_CB_COUNT];
+    uint64_t cb_pass[AODV_CB_COUNT]; // handed on to the next callback
+    uint64_t cb_drop[AODV_CB_COUNT]; // processing ended in this callback
+    uint64_t drop[AODV_DROP_COUNT];
+    uint64_t ctrl_rx[AODV_CTRL_COUNT];
+    uint64_t ctrl_tx[AODV_RATE_BUDGET]; // by rate limit class
+    uint64_t data[AODV_DATA_COUNT];
+} __attribute__((aligned(64))) aodv_stats_t;
+
+extern aodv_stats_t aodv_stats_cpu[AODV_STATS_CPUS];
+
+static inline aodv_stats_t* aodv_stats_local() __attribute__ ((__unused__));
+static inline aodv_stats_t* aodv_stats_local() {
+    int cpu = sched_getcpu();
+    return &aodv_stats_cpu[(cpu < 0 ? 0 : (uint32_t) cpu) % AODV_STATS_CPUS];
+}
+
+// threads of one CPU may preempt each other, so the increments stay atomic
+#define aodv_stats_inc(field) __atomic_fetch_add(&aodv_stats_local()->field, 1, __ATOMIC_RELAXED)
+
+static inline void aodv_stats_drop(aodv_drop_reason_t reason) __attribute__ ((__unused__));
+static inline void aodv_stats_drop(aodv_drop_reason_t reason) {
+    aodv_stats_inc(drop[reason]);
+}
+
+static inline void aodv_stats_ctrl_rx(aodv_stats_ctrl_t type) __attribute__ ((__unused__));
+static inline void aodv_stats_ctrl_rx(aodv_stats_ctrl_t type) {
+    aodv_stats_inc(ctrl_rx[type]);
+}
+
+static inline void aodv_stats_data(aodv_stats_data_t what) __attribute__ ((__unused__));
+static inline void aodv_stats_data(aodv_stats_data_t what) {
+    aodv_stats_inc(data[what]);
+}
+
+static inline void aodv_stats_cb_result(aodv_stats_cb_t cb, int result) __attribute__ ((__unused__));
+static inline void aodv_stats_cb_result(aodv_stats_cb_t cb, int result) {
+    aodv_stats_t* stats = aodv_stats_local();
+    __atomic_fetch_add(&stats->cb_in[cb], 1, __ATOMIC_RELAXED);
+
+    if(result == DESSERT_MSG_DROP) {
+        __atomic_fetch_add(&stats->cb_drop[cb], 1, __ATOMIC_RELAXED);
+    }
+    else {
+        __atomic_fetch_add(&stats->cb_pass[cb], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * call cb with args and count its result as index; while latency profiling is
+ * switched on the call is timed as well, otherwise profiling costs one branch
+ */
+#define AODV_STATS_CALL(cb, index, args) ({ \
+        int result; \
+        if(__builtin_expect(__atomic_load_n(&aodv_latency_enabled, __ATOMIC_RELAXED), 0)) { \
+            uint64_t start = aodv_latency_cycles(); \
+            result = cb args; \
+            aodv_latency_add(index, aodv_latency_cycles() - start); \
+        } \
+        else { \
+            result = cb args; \
+        } \
+        aodv_stats_cb_result(index, result); \
+        result; \
+    })
+
+/** define cb##_counted, which calls the mesh callback cb and counts its result as index */
+#define AODV_STATS_MESH_CB(cb, index) \
+    static int cb##_counted(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_meshif_t* iface, dessert_frameid_t id) { \
+        return AODV_STATS_CALL(cb, index, (msg, len, proc, iface, id)); \
+    }
+
+/** define cb##_counted, which calls the sys callback cb and counts its result as index */
+#define AODV_STATS_SYS_CB(cb, index) \
+    static int cb##_counted(dessert_msg_t* msg, uint32_t len, dessert_msg_proc_t* proc, dessert_sysif_t* sysif, dessert_frameid_t id) { \
+        return AODV_STATS_CALL(cb, index, (msg, len, proc, sysif, id)); \
+    }
+
+/** sums of all counters since the last reset */
+void aodv_stats_get(aodv_stats_t* stats_out);
+
+void aodv_stats_reset();
+
+const char* aodv_stats_cb_name(aodv_stats_cb_t cb);
+const char* aodv_stats_drop_name(aodv_drop_reason_t reason);
+const char* aodv_stats_ctrl_name(aodv_stats_ctrl_t type);
+const char* aodv_stats_data_name(aodv_stats_data_t what);
+
+#endif
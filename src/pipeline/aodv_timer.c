@@ -0,0 +1,193 @@
+/******************************************************************************
+Copyright 2009, Freie Universitaet Berlin (FUB). All rights reserved.
+
+These sources were developed at the Freie Universitaet Berlin,
+Computer Systems and Telematics / Distributed, embedded Systems (DES) group
+(http://cst.mi.fu-berlin.de, http://www.des-testbed.net)
+-------------------------------------------------------------------------------
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+this program. If not, see http://www.gnu.org/licenses/ .
+--------------------------------------------------------------------------------
+For further information and questions please use the web site
+    http://www.des-testbed.net
+*******************************************************************************/
+
+
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dessert.h>
+
+#include "aodv_timer.h"
+#include "aodv_pipeline.h"
+#include "../database/aodv_database.h"
+#include "../database/timeslot.h"
+
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t timer_thread;
+static int timer_fd = -1;
+static int timer_epoll = -1;
+static int timer_armed = false;
+static struct timeval timer_deadline; // valid if timer_armed
+static timeslot_wakeup_t* timer_external = NULL; // set if there is no engine thread
+
+// timer_mutex must be locked
+static void aodv_timer_arm(struct timeval* deadline) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = deadline->tv_sec;
+    spec.it_value.tv_nsec = deadline->tv_usec * 1000;
+
+    if(spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+        spec.it_value.tv_nsec = 1; // zero would disarm the timer
+    }
+
+    if(timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        dessert_warn("could not arm timer: %s", strerror(errno));
+        return;
+    }
+
+    timer_deadline = *deadline;
+    timer_armed = true;
+}
+
+void aodv_timer_wakeup(struct timeval* deadline) {
+    if(timer_external != NULL) {
+        timer_external(deadline);
+        return;
+    }
+
+    if(timer_fd < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&timer_mutex);
+
+    if(!timer_armed || dessert_timevalcmp(deadline, &timer_deadline) < 0) {
+        aodv_timer_arm(deadline);
+    }
+
+    pthread_mutex_unlock(&timer_mutex);
+}
+
+int aodv_timer_run_once(struct timeval* now, struct timeval* next_out) {
+    struct timeval gossip_next;
+
+    aodv_db_cleanup(now);
+    aodv_periodic_scexecute();
+    aodv_gossip_hold_queue_flush(now);
+
+    int pending = aodv_db_next_expiry(next_out);
+
+    if(aodv_gossip_hold_queue_next(&gossip_next)
+       && (!pending || dessert_timevalcmp(&gossip_next, next_out) < 0)) {
+        *next_out = gossip_next;
+        pending = true;
+    }
+
+    return pending;
+}
+
+static void* aodv_timer_loop(void* arg __attribute__((unused))) {
+    while(true) {
+        struct epoll_event event;
+        int n = epoll_wait(timer_epoll, &event, 1, -1);
+
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            dessert_crit("timer engine stopped: %s", strerror(errno));
+            break;
+        }
+
+        uint64_t expirations;
+
+        if(read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+            dessert_warn("could not read timer: %s", strerror(errno));
+        }
+
+        // the timer fired, every deadline from now on has to arm it again
+        pthread_mutex_lock(&timer_mutex);
+        timer_armed = false;
+        pthread_mutex_unlock(&timer_mutex);
+
+        struct timeval now, next;
+        gettimeofday(&now, NULL);
+
+        if(aodv_timer_run_once(&now, &next)) {
+            aodv_timer_wakeup(&next);
+        }
+    }
+
+    return NULL;
+}
+
+int aodv_timer_init() {
+    timer_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if(timer_fd < 0) {
+        dessert_crit("could not create timerfd: %s", strerror(errno));
+        return false;
+    }
+
+    timer_epoll = epoll_create1(EPOLL_CLOEXEC);
+
+    if(timer_epoll < 0) {
+        dessert_crit("could not create epoll instance: %s", strerror(errno));
+        close(timer_fd);
+        timer_fd = -1;
+        return false;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = timer_fd;
+
+    if(epoll_ctl(timer_epoll, EPOLL_CTL_ADD, timer_fd, &event) < 0) {
+        dessert_crit("could not watch timerfd: %s", strerror(errno));
+        close(timer_epoll);
+        close(timer_fd);
+        timer_epoll = timer_fd = -1;
+        return false;
+    }
+
+    timeslot_wakeup = aodv_timer_wakeup;
+
+    // first run right away to learn the earliest deadline
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    aodv_timer_wakeup(&now);
+
+    if(pthread_create(&timer_thread, NULL, aodv_timer_loop, NULL) != 0) {
+        dessert_crit("could not start timer thread");
+        return false;
+    }
+
+    pthread_detach(timer_thread);
+    return true;
+}
+
+void aodv_timer_init_external(timeslot_wakeup_t* wakeup) {
+    timer_external = wakeup;
+    timeslot_wakeup = aodv_timer_wakeup;
+
+    // first run right away to learn the earliest deadline
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    aodv_timer_wakeup(&now);
+}
@@ -18,19 +18,40 @@ You should have received a copy of the GNU General Public License along with
 this program. If not, see http://www.gnu.org/licenses/ .
 --------------------------------------------------------------------------------
 For further information and questions please use the web site
-       http://www.des-testbed.net
+    http://www.des-testbed.net
 *******************************************************************************/
 
-#ifndef AODV_RERR_LOG
-#define AODV_RERR_LOG
 
-#include <time.h>
+#ifndef AODV_TIMER
+#define AODV_TIMER
 
-int aodv_db_rerrl_init();
+#include <sys/time.h>
+#include "../database/timeslot.h"
 
-void aodv_db_rl_putrerr(struct timeval* timestamp);
+/**
+ * Event driven timer engine. One thread sleeps on a timerfd that is armed for
+ * the earliest pending deadline: database expiry, schedules and the gossip
+ * hold queue. Code that creates a deadline earlier than the armed one calls
+ * aodv_timer_wakeup, so nothing is polled at a fixed interval.
+ */
 
-void aodv_db_rl_getrerrcount(struct timeval* timestamp, uint32_t* count_out);
+/** create the timerfd and start the engine thread; aodv_db_init must have been called */
+int aodv_timer_init();
 
-#endif
+/**
+ * Drive the engine from outside instead of from its thread, e.g. from the
+ * virtual clock of a simulation: every deadline is reported to wakeup and the
+ * caller runs aodv_timer_run_once when it is due. Replaces aodv_timer_init.
+ */
+void aodv_timer_init_external(timeslot_wakeup_t* wakeup);
+
+/** make sure the engine runs no later than deadline; cheap if an earlier deadline is armed */
+void aodv_timer_wakeup(struct timeval* deadline);
 
+/**
+ * Run everything that is due at now. next_out receives the next deadline,
+ * returns false if nothing is pending.
+ */
+int aodv_timer_run_once(struct timeval* now, struct timeval* next_out);
+
+#endif